@@ -254,10 +254,7 @@ int main(int args, char** argv)
   dc->Initialize();
   dc->StartSignalling();
 
-  while (dc->GetState() != Synavis::EConnectionState::CONNECTED)
-  {
-    std::this_thread::yield();
-  }
+  dc->WaitForState(Synavis::EConnectionState::CONNECTED);
   lmain(Synavis::ELogVerbosity::Debug)
   << "----------------------------------------- Connected ------------------------------------------------------" << std::endl;
 
@@ -267,9 +264,9 @@ int main(int args, char** argv)
   dc->StartStreaming();
   dc->SendMouseClick();
 
-  while (Synavis::EConnectionState::CONNECTED == dc->GetState())
+  // the wait ends early when the connection closes
+  while (!dc->WaitWhileState(Synavis::EConnectionState::CONNECTED, 0.5))
   {
-    std::this_thread::sleep_for(500ms);
     dc->StartStreaming();
     //dc->SendMouseClick();
     //dc->RequestKeyFrame();
@@ -46,10 +46,7 @@ void AppMain(std::string role = "receiver")
   }
   dc->SetConfig(Config);
   dc->StartSignalling();
-  while (dc->GetState() != Synavis::EConnectionState::CONNECTED)
-  {
-    std::this_thread::yield();
-  }
+  dc->WaitForState(Synavis::EConnectionState::CONNECTED);
   if (role == "sender")
   {
     while (dc->GetState() == Synavis::EConnectionState::CONNECTED)
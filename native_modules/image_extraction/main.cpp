@@ -151,10 +151,7 @@ int main(int args, char** argv)
     {
       //std::cout << "Received frame: " << frame.size() << std::endl;
     });
-  while (dc->GetState() != Synavis::EConnectionState::CONNECTED)
-  {
-    std::this_thread::yield();
-  }
+  dc->WaitForState(Synavis::EConnectionState::CONNECTED);
   std::cout << "Found out that we are connected" << std::endl;
   dc->PrintCommunicationData();
   dc->SendJSON(json({ {"type", "settings"},{"bRespondWithTiming", true}, {"bLogResponses", true} }));
@@ -189,9 +186,6 @@ int main(int args, char** argv)
   //  std::this_thread::sleep_for(1s);
   //}
 
-  while (Synavis::EConnectionState::CONNECTED == dc->GetState())
-  {
-    std::this_thread::sleep_for(10ms);
-  }
+  dc->WaitWhileState(Synavis::EConnectionState::CONNECTED);
   return EXIT_SUCCESS;
 }
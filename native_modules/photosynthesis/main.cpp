@@ -10,6 +10,7 @@
 // synavis includes
 #include "Synavis.hpp"
 #include "MediaReceiver.hpp"
+#include "GeometryFile.hpp"
 
 // CPlantBox includes
 #ifdef min
@@ -145,75 +146,40 @@ void wait_for_key(std::string message = "Press any key to continue...")
 
 void write_visualiser_to_file(std::shared_ptr<TaggedPlantVisualiser> visualiser, std::string filename)
 {
-  std::ofstream file(filename, std::ios::binary);
-  file.flush();
-  // write number of vertices
-  uint64_t num_vertices = visualiser->GetGeometry().size() / 3uL;
-  uint64_t byte_size_total = Synavis::ByteSize(visualiser->GetGeometry()) + sizeof(uint64_t);
-  //wait_for_key("About to write the number of vertices");
-  file.write(reinterpret_cast<const char*>(&num_vertices), sizeof(uint64_t));
-  file.flush();
-  //wait_for_key("About to write the vertices");
-  // write vertices
-  file.write(reinterpret_cast<const char*>(visualiser->GetGeometry().data()), Synavis::ByteSize(visualiser->GetGeometry()));
-  file.flush();
-  //wait_for_key("About to write the number of indices");
-  lmain(Synavis::ELogVerbosity::Debug) << "Byte size of vertices: " << Synavis::ByteSize(visualiser->GetGeometry()) << std::endl;
-  // write number of indices
-  uint64_t num_indices = visualiser->GetGeometryIndices().size();
-  byte_size_total += num_indices * sizeof(unsigned int) + sizeof(uint64_t);
-  file.write(reinterpret_cast<const char*>(&num_indices), sizeof(uint64_t));
-  file.flush();
-  //wait_for_key("About to write the indices");
-  // write indices
-  file.write(reinterpret_cast<const char*>(visualiser->GetGeometryIndices().data()), Synavis::ByteSize(visualiser->GetGeometryIndices()));
-  file.flush();
-  lmain(Synavis::ELogVerbosity::Debug) << "Byte size of indices: " << Synavis::ByteSize(visualiser->GetGeometryIndices()) << std::endl;
-
-  // write number of normals
-  uint64_t num_normals = visualiser->GetGeometryNormals().size() / 3uL;
-  byte_size_total += num_normals * sizeof(double) * 3uL + sizeof(uint64_t);
-  //wait_for_key("About to write the number of normals");
-  file.write(reinterpret_cast<const char*>(&num_normals), sizeof(uint64_t));
-  file.flush();
-  //wait_for_key("About to write the normals");
-  // write normals
-  file.write(reinterpret_cast<const char*>(visualiser->GetGeometryNormals().data()), Synavis::ByteSize(visualiser->GetGeometryNormals()));
-  file.flush();
-  lmain(Synavis::ELogVerbosity::Debug) << "Byte size of normals: " << Synavis::ByteSize(visualiser->GetGeometryNormals()) << std::endl;
-  // write number of ucs
-  uint64_t num_ucs = visualiser->GetGeometryColors().size() / 2uL;
-  byte_size_total += num_ucs * sizeof(double) * 2uL + sizeof(uint64_t);
-  //wait_for_key("About to write the number of ucs");
-  file.write(reinterpret_cast<const char*>(&num_ucs), sizeof(uint64_t));
-  file.flush();
-  //wait_for_key("About to write the ucs");
-  // write ucs
-  file.write(reinterpret_cast<const char*>(visualiser->GetGeometryColors().data()), Synavis::ByteSize(visualiser->GetGeometryColors()));
-  file.flush();
-  //wait_for_key();
-  lmain(Synavis::ELogVerbosity::Debug) << "Byte size of ucs: " << Synavis::ByteSize(visualiser->GetGeometryColors()) << std::endl;
-
-  if (file.bad())
+  // the references keep the arrays alive if the visualiser returns copies
+  const auto& vertices = visualiser->GetGeometry();
+  const auto& indices = visualiser->GetGeometryIndices();
+  const auto& normals = visualiser->GetGeometryNormals();
+  const auto& ucs = visualiser->GetGeometryColors();
+  Synavis::MeshView geometry;
+  geometry.Name = filename;
+  geometry.Vertices = vertices;
+  geometry.Indices = indices;
+  geometry.Normals = normals;
+  geometry.UVs = ucs;
+  try
   {
-    lmain(Synavis::ELogVerbosity::Error) << "Failed to write to file: " << filename << std::endl;
+    // a single mapped write instead of a flushed write per count and array
+    Synavis::WriteGeometryFile(filename, geometry);
+  }
+  catch (const std::runtime_error& e)
+  {
+    lmain(Synavis::ELogVerbosity::Error) << "Failed to write to file: " << filename << " (" << e.what() << ")" << std::endl;
     return;
   }
-  file.close();
   lmain(Synavis::ELogVerbosity::Info) << "Wrote visualiser to file: " << filename << std::endl;
-  lmain(Synavis::ELogVerbosity::Info) << "Vertices: " << num_vertices << std::endl;
-  lmain(Synavis::ELogVerbosity::Info) << "Indices: " << num_indices << std::endl;
-  lmain(Synavis::ELogVerbosity::Info) << "Normals: " << num_normals << std::endl;
-  lmain(Synavis::ELogVerbosity::Info) << "UCS: " << num_ucs << std::endl;
-  lmain(Synavis::ELogVerbosity::Info) << "Reference size is: " << sizeof(double) * 3uL << " resulting in " << byte_size_total / 1024uL << "kb" << std::endl;
+  lmain(Synavis::ELogVerbosity::Info) << "Vertices: " << vertices.size() / 3uL << std::endl;
+  lmain(Synavis::ELogVerbosity::Info) << "Indices: " << indices.size() << std::endl;
+  lmain(Synavis::ELogVerbosity::Info) << "Normals: " << normals.size() / 3uL << std::endl;
+  lmain(Synavis::ELogVerbosity::Info) << "UCS: " << ucs.size() / 2uL << std::endl;
+  lmain(Synavis::ELogVerbosity::Info) << "Reference size is: " << sizeof(double) * 3uL << " resulting in " << Synavis::GeometryFileSize(geometry) / 1024uL << "kb" << std::endl;
   lmain(Synavis::ELogVerbosity::Info) << "10 Vectors, evenly spaced through GetGeometry(): " << std::endl;
-  auto num_points = visualiser->GetGeometryNormals().size() / 3uL;
-  auto step = num_points / 10uL;
-  for (auto i = 0; i < num_points; i += step)
+  auto num_points = normals.size() / 3uL;
+  auto step = std::max<std::size_t>(num_points / 10uL, 1uL);
+  for (std::size_t i = 0; i < num_points; i += step)
   {
-    lmain(Synavis::ELogVerbosity::Info) << "Point " << i << ": " << visualiser->GetGeometryNormals()[i * 3uL] << ", " << visualiser->GetGeometryNormals()[i * 3uL + 1uL] << ", " << visualiser->GetGeometryNormals()[i * 3uL + 2uL] << std::endl;
+    lmain(Synavis::ELogVerbosity::Info) << "Point " << i << ": " << normals[i * 3uL] << ", " << normals[i * 3uL + 1uL] << ", " << normals[i * 3uL + 2uL] << std::endl;
   }
-
 }
 
 
@@ -507,7 +473,7 @@ void communicate_backend_swap(std::shared_ptr<Synavis::DataConnector> old, std::
   }
 }
 
-void scalability_test(std::shared_ptr<Synavis::DataConnector> m, std::shared_ptr<FieldManager> field_manager, auto rank = -1, auto size = -1, std::string tempf = "./", bool useFile = false, int delay = 100)
+void scalability_test(std::shared_ptr<Synavis::DataConnector> m, std::shared_ptr<FieldManager> field_manager, auto rank = -1, auto size = -1, std::string tempf = "./", bool useFile = false, int delay = 100, int batch_size = 1)
 {
   using namespace std::literals::chrono_literals;
   field_manager->ScaleResolutionByRank = true;
@@ -537,6 +503,7 @@ void scalability_test(std::shared_ptr<Synavis::DataConnector> m, std::shared_ptr
     };
   m->SetMessageCallback(log_fsp);
   lmain(Synavis::ELogVerbosity::Info) << "Scalability test started" << std::endl;
+  Synavis::GeometryBatch batch;
   while (true)
   {
     // another plant
@@ -554,19 +521,35 @@ void scalability_test(std::shared_ptr<Synavis::DataConnector> m, std::shared_ptr
       auto position = V::Pad<double, 3>(field_manager->get_position_from_num(w), 0.0);
       std::size_t i = 0;
       std::transform(vertices.begin(), vertices.end(), vertices.begin(), [position, &i](double val) { return val + position[i++ % 3]; });
-      m->SendGeometry(
-        vertices,
-        vis->GetGeometryIndices(),
-        "plant" + std::to_string(vis->tag),
-        vis->GetGeometryNormals()
-      );
+      if (batch_size > 1)
+      {
+        auto indices = vis->GetGeometryIndices();
+        auto normals = vis->GetGeometryNormals();
+        auto name = "plant" + std::to_string(vis->tag);
+        batch.Add({ name, vertices, indices, normals });
+        // plants are sent in groups to save the handshake of every transfer
+        if (batch.Count() >= static_cast<std::size_t>(batch_size))
+        {
+          m->SendGeometryBatch(batch);
+          batch.Clear();
+        }
+      }
+      else
+      {
+        m->SendGeometry(
+          vertices,
+          vis->GetGeometryIndices(),
+          "plant" + std::to_string(vis->tag),
+          vis->GetGeometryNormals()
+        );
+      }
     }
     // let the thread sleep for 10 seconds
     std::this_thread::sleep_for(std::chrono::milliseconds(delay));
   }
 }
 
-void field_population(auto m, auto field_manager, auto& worker_threads, auto threads_per_rank, auto plants_per_thread)
+void field_population(auto m, auto field_manager, auto& worker_threads, auto threads_per_rank, auto plants_per_thread, int batch_size = 1)
 {
   // make tasks for each thread to populate the field
   for (auto i = 0; i < threads_per_rank; ++i)
@@ -578,26 +561,51 @@ void field_population(auto m, auto field_manager, auto& worker_threads, auto thr
   }
 
   bool stop = false;
+  // with --batch the plants that are ready are sent in transfers of up to batch_size plants and this size,
+  // the receiver has to understand the "geometrybatch" buffer
+  constexpr std::size_t max_batch_bytes = 64 * 1024 * 1024;
+  Synavis::GeometryBatch batch;
 
   while (!stop)
   {
-    std::unique_lock<std::mutex> lock(submissionQueueLock);
-    submissionQueueCondition.wait(lock, [&] { return !submissionQueue.empty(); });
-    // get the visualiser
-    std::shared_ptr<TaggedPlantVisualiser> visualiser = submissionQueue.front();
-    // remove the visualiser from the queue
-    submissionQueue.pop_front();
-    // if the visualiser is still valid
-    if (visualiser)
+    std::deque<std::shared_ptr<TaggedPlantVisualiser>> ready;
     {
-      // submit the visualiser to the media receiver
-      m->SendGeometry(
-        visualiser->GetGeometry(),
-        visualiser->GetGeometryIndices(),
-        "plant" + std::to_string(visualiser->tag),
-        visualiser->GetGeometryNormals()
-      );
+      std::unique_lock<std::mutex> lock(submissionQueueLock);
+      submissionQueueCondition.wait(lock, [&] { return !submissionQueue.empty(); });
+      // take the visualisers, the populating threads can continue while we send
+      std::swap(ready, submissionQueue);
+    }
+    for (auto& visualiser : ready)
+    {
+      // if the visualiser is still valid
+      if (!visualiser)
+        continue;
+      auto vertices = visualiser->GetGeometry();
+      auto indices = visualiser->GetGeometryIndices();
+      auto normals = visualiser->GetGeometryNormals();
+      auto name = "plant" + std::to_string(visualiser->tag);
+      if (batch_size > 1)
+      {
+        Synavis::MeshView geometry;
+        geometry.Name = name;
+        geometry.Vertices = vertices;
+        geometry.Indices = indices;
+        geometry.Normals = normals;
+        batch.Add(geometry);
+        if (batch.Count() >= static_cast<std::size_t>(batch_size) || batch.Size() >= max_batch_bytes)
+        {
+          m->SendGeometryBatch(batch);
+          batch.Clear();
+        }
+      }
+      else
+      {
+        m->SendGeometry(vertices, indices, name, normals);
+      }
     }
+    // the rest of the batch does not wait for plants that are not ready yet
+    m->SendGeometryBatch(batch);
+    batch.Clear();
   }
 }
 
@@ -829,6 +837,12 @@ int main(int argc, char** argv)
     delay = std::stoi(parser.GetArgument("delay"));
   }
 
+  int batch_size = 1;
+  if (parser.HasArgument("batch"))
+  {
+    batch_size = std::stoi(parser.GetArgument("batch"));
+  }
+
   if (!parser.HasArgument("p"))
   {
     lmain(Synavis::ELogVerbosity::Error) << "No parameter file provided" << std::endl;
@@ -1021,11 +1035,11 @@ int main(int argc, char** argv)
     {
       bool use_file = parser.HasArgument("use-file");
       lmain(Synavis::ELogVerbosity::Info) << "We are " << (use_file ? "" : "not ") << "using file-based transmission." << std::endl;
-      scalability_test(m, field_manager, rank, size, tempf, use_file, delay);
+      scalability_test(m, field_manager, rank, size, tempf, use_file, delay, batch_size);
     }
     else if (test == "field-population")
     {
-      field_population(m, field_manager, worker_threads, threads_per_rank, plants_per_thread);
+      field_population(m, field_manager, worker_threads, threads_per_rank, plants_per_thread, batch_size);
     }
     else if (test == "concurrency")
     {
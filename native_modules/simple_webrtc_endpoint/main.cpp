@@ -63,9 +63,6 @@ int main(int args, char** arg)
   }
   else
   {
-    while (dc->GetState() == Synavis::EConnectionState::CONNECTED)
-    {
-      std::this_thread::yield();
-    }
+    dc->WaitWhileState(Synavis::EConnectionState::CONNECTED);
   }
 }
\ No newline at end of file
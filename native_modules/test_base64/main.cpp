@@ -2,11 +2,106 @@
 #include <string>
 #include <vector>
 #include <span>
+#include <random>
+#include <chrono>
 
 #include "Synavis.hpp"
 
 using namespace Synavis;
 
+// straightforward reference implementation to compare the vectorized codec against
+std::string ReferenceEncode(const std::vector<uint8_t>& Data)
+{
+  constexpr char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string result;
+  uint32_t bits = 0;
+  int count = 0;
+  for (auto byte : Data)
+  {
+    bits = (bits << 8) | byte;
+    count += 8;
+    while (count >= 6)
+    {
+      count -= 6;
+      result += table[(bits >> count) & 0x3F];
+    }
+  }
+  if (count > 0)
+  {
+    result += table[(bits << (6 - count)) & 0x3F];
+  }
+  while (result.size() % 4 != 0)
+  {
+    result += '=';
+  }
+  return result;
+}
+
+int RoundTrip()
+{
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> distribution(0, 255);
+  for (std::size_t length = 0; length < 1024; ++length)
+  {
+    std::vector<uint8_t> data(length);
+    std::generate(data.begin(), data.end(), [&]() { return static_cast<uint8_t>(distribution(generator)); });
+    std::string encoded(EncodedSize(data), '\0');
+    encoded.resize(Encode64Into(data.data(), data.size(), encoded.data()));
+    if (encoded != ReferenceEncode(data))
+    {
+      std::cout << "Encode64Into failed for length " << length << std::endl;
+      return 1;
+    }
+    if (DecodedSize(encoded) != length || Decode64(encoded) != data)
+    {
+      std::cout << "Decode64 failed for length " << length << std::endl;
+      return 1;
+    }
+  }
+  // invalid characters must be reported, also when they appear in the vectorized part
+  std::string invalid(256, 'A');
+  for (std::size_t position : { 0, 17, 100, 255 })
+  {
+    auto broken = invalid;
+    broken[position] = '*';
+    std::vector<uint8_t> output(DecodedSize(broken));
+    std::size_t written = 0;
+    if (Decode64Into(broken, output.data(), written))
+    {
+      std::cout << "Decode64Into accepted an invalid character at " << position << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void Throughput()
+{
+  constexpr std::size_t size = 64 * 1024 * 1024;
+  constexpr int repetitions = 10;
+  std::vector<uint8_t> data(size);
+  std::mt19937 generator(7);
+  std::generate(data.begin(), data.end(), [&]() { return static_cast<uint8_t>(generator()); });
+  std::string encoded(EncodedSize(data), '\0');
+  std::vector<uint8_t> decoded(size);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < repetitions; ++i)
+    Encode64Into(data.data(), data.size(), encoded.data());
+  double encode_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+  std::size_t written = 0;
+  start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < repetitions; ++i)
+    Decode64Into(encoded, decoded.data(), written);
+  double decode_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+  const double gigabytes = static_cast<double>(size) * repetitions / 1e9;
+  std::cout << "Base64 implementation: " << Base64Implementation() << std::endl;
+  std::cout << "Encode: " << gigabytes / encode_time << " GB/s (input bytes)" << std::endl;
+  std::cout << "Decode: " << gigabytes / decode_time << " GB/s (output bytes)" << std::endl;
+}
+
 int main()
 {
   std::vector<double> ddata = {1.0, 2.0, 3.0, 4.0};
@@ -55,4 +150,10 @@ int main()
     std::cout << "Got: " << encoded << std::endl;
     return 1;
   }
+  if (RoundTrip() != 0)
+  {
+    return 1;
+  }
+  Throughput();
+  return 0;
 }
@@ -0,0 +1,648 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <chrono>
+#include <algorithm>
+#include <future>
+#include <thread>
+
+#include "Depacketizer.hpp"
+#include "JitterBuffer.hpp"
+#include "FramePool.hpp"
+#include "Pipeline.hpp"
+
+using namespace Synavis;
+
+// RTP packets in network byte order, laid out like the ones libwebrtc sends for H.264:
+// the SPS and PPS in a STAP-A in front of every key frame, large NAL units in FU-A fragments
+// and the marker bit on the last packet of each access unit.
+struct RtpStream
+{
+  uint16_t Sequence{ 40000 };
+  uint32_t Timestamp{ 90000 };
+  uint32_t SSRC{ 0x1234ABCD };
+
+  std::vector<std::byte> Packet(const std::vector<uint8_t>& Payload, bool Marker, std::size_t Padding = 0, bool Extension = false, uint8_t CSRCs = 0)
+  {
+    std::vector<uint8_t> packet;
+    packet.push_back(static_cast<uint8_t>(0x80 | (Padding > 0 ? 0x20 : 0) | (Extension ? 0x10 : 0) | CSRCs));
+    packet.push_back(static_cast<uint8_t>((Marker ? 0x80 : 0) | 102));
+    packet.push_back(static_cast<uint8_t>(Sequence >> 8));
+    packet.push_back(static_cast<uint8_t>(Sequence & 0xFF));
+    for (int shift = 24; shift >= 0; shift -= 8)
+      packet.push_back(static_cast<uint8_t>(Timestamp >> shift));
+    for (int shift = 24; shift >= 0; shift -= 8)
+      packet.push_back(static_cast<uint8_t>(SSRC >> shift));
+    for (uint8_t i = 0; i < CSRCs; ++i)
+      packet.insert(packet.end(), { 0, 0, 0, static_cast<uint8_t>(i + 1) });
+    if (Extension)
+    {
+      // one-byte header extension with a single word (transport-wide sequence number)
+      packet.insert(packet.end(), { 0xBE, 0xDE, 0x00, 0x01, 0x10, 0x2A, 0x00, 0x00 });
+    }
+    packet.insert(packet.end(), Payload.begin(), Payload.end());
+    for (std::size_t i = 0; i < Padding; ++i)
+      packet.push_back(i + 1 == Padding ? static_cast<uint8_t>(Padding) : 0);
+    Sequence++;
+    std::vector<std::byte> bytes(packet.size());
+    for (std::size_t i = 0; i < packet.size(); ++i)
+      bytes[i] = static_cast<std::byte>(packet[i]);
+    return bytes;
+  }
+};
+
+std::vector<uint8_t> Nal(uint8_t Header, std::size_t Size)
+{
+  std::vector<uint8_t> nal(Size);
+  nal[0] = Header;
+  for (std::size_t i = 1; i < Size; ++i)
+    nal[i] = static_cast<uint8_t>(i * 7 + Header);
+  return nal;
+}
+
+std::vector<uint8_t> StapA(const std::vector<std::vector<uint8_t>>& Nals)
+{
+  std::vector<uint8_t> payload = { 0x78 };
+  for (const auto& nal : Nals)
+  {
+    payload.push_back(static_cast<uint8_t>(nal.size() >> 8));
+    payload.push_back(static_cast<uint8_t>(nal.size() & 0xFF));
+    payload.insert(payload.end(), nal.begin(), nal.end());
+  }
+  return payload;
+}
+
+std::vector<std::vector<uint8_t>> FuA(const std::vector<uint8_t>& Nal, std::size_t Fragment)
+{
+  std::vector<std::vector<uint8_t>> fragments;
+  for (std::size_t i = 1; i < Nal.size(); i += Fragment)
+  {
+    const auto end = std::min(Nal.size(), i + Fragment);
+    std::vector<uint8_t> payload = { static_cast<uint8_t>((Nal[0] & 0xE0) | 28),
+      static_cast<uint8_t>((i == 1 ? 0x80 : 0) | (end == Nal.size() ? 0x40 : 0) | (Nal[0] & 0x1F)) };
+    payload.insert(payload.end(), Nal.begin() + i, Nal.begin() + end);
+    fragments.push_back(payload);
+  }
+  return fragments;
+}
+
+std::vector<uint8_t> AnnexB(const std::vector<std::vector<uint8_t>>& Nals)
+{
+  std::vector<uint8_t> access;
+  for (const auto& nal : Nals)
+  {
+    access.insert(access.end(), { 0, 0, 0, 1 });
+    access.insert(access.end(), nal.begin(), nal.end());
+  }
+  return access;
+}
+
+bool Equal(std::span<const std::byte> Frame, const std::vector<uint8_t>& Expected)
+{
+  if (Frame.size() != Expected.size())
+    return false;
+  for (std::size_t i = 0; i < Frame.size(); ++i)
+  {
+    if (Frame[i] != static_cast<std::byte>(Expected[i]))
+      return false;
+  }
+  return true;
+}
+
+// a key frame and two delta frames, with padding, CSRCs and header extensions on the way
+int Stream()
+{
+  RtpStream stream;
+  H264Depacketizer depacketizer;
+  const auto sps = Nal(0x67, 14), pps = Nal(0x68, 4), idr = Nal(0x65, 3000);
+  depacketizer.AddPacket(stream.Packet(StapA({ sps, pps }), false, 0, true));
+  const auto fragments = FuA(idr, 1180);
+  for (std::size_t i = 0; i < fragments.size(); ++i)
+  {
+    if (depacketizer.IsFrameComplete())
+    {
+      std::cout << "Key frame completed before its marker" << std::endl;
+      return 1;
+    }
+    depacketizer.AddPacket(stream.Packet(fragments[i], i + 1 == fragments.size(), i == 1 ? 7 : 0, true));
+  }
+  if (!depacketizer.IsFrameComplete() || !depacketizer.IsKeyFrame()
+    || depacketizer.GetTimestamp() != stream.Timestamp || !Equal(depacketizer.GetFrame(), AnnexB({ sps, pps, idr })))
+  {
+    std::cout << "Key frame was not reassembled" << std::endl;
+    return 1;
+  }
+  const auto* buffer = depacketizer.GetFrame().data();
+  for (int f = 0; f < 2; ++f)
+  {
+    stream.Timestamp += 3000;
+    const auto slice = Nal(0x41, 200 + f);
+    depacketizer.AddPacket(stream.Packet(slice, true, 0, false, 2));
+    if (!depacketizer.IsFrameComplete() || depacketizer.IsKeyFrame() || !Equal(depacketizer.GetFrame(), AnnexB({ slice })))
+    {
+      std::cout << "Delta frame " << f << " was not reassembled" << std::endl;
+      return 1;
+    }
+    if (depacketizer.GetFrame().data() != buffer)
+    {
+      std::cout << "Frame buffer was not reused" << std::endl;
+      return 1;
+    }
+  }
+  if (depacketizer.GetDroppedFrames() != 0)
+  {
+    std::cout << "Frames were dropped from a complete stream" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// lost packets and a lost marker drop only the frames they belong to
+int Loss()
+{
+  RtpStream stream;
+  H264Depacketizer depacketizer;
+  const auto idr = Nal(0x65, 2500);
+  auto fragments = FuA(idr, 1000);
+  depacketizer.AddPacket(stream.Packet(fragments[0], false));
+  stream.Sequence++;
+  depacketizer.AddPacket(stream.Packet(fragments[2], true));
+  if (depacketizer.IsFrameComplete() || depacketizer.GetDroppedFrames() != 1)
+  {
+    std::cout << "Frame with a lost fragment was not dropped" << std::endl;
+    return 1;
+  }
+  // the last fragment without its end bit, the NAL unit is cut off
+  stream.Timestamp += 3000;
+  auto cut = fragments[1];
+  depacketizer.AddPacket(stream.Packet(fragments[0], false));
+  depacketizer.AddPacket(stream.Packet(cut, true));
+  if (depacketizer.IsFrameComplete() || depacketizer.GetDroppedFrames() != 2)
+  {
+    std::cout << "Frame with a cut off NAL unit was not dropped" << std::endl;
+    return 1;
+  }
+  // the marker packet is lost, the next frame starts with a new timestamp; the gap could
+  // also have taken the start of the next frame, so that one is dropped as well
+  stream.Timestamp += 3000;
+  depacketizer.AddPacket(stream.Packet(Nal(0x41, 100), false));
+  stream.Sequence++;
+  stream.Timestamp += 3000;
+  const auto slice = Nal(0x41, 120);
+  depacketizer.AddPacket(stream.Packet(slice, true));
+  if (depacketizer.IsFrameComplete() || depacketizer.GetDroppedFrames() != 4)
+  {
+    std::cout << "Frame without a marker was not dropped" << std::endl;
+    return 1;
+  }
+  stream.Timestamp += 3000;
+  depacketizer.AddPacket(stream.Packet(slice, true));
+  if (!depacketizer.IsFrameComplete() || !Equal(depacketizer.GetFrame(), AnnexB({ slice })))
+  {
+    std::cout << "Stream did not recover after packet loss" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// malformed packets are ignored or drop their frame instead of reading out of bounds
+int Malformed()
+{
+  RtpStream stream;
+  H264Depacketizer depacketizer;
+  auto packet = stream.Packet(Nal(0x41, 10), true, 0, false, 3);
+  depacketizer.AddPacket(std::span<const std::byte>(packet).first(16));
+  auto stap = stream.Packet({ 0x78, 0x00, 0x40, 0x41, 0x01 }, true);
+  depacketizer.AddPacket(stap);
+  auto padding = stream.Packet(Nal(0x41, 4), true, 4);
+  padding.back() = std::byte{ 0xFF };
+  depacketizer.AddPacket(padding);
+  auto interleaved = stream.Packet({ 0x5D, 0x00, 0x01 }, true);
+  depacketizer.AddPacket(interleaved);
+  if (depacketizer.IsFrameComplete())
+  {
+    std::cout << "Malformed packet produced a frame" << std::endl;
+    return 1;
+  }
+  depacketizer.ResetPacket();
+  stream.Timestamp += 3000;
+  const auto slice = Nal(0x41, 32);
+  depacketizer.AddPacket(stream.Packet(slice, true));
+  if (!depacketizer.IsFrameComplete() || !Equal(depacketizer.GetFrame(), AnnexB({ slice })))
+  {
+    std::cout << "Depacketizer did not recover after a reset" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// VP8 frames split into packets with the descriptor libwebrtc writes: X, I with a 15-bit picture ID
+std::vector<std::vector<uint8_t>> VP8Packets(const std::vector<uint8_t>& Frame, uint16_t PictureId, std::size_t Size)
+{
+  std::vector<std::vector<uint8_t>> packets;
+  for (std::size_t i = 0; i < Frame.size(); i += Size)
+  {
+    std::vector<uint8_t> payload = { static_cast<uint8_t>(0x80 | (i == 0 ? 0x10 : 0)), 0x80,
+      static_cast<uint8_t>(0x80 | (PictureId >> 8)), static_cast<uint8_t>(PictureId & 0xFF) };
+    payload.insert(payload.end(), Frame.begin() + i, Frame.begin() + std::min(Frame.size(), i + Size));
+    packets.push_back(payload);
+  }
+  return packets;
+}
+
+// one VP9 layer frame in non-flexible mode with layer indices, the first packet of the
+// key frame carries the scalability structure
+std::vector<std::vector<uint8_t>> VP9Packets(const std::vector<uint8_t>& Frame, uint16_t PictureId, uint8_t Spatial, bool Predicted, bool Structure, std::size_t Size)
+{
+  std::vector<std::vector<uint8_t>> packets;
+  for (std::size_t i = 0; i < Frame.size(); i += Size)
+  {
+    const bool begin = i == 0, end = i + Size >= Frame.size();
+    const bool ss = Structure && begin;
+    std::vector<uint8_t> payload = { static_cast<uint8_t>(0x80 | (Predicted ? 0x40 : 0) | 0x20 | (begin ? 0x08 : 0) | (end ? 0x04 : 0) | (ss ? 0x02 : 0)),
+      static_cast<uint8_t>(0x80 | (PictureId >> 8)), static_cast<uint8_t>(PictureId & 0xFF),
+      static_cast<uint8_t>(Spatial << 1), 0x11 };
+    if (ss)
+    {
+      // two spatial layers with resolutions, one picture in the group with one reference
+      payload.insert(payload.end(), { 0x38, 0x02, 0x80, 0x01, 0x68, 0x05, 0x00, 0x02, 0xD0, 0x01, 0x04, 0x01 });
+    }
+    payload.insert(payload.end(), Frame.begin() + i, Frame.begin() + std::min(Frame.size(), i + Size));
+    packets.push_back(payload);
+  }
+  return packets;
+}
+
+std::vector<uint8_t> Bytes(std::size_t Size, uint8_t Seed)
+{
+  std::vector<uint8_t> bytes(Size);
+  for (std::size_t i = 0; i < Size; ++i)
+    bytes[i] = static_cast<uint8_t>(i * 13 + Seed);
+  return bytes;
+}
+
+int VP8()
+{
+  RtpStream stream;
+  VP8Depacketizer depacketizer;
+  // the P bit in the first byte of the VP8 payload header is clear on key frames
+  auto key = Bytes(2600, 0x10);
+  key[0] = 0x10;
+  auto packets = VP8Packets(key, 0x1234, 1000);
+  for (std::size_t i = 0; i < packets.size(); ++i)
+    depacketizer.AddPacket(stream.Packet(packets[i], i + 1 == packets.size()));
+  if (!depacketizer.IsFrameComplete() || !depacketizer.IsKeyFrame() || depacketizer.GetPictureId() != 0x1234
+    || !Equal(depacketizer.GetFrame(), key))
+  {
+    std::cout << "VP8 key frame was not reassembled" << std::endl;
+    return 1;
+  }
+  // a delta frame with the minimal descriptor, without picture ID
+  stream.Timestamp += 3000;
+  auto delta = Bytes(300, 0x11);
+  delta[0] = 0x11;
+  std::vector<uint8_t> payload = { 0x10 };
+  payload.insert(payload.end(), delta.begin(), delta.end());
+  depacketizer.AddPacket(stream.Packet(payload, true));
+  if (!depacketizer.IsFrameComplete() || depacketizer.IsKeyFrame() || depacketizer.GetPictureId().has_value()
+    || !Equal(depacketizer.GetFrame(), delta))
+  {
+    std::cout << "VP8 delta frame was not reassembled" << std::endl;
+    return 1;
+  }
+  // a frame that does not begin with partition 0 and a frame that changes its picture ID
+  stream.Timestamp += 3000;
+  packets = VP8Packets(delta, 0x1235, 200);
+  packets[0][0] &= ~0x10;
+  for (std::size_t i = 0; i < packets.size(); ++i)
+    depacketizer.AddPacket(stream.Packet(packets[i], i + 1 == packets.size()));
+  stream.Timestamp += 3000;
+  packets = VP8Packets(delta, 0x1236, 200);
+  packets[1][3] = 0x37;
+  for (std::size_t i = 0; i < packets.size(); ++i)
+    depacketizer.AddPacket(stream.Packet(packets[i], i + 1 == packets.size()));
+  if (depacketizer.IsFrameComplete() || depacketizer.GetDroppedFrames() != 2)
+  {
+    std::cout << "Malformed VP8 frames were not dropped" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int VP9()
+{
+  RtpStream stream;
+  VP9Depacketizer depacketizer;
+  // two spatial layers of a key frame, the marker is on the last packet of the upper layer
+  const auto base = Bytes(1500, 0x20), upper = Bytes(2900, 0x21);
+  auto packets = VP9Packets(base, 0x0101, 0, false, true, 1000);
+  const auto upperpackets = VP9Packets(upper, 0x0101, 1, true, false, 1000);
+  packets.insert(packets.end(), upperpackets.begin(), upperpackets.end());
+  for (std::size_t i = 0; i < packets.size(); ++i)
+    depacketizer.AddPacket(stream.Packet(packets[i], i + 1 == packets.size()));
+  auto superframe = base;
+  superframe.insert(superframe.end(), upper.begin(), upper.end());
+  superframe.insert(superframe.end(), { 0xC9, 0xDC, 0x05, 0x54, 0x0B, 0xC9 });
+  if (!depacketizer.IsFrameComplete() || !depacketizer.IsKeyFrame() || depacketizer.GetLayerFrames() != 2
+    || depacketizer.GetPictureId() != 0x0101 || !Equal(depacketizer.GetFrame(), superframe))
+  {
+    std::cout << "VP9 superframe was not reassembled" << std::endl;
+    return 1;
+  }
+  // a single layer delta frame in flexible mode with two references
+  stream.Timestamp += 3000;
+  const auto delta = Bytes(700, 0x22);
+  std::vector<uint8_t> payload = { 0xDC, 0x05, 0x03, 0x02 };
+  payload.insert(payload.end(), delta.begin(), delta.end());
+  depacketizer.AddPacket(stream.Packet(payload, true));
+  if (!depacketizer.IsFrameComplete() || depacketizer.IsKeyFrame() || depacketizer.GetLayerFrames() != 1
+    || depacketizer.GetPictureId() != 0x05 || !Equal(depacketizer.GetFrame(), delta))
+  {
+    std::cout << "VP9 flexible mode frame was not reassembled" << std::endl;
+    return 1;
+  }
+  // the end of the upper layer is cut off, and a layer frame without its beginning
+  stream.Timestamp += 3000;
+  packets = VP9Packets(base, 0x0102, 0, true, false, 1000);
+  auto cut = VP9Packets(upper, 0x0102, 1, true, false, 1000);
+  cut.back()[0] &= ~0x04;
+  packets.insert(packets.end(), cut.begin(), cut.end());
+  for (std::size_t i = 0; i < packets.size(); ++i)
+    depacketizer.AddPacket(stream.Packet(packets[i], i + 1 == packets.size()));
+  stream.Timestamp += 3000;
+  packets = VP9Packets(base, 0x0103, 0, true, false, 1000);
+  packets[0][0] &= ~0x08;
+  for (std::size_t i = 0; i < packets.size(); ++i)
+    depacketizer.AddPacket(stream.Packet(packets[i], i + 1 == packets.size()));
+  if (depacketizer.IsFrameComplete() || depacketizer.GetDroppedFrames() != 2)
+  {
+    std::cout << "Malformed VP9 frames were not dropped" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// reordered packets across the sequence number rollover, a lost packet and a late one
+int Reorder()
+{
+  RtpStream stream;
+  stream.Sequence = 65530;
+  JitterBuffer jitter(16, std::chrono::milliseconds(20));
+  std::vector<std::pair<uint16_t, std::size_t>> losses;
+  jitter.SetLossCallback([&losses](uint16_t First, std::size_t Count) { losses.emplace_back(First, Count); });
+  std::vector<std::vector<std::byte>> packets;
+  for (int i = 0; i < 12; ++i)
+    packets.push_back(stream.Packet({ static_cast<uint8_t>(0x41), static_cast<uint8_t>(i) }, true));
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> played;
+  auto drain = [&](std::chrono::steady_clock::time_point Now)
+  {
+    while (auto packet = jitter.Next(Now))
+      played.push_back(static_cast<uint8_t>(packet->back()));
+  };
+  // 65530, 65532, 65531, 65533, 65535, 0, 65534 (rollover), 2, 3 while 1 is missing
+  for (int i : { 0, 2, 1, 3, 5, 6, 4, 8, 9 })
+  {
+    auto packet = packets[i];
+    jitter.Insert(std::move(packet), start);
+    drain(start);
+  }
+  if (played != std::vector<uint8_t>{ 0, 1, 2, 3, 4, 5, 6 } || jitter.Pending() != 2)
+  {
+    std::cout << "Jitter buffer did not reorder the packets" << std::endl;
+    return 1;
+  }
+  drain(start + std::chrono::milliseconds(10));
+  if (played.size() != 7)
+  {
+    std::cout << "Jitter buffer skipped a packet before the playout delay" << std::endl;
+    return 1;
+  }
+  drain(start + std::chrono::milliseconds(25));
+  if (played != std::vector<uint8_t>{ 0, 1, 2, 3, 4, 5, 6, 8, 9 } || jitter.GetLostPackets() != 1
+    || losses != std::vector<std::pair<uint16_t, std::size_t>>{ { 1, 1 } })
+  {
+    std::cout << "Jitter buffer did not skip the lost packet" << std::endl;
+    return 1;
+  }
+  auto late = packets[7];
+  auto duplicate = packets[9];
+  if (jitter.Insert(std::move(late), start) || jitter.Insert(std::move(duplicate), start) || jitter.GetLatePackets() != 2)
+  {
+    std::cout << "Jitter buffer accepted a late packet" << std::endl;
+    return 1;
+  }
+  // a packet more than the capacity ahead pushes the playout forward, the packets that
+  // were not received in the skipped part of the ring are lost and later ones are late
+  stream.Sequence = 4 + 40;
+  jitter.Insert(stream.Packet({ 0x41, 40 }, true), start);
+  auto packet = packets[10];
+  if (jitter.Insert(std::move(packet), start) || jitter.GetLostPackets() != 1 + 25)
+  {
+    std::cout << "Jitter buffer did not handle an overflow" << std::endl;
+    return 1;
+  }
+  drain(start + std::chrono::milliseconds(25));
+  if (played.back() != 40 || jitter.GetLostPackets() != 1 + 25 + 15 || jitter.Pending() != 0)
+  {
+    std::cout << "Jitter buffer did not recover from an overflow" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// plane layout of odd frame sizes, recycling of released buffers and exhaustion
+int Pool()
+{
+  FramePool packed(2);
+  auto frame = packed.Acquire(33, 17);
+  if (!frame || frame->Data().size() != 33 * 17 + 2 * 17 * 9 || frame->Plane(1).Width != 17 || frame->Plane(2).Height != 9
+    || frame->Plane(1).Data != frame->Plane(0).Data + 33 * 17 || frame->Plane(2).Stride != 17)
+  {
+    std::cout << "Packed frame planes have the wrong layout" << std::endl;
+    return 1;
+  }
+  FramePool aligned(2, 64);
+  auto padded = aligned.Acquire(100, 50);
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    const auto& plane = padded->Plane(i);
+    if (reinterpret_cast<std::uintptr_t>(plane.Data) % 64 != 0 || plane.Stride % 64 != 0 || plane.Stride < plane.Width)
+    {
+      std::cout << "Aligned frame planes are not aligned" << std::endl;
+      return 1;
+    }
+  }
+  // both buffers are held, the third frame has to be dropped
+  auto second = packed.Acquire(33, 17);
+  if (!second || packed.Acquire(33, 17) || packed.GetExhausted() != 1 || packed.InUse() != 2)
+  {
+    std::cout << "Frame pool did not report exhaustion" << std::endl;
+    return 1;
+  }
+  second.reset();
+  frame.reset();
+  const auto allocations = packed.GetAllocations();
+  for (int i = 0; i < 100; ++i)
+  {
+    auto recycled = packed.Acquire(33, 17);
+    if (!recycled || packed.InUse() != 1)
+    {
+      std::cout << "Frame pool did not recycle a released buffer" << std::endl;
+      return 1;
+    }
+  }
+  // a smaller frame fits into the buffers as well
+  auto smaller = packed.Acquire(32, 16);
+  if (packed.GetAllocations() != allocations || packed.InUse() != 1 || smaller->Data().size() != 32 * 16 * 3 / 2)
+  {
+    std::cout << "Frame pool allocated in steady state" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// two stages connected by bounded queues, the way FrameDecode chains its threads
+int Stages()
+{
+  StageQueue<int> first(4), second(2);
+  for (int i = 0; i < 4; ++i)
+    first.Push(std::move(i), EBackPressurePolicy::WouldBlock);
+  int rejected = 4;
+  if (first.Push(std::move(rejected), EBackPressurePolicy::WouldBlock) || first.Size() != 4)
+  {
+    std::cout << "Stage queue accepted an item while full" << std::endl;
+    return 1;
+  }
+  StageCounter counter;
+  auto stage = std::async(std::launch::async, [&]()
+  {
+    std::chrono::steady_clock::time_point queued;
+    while (auto item = first.Pop(&queued))
+    {
+      // the second queue is small, this waits for the consumer below
+      second.Push(item.value() * 2);
+      counter.Processed(queued);
+    }
+    second.Close();
+  });
+  // the producer waits for room instead of dropping
+  auto producer = std::async(std::launch::async, [&first]()
+  {
+    for (int i = 4; i < 100; ++i)
+      first.Push(std::move(i));
+    first.Close();
+  });
+  int expected = 0;
+  while (auto item = second.Pop())
+  {
+    if (item.value() != expected * 2)
+    {
+      std::cout << "Stage queue reordered items" << std::endl;
+      // let the other threads finish before their futures are destroyed
+      first.Close();
+      second.Close();
+      return 1;
+    }
+    expected++;
+    if (expected == 50)
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  producer.wait();
+  stage.wait();
+  const auto statistics = counter.Statistics("double", first.Size());
+  int late = 1;
+  if (expected != 100 || statistics.Processed != 100 || statistics.MaxLatency < 0.01
+    || statistics.MeanLatency > statistics.MaxLatency || first.Push(std::move(late)))
+  {
+    std::cout << "Pipeline stages did not drain or measure their latency" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// depacketization cost per codec, the packets are prepared beforehand
+void Throughput()
+{
+  constexpr int frames = 2000;
+  constexpr std::size_t framesize = 60000;
+  auto measure = [](const char* Name, PacketDepacketizer& Depacketizer, const std::vector<std::vector<std::byte>>& Packets)
+  {
+    std::size_t bytes = 0;
+    for (const auto& packet : Packets)
+      bytes += packet.size();
+    std::size_t completed = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < frames; ++i)
+    {
+      for (const auto& packet : Packets)
+        Depacketizer.AddPacket(packet);
+      completed += Depacketizer.IsFrameComplete();
+      Depacketizer.ResetPacket();
+    }
+    const double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << Name << ": " << bytes * frames / time / 1e9 << " GB/s, "
+      << time / (Packets.size() * frames) * 1e9 << " ns per packet (" << completed << " frames)" << std::endl;
+  };
+  std::vector<std::vector<std::byte>> packets;
+  RtpStream stream;
+  const auto idr = Nal(0x65, framesize);
+  const auto fragments = FuA(idr, 1180);
+  for (std::size_t i = 0; i < fragments.size(); ++i)
+    packets.push_back(stream.Packet(fragments[i], i + 1 == fragments.size(), 0, true));
+  H264Depacketizer h264;
+  measure("H.264", h264, packets);
+  packets.clear();
+  const auto vp8 = VP8Packets(Bytes(framesize, 0x10), 7, 1180);
+  for (std::size_t i = 0; i < vp8.size(); ++i)
+    packets.push_back(stream.Packet(vp8[i], i + 1 == vp8.size(), 0, true));
+  VP8Depacketizer vp8depacketizer;
+  measure("VP8", vp8depacketizer, packets);
+  packets.clear();
+  const auto vp9 = VP9Packets(Bytes(framesize, 0x20), 7, 0, true, false, 1180);
+  for (std::size_t i = 0; i < vp9.size(); ++i)
+    packets.push_back(stream.Packet(vp9[i], i + 1 == vp9.size(), 0, true));
+  VP9Depacketizer vp9depacketizer;
+  measure("VP9", vp9depacketizer, packets);
+}
+
+int main()
+{
+  if (Stream() != 0)
+  {
+    return 1;
+  }
+  if (Loss() != 0)
+  {
+    return 1;
+  }
+  if (Malformed() != 0)
+  {
+    return 1;
+  }
+  if (VP8() != 0)
+  {
+    return 1;
+  }
+  if (VP9() != 0)
+  {
+    return 1;
+  }
+  if (Reorder() != 0)
+  {
+    return 1;
+  }
+  if (Pool() != 0)
+  {
+    return 1;
+  }
+  if (Stages() != 0)
+  {
+    return 1;
+  }
+  Throughput();
+  return 0;
+}
@@ -0,0 +1,482 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
+
+#include "MeshCodec.hpp"
+#include "SharedMemory.hpp"
+#include "GeometryFile.hpp"
+#include "MessageScan.hpp"
+#include "Fragmentation.hpp"
+
+using namespace Synavis;
+
+// a grid of quads with all attributes, large enough to require 32-bit indices if requested
+Mesh MakeGrid(std::size_t Width, std::size_t Height)
+{
+  Mesh grid;
+  grid.Name = "grid" + std::to_string(Width) + "x" + std::to_string(Height);
+  grid.Normals.emplace();
+  grid.UVs.emplace();
+  grid.Tangents.emplace();
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<double> height(-0.5, 0.5);
+  for (std::size_t y = 0; y < Height; ++y)
+  {
+    for (std::size_t x = 0; x < Width; ++x)
+    {
+      grid.Vertices.insert(grid.Vertices.end(), { x * 0.1, y * 0.1, height(generator) });
+      grid.Normals->insert(grid.Normals->end(), { 0.0, 0.0, 1.0 });
+      grid.Tangents->insert(grid.Tangents->end(), { 1.0, 0.0, 0.0 });
+      grid.UVs->insert(grid.UVs->end(), { x / double(Width), y / double(Height) });
+    }
+  }
+  for (uint32_t y = 0; y + 1 < Height; ++y)
+  {
+    for (uint32_t x = 0; x + 1 < Width; ++x)
+    {
+      const uint32_t i = static_cast<uint32_t>(y * Width + x);
+      grid.Indices.insert(grid.Indices.end(), { i, i + 1, i + static_cast<uint32_t>(Width), i + 1, i + static_cast<uint32_t>(Width) + 1, i + static_cast<uint32_t>(Width) });
+    }
+  }
+  return grid;
+}
+
+// random unit normals and tangents, the grid ones are too regular to test the octahedral mapping
+void Randomize(Mesh& Geometry)
+{
+  std::mt19937 generator(5);
+  std::normal_distribution<double> distribution;
+  for (auto* directions : { &Geometry.Normals.value(), &Geometry.Tangents.value() })
+  {
+    for (std::size_t i = 0; i < directions->size(); i += 3)
+    {
+      double x = distribution(generator), y = distribution(generator), z = distribution(generator);
+      const double length = std::sqrt(x * x + y * y + z * z);
+      (*directions)[i] = x / length;
+      (*directions)[i + 1] = y / length;
+      (*directions)[i + 2] = z / length;
+    }
+  }
+}
+
+double MaxError(const std::vector<double>& A, const std::vector<double>& B)
+{
+  if (A.size() != B.size())
+    return INFINITY;
+  double error = 0.0;
+  for (std::size_t i = 0; i < A.size(); ++i)
+    error = std::max(error, std::abs(A[i] - B[i]));
+  return error;
+}
+
+int RoundTrip(const Mesh& Geometry, EMeshScalar Precision, double Tolerance)
+{
+  auto message = EncodeMesh(View(Geometry), Precision);
+  if (message.size() != EncodedMeshSize(View(Geometry), Precision))
+  {
+    std::cout << "EncodedMeshSize does not match the message for " << Geometry.Name << std::endl;
+    return 1;
+  }
+  auto decoded = DecodeMesh(message);
+  if (decoded.Name != Geometry.Name || decoded.Indices != Geometry.Indices)
+  {
+    std::cout << "Name or indices differ for " << Geometry.Name << std::endl;
+    return 1;
+  }
+  if (MaxError(decoded.Vertices, Geometry.Vertices) > Tolerance
+    || MaxError(decoded.Normals.value(), Geometry.Normals.value()) > Tolerance
+    || MaxError(decoded.UVs.value(), Geometry.UVs.value()) > Tolerance
+    || MaxError(decoded.Tangents.value(), Geometry.Tangents.value()) > Tolerance)
+  {
+    std::cout << "Attributes differ for " << Geometry.Name << std::endl;
+    return 1;
+  }
+  std::cout << Geometry.Name << ": " << message.size() << " bytes" << std::endl;
+  return 0;
+}
+
+double MaxDirectionError(const std::vector<double>& A, const std::vector<double>& B)
+{
+  double error = 0.0;
+  for (std::size_t i = 0; i + 2 < A.size(); i += 3)
+    error = std::max(error, std::hypot(A[i] - B[i], A[i + 1] - B[i + 1], A[i + 2] - B[i + 2]));
+  return error;
+}
+
+int Quantized(const Mesh& Geometry)
+{
+  // reordering must keep every triangle intact
+  auto reordered = OptimizeVertexOrder(View(Geometry));
+  for (std::size_t i = 0; i < Geometry.Indices.size(); ++i)
+  {
+    for (std::size_t c = 0; c < 3; ++c)
+    {
+      if (reordered.Vertices[reordered.Indices[i] * 3 + c] != Geometry.Vertices[Geometry.Indices[i] * 3 + c])
+      {
+        std::cout << "OptimizeVertexOrder changed triangle " << i / 3 << " of " << Geometry.Name << std::endl;
+        return 1;
+      }
+    }
+  }
+  auto bounds = QuantizationErrorBounds(View(reordered));
+  auto message = EncodeMesh(View(reordered), EMeshScalar::Quantized16);
+  if (message.size() != EncodedMeshSize(View(reordered), EMeshScalar::Quantized16))
+  {
+    std::cout << "EncodedMeshSize does not match the quantized message for " << Geometry.Name << std::endl;
+    return 1;
+  }
+  auto decoded = DecodeMesh(message);
+  if (decoded.Indices != reordered.Indices)
+  {
+    std::cout << "Quantized indices differ for " << Geometry.Name << std::endl;
+    return 1;
+  }
+  // a small slack for the floating point arithmetic of the decoder
+  const double slack = 1e-12;
+  if (MaxError(decoded.Vertices, reordered.Vertices) > bounds.Position + slack
+    || MaxError(decoded.UVs.value(), reordered.UVs.value()) > bounds.UV + slack
+    || MaxDirectionError(decoded.Normals.value(), reordered.Normals.value()) > bounds.Direction
+    || MaxDirectionError(decoded.Tangents.value(), reordered.Tangents.value()) > bounds.Direction)
+  {
+    std::cout << "Quantization error exceeds its bounds for " << Geometry.Name << std::endl;
+    return 1;
+  }
+  std::cout << Geometry.Name << " (quantized): " << message.size() << " bytes, "
+    << EncodedMeshSize(View(Geometry), EMeshScalar::Float64) / double(message.size()) << "x smaller than Float64" << std::endl;
+  return 0;
+}
+
+int Patch()
+{
+  auto previous = MakeGrid(32, 32);
+  // grow the grid by a row and move a few vertices, like a growing plant
+  auto current = previous;
+  for (std::size_t x = 0; x < 32; ++x)
+  {
+    current.Vertices.insert(current.Vertices.end(), { x * 0.1, 3.2, 0.0 });
+    current.Normals->insert(current.Normals->end(), { 0.0, 0.0, 1.0 });
+    current.Tangents->insert(current.Tangents->end(), { 1.0, 0.0, 0.0 });
+    current.UVs->insert(current.UVs->end(), { x / 32.0, 1.0 });
+  }
+  for (std::size_t v : { 5, 6, 7, 500 })
+    current.Vertices[v * 3 + 2] += 0.25;
+  for (uint32_t x = 0; x + 1 < 32; ++x)
+  {
+    const uint32_t i = 31 * 32 + x;
+    current.Indices.insert(current.Indices.end(), { i, i + 1, i + 32 });
+  }
+  auto patch = EncodeMeshPatch(View(previous), View(current), EMeshScalar::Float64);
+  if (!patch.has_value())
+  {
+    std::cout << "EncodeMeshPatch rejected a small change" << std::endl;
+    return 1;
+  }
+  auto patched = previous;
+  ApplyMeshPatch(patched, patch.value());
+  if (patched.Vertices != current.Vertices || patched.Indices != current.Indices
+    || patched.Normals != current.Normals || patched.UVs != current.UVs || patched.Tangents != current.Tangents)
+  {
+    std::cout << "ApplyMeshPatch result differs from the current mesh" << std::endl;
+    return 1;
+  }
+  std::cout << "patch: " << patch->size() << " bytes instead of " << EncodedMeshSize(View(current), EMeshScalar::Float64) << std::endl;
+  // changing an existing triangle or exceeding the threshold requires a full send
+  auto reordered = current;
+  std::swap(reordered.Indices[0], reordered.Indices[1]);
+  if (EncodeMeshPatch(View(previous), View(reordered)).has_value()
+    || EncodeMeshPatch(View(previous), View(current), EMeshScalar::Float32, 0.01).has_value())
+  {
+    std::cout << "EncodeMeshPatch accepted a change that needs a full mesh" << std::endl;
+    return 1;
+  }
+  // a patch must not be applied to another version of the mesh
+  try
+  {
+    ApplyMeshPatch(current, patch.value());
+    std::cout << "ApplyMeshPatch accepted a patch for another version" << std::endl;
+    return 1;
+  }
+  catch (const std::runtime_error&) {}
+  return 0;
+}
+
+int Batch()
+{
+  GeometryBatch batch(EMeshScalar::Float64);
+  std::vector<Mesh> meshes;
+  for (std::size_t i = 1; i <= 50; ++i)
+  {
+    meshes.push_back(MakeGrid(2 + i % 7, 2 + i % 5));
+    meshes.back().Name = "plant" + std::to_string(i);
+    batch.Add(View(meshes.back()));
+  }
+  auto message = batch.Finish();
+  if (message.size() != batch.Size())
+  {
+    std::cout << "GeometryBatch::Size does not match the message" << std::endl;
+    return 1;
+  }
+  auto decoded = DecodeGeometryBatch(message);
+  if (decoded.size() != meshes.size())
+  {
+    std::cout << "DecodeGeometryBatch returned " << decoded.size() << " meshes" << std::endl;
+    return 1;
+  }
+  for (std::size_t i = 0; i < meshes.size(); ++i)
+  {
+    if (decoded[i].Name != meshes[i].Name || decoded[i].Vertices != meshes[i].Vertices || decoded[i].Indices != meshes[i].Indices)
+    {
+      std::cout << "Batched mesh " << meshes[i].Name << " differs" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int Reception()
+{
+  // SendData puts small meshes on the wire unfragmented, the receiver must pass them on as data
+  auto grid = MakeGrid(8, 8);
+  auto moved = grid;
+  moved.Vertices[2] += 1.0;
+  GeometryBatch batch;
+  batch.Add(View(grid));
+  const rtc::binary messages[] = { EncodeMesh(View(grid), EMeshScalar::Float64), EncodeMesh(View(grid), EMeshScalar::Quantized16),
+    EncodeMeshPatch(View(grid), View(moved)).value(), batch.Finish() };
+  for (const auto& message : messages)
+  {
+    if (IsFragment(message, std::byte(50)) || RouteInbound(message, std::byte(50)) != EInboundRoute::Data)
+    {
+      std::cout << "Binary geometry of size " << message.size() << " was not received as data" << std::endl;
+      return 1;
+    }
+  }
+  if (DecodeMesh(messages[0]).Vertices != grid.Vertices)
+  {
+    std::cout << "Received mesh differs" << std::endl;
+    return 1;
+  }
+  // Unreal messages are still told apart by their message byte
+  const rtc::binary response{ std::byte(1), std::byte(2), std::byte(0), std::byte('{'), std::byte('}') };
+  const rtc::binary freeze{ std::byte(3), std::byte(0) };
+  const rtc::binary other{ std::byte(0x80), std::byte(1) };
+  if (RouteInbound(response, std::byte(50)) != EInboundRoute::Message || RouteInbound(freeze, std::byte(50)) != EInboundRoute::Ignore
+    || RouteInbound(other, std::byte(50)) != EInboundRoute::Data || RouteInbound({}, std::byte(50)) != EInboundRoute::Ignore)
+  {
+    std::cout << "Unreal messages were routed wrongly" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int Malformed()
+{
+  auto grid = MakeGrid(4, 4);
+  auto message = EncodeMesh(View(grid));
+  std::vector<rtc::binary> broken(4, message);
+  broken[0][0] = std::byte('X');
+  broken[1].pop_back();
+  broken[2][8] = std::byte(9);
+  // point the first index behind the last vertex
+  auto index_offset = message.size() - grid.Indices.size() * sizeof(uint16_t);
+  broken[3][index_offset] = std::byte(0xFF);
+  // a varint index count far beyond the message must not be allocated
+  broken.push_back(EncodeMesh(View(grid), EMeshScalar::Quantized16));
+  for (std::size_t i = 16; i < 20; ++i)
+    broken.back()[i] = std::byte(0xFF);
+  for (std::size_t i = 0; i < broken.size(); ++i)
+  {
+    try
+    {
+      DecodeMesh(broken[i]);
+      std::cout << "DecodeMesh accepted malformed message " << i << std::endl;
+      return 1;
+    }
+    catch (const std::runtime_error&) {}
+  }
+  return 0;
+}
+
+int SharedRing()
+{
+  auto grid = MakeGrid(32, 32);
+  const auto size = EncodedMeshSize(View(grid), EMeshScalar::Float64);
+  SharedMemoryRing producer("synavis_test_geometry", 2, size);
+  // the consumer usually lives in another process and maps the ring by its name
+  SharedMemoryRing consumer("synavis_test_geometry");
+  if (consumer.GetSlotCount() != 2 || consumer.GetSlotSize() != size || consumer.Peek().has_value())
+  {
+    std::cout << "SharedMemoryRing was not mapped as created" << std::endl;
+    return 1;
+  }
+  // a slot that is written but not committed stays free
+  auto unannounced = producer.Acquire(0.0);
+  EncodeMeshInto(View(grid), unannounced, EMeshScalar::Float64);
+  if (producer.NextSequence() != 0 || consumer.Pending() != 0 || producer.Acquire(0.0).data() != unannounced.data())
+  {
+    std::cout << "SharedMemoryRing published a slot that was not committed" << std::endl;
+    return 1;
+  }
+  for (std::uint64_t i = 0; i < 2; ++i)
+  {
+    auto slot = producer.Acquire(0.0);
+    if (slot.size() != size || EncodeMeshInto(View(grid), slot, EMeshScalar::Float64) != size || producer.Commit(size) != i)
+    {
+      std::cout << "SharedMemoryRing did not accept mesh " << i << std::endl;
+      return 1;
+    }
+  }
+  if (!producer.Acquire(0.01).empty())
+  {
+    std::cout << "SharedMemoryRing handed out a slot that was not released" << std::endl;
+    return 1;
+  }
+  auto slot = consumer.Peek();
+  if (!slot.has_value() || slot->Sequence != 0 || DecodeMesh(slot->Data).Vertices != grid.Vertices)
+  {
+    std::cout << "SharedMemoryRing slot does not hold the mesh" << std::endl;
+    return 1;
+  }
+  consumer.Release();
+  if (producer.Acquire(0.0).empty() || consumer.Pending() != 1)
+  {
+    std::cout << "SharedMemoryRing did not reuse the released slot" << std::endl;
+    return 1;
+  }
+  // a receiver drains the ring on an announcement, also the slots whose announcement was lost
+  producer.Commit(size);
+  std::vector<std::uint64_t> drained;
+  while (auto pending = consumer.Peek())
+  {
+    drained.push_back(pending->Sequence);
+    consumer.Release();
+  }
+  if (drained != std::vector<std::uint64_t>{ 1, 2 } || consumer.Pending() != 0)
+  {
+    std::cout << "SharedMemoryRing could not be drained" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int FileGeometry()
+{
+  auto grid = MakeGrid(24, 24);
+  const auto filename = (std::filesystem::temp_directory_path() / "synavis_test_geometry.bin").string();
+  auto same = [&](const Mesh& Loaded)
+  {
+    return Loaded.Vertices == grid.Vertices && Loaded.Indices == grid.Indices && Loaded.Normals == grid.Normals && Loaded.UVs == grid.UVs;
+  };
+  WriteGeometryFile(filename, View(grid));
+  {
+    GeometryFile file(filename);
+    auto view = file.View();
+    if (!file.HasIndex() || std::filesystem::file_size(filename) != GeometryFileSize(View(grid)) || !same(file.Load())
+      || !view.has_value() || view->Indices.size() != grid.Indices.size() || view->UVs[5] != grid.UVs->at(5))
+    {
+      std::cout << "Geometry file did not map the mesh" << std::endl;
+      return 1;
+    }
+  }
+  // files of the old writer have no index and are parsed front to back
+  {
+    std::ofstream legacy(filename, std::ios::binary | std::ios::trunc);
+    auto write = [&](const auto& Values, std::size_t Components)
+    {
+      const std::uint64_t count = Values.size() / Components;
+      legacy.write(reinterpret_cast<const char*>(&count), sizeof(count));
+      legacy.write(reinterpret_cast<const char*>(Values.data()), Values.size() * sizeof(Values[0]));
+    };
+    write(grid.Vertices, 3);
+    write(grid.Indices, 1);
+    write(*grid.Normals, 3);
+    write(*grid.UVs, 2);
+  }
+  {
+    GeometryFile file(filename);
+    if (file.HasIndex() || !same(file.Load()))
+    {
+      std::cout << "Geometry file of the old layout was not read" << std::endl;
+      return 1;
+    }
+  }
+  // an odd number of indices leaves the normals unaligned, only the copy works then
+  grid.Indices.pop_back();
+  WriteGeometryFile(filename, View(grid));
+  {
+    GeometryFile file(filename);
+    if (file.View().has_value() || !same(file.Load()))
+    {
+      std::cout << "Geometry file with unaligned normals was not read" << std::endl;
+      return 1;
+    }
+  }
+  std::filesystem::resize_file(filename, 20);
+  try
+  {
+    GeometryFile file(filename);
+    std::cout << "Geometry file accepted a truncated file" << std::endl;
+    return 1;
+  }
+  catch (const std::runtime_error&) {}
+  std::filesystem::remove(filename);
+  return 0;
+}
+
+int main()
+{
+  Mesh empty;
+  empty.Normals.emplace();
+  empty.UVs.emplace();
+  empty.Tangents.emplace();
+  if (DecodeMesh(EncodeMesh(View(empty))).Vertices.size() != 0)
+  {
+    std::cout << "Empty mesh round trip failed" << std::endl;
+    return 1;
+  }
+  auto small = MakeGrid(16, 16);
+  auto large = MakeGrid(300, 300);
+  if (RoundTrip(small, EMeshScalar::Float64, 0.0) != 0
+    || RoundTrip(small, EMeshScalar::Float32, 1e-6) != 0
+    || RoundTrip(large, EMeshScalar::Float64, 0.0) != 0
+    || RoundTrip(large, EMeshScalar::Float32, 1e-5) != 0)
+  {
+    return 1;
+  }
+  Randomize(small);
+  Randomize(large);
+  if (Quantized(small) != 0 || Quantized(large) != 0)
+  {
+    return 1;
+  }
+  if (Patch() != 0)
+  {
+    return 1;
+  }
+  if (Batch() != 0)
+  {
+    return 1;
+  }
+  if (Reception() != 0)
+  {
+    return 1;
+  }
+  if (Malformed() != 0)
+  {
+    return 1;
+  }
+  if (SharedRing() != 0)
+  {
+    return 1;
+  }
+  if (FileGeometry() != 0)
+  {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,632 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "Fragmentation.hpp"
+#include "MessageScan.hpp"
+#include "MessageDispatcher.hpp"
+#include "Telemetry.hpp"
+#include "Compression.hpp"
+#include "SendQueue.hpp"
+
+using namespace Synavis;
+
+// counts heap allocations to check that the inbound scan works without them
+std::atomic<std::size_t> Allocations{ 0 };
+
+// the delete that frees stays out of line, inlined into a caller the compiler would
+// pair the free with the replaced operator new and report a mismatch
+#ifdef _MSC_VER
+#define TEST_NOINLINE __declspec(noinline)
+#else
+#define TEST_NOINLINE __attribute__((noinline))
+#endif
+
+void* operator new(std::size_t Size)
+{
+  Allocations++;
+  if (void* pointer = std::malloc(Size ? Size : 1))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+// the other forms forward to these two
+TEST_NOINLINE void operator delete(void* Pointer) noexcept
+{
+  std::free(Pointer);
+}
+
+void* operator new[](std::size_t Size)
+{
+  return operator new(Size);
+}
+
+void operator delete[](void* Pointer) noexcept
+{
+  operator delete(Pointer);
+}
+
+void operator delete(void* Pointer, std::size_t) noexcept
+{
+  operator delete(Pointer);
+}
+
+void operator delete[](void* Pointer, std::size_t) noexcept
+{
+  operator delete(Pointer);
+}
+
+rtc::binary RandomMessage(std::size_t Size, unsigned Seed)
+{
+  std::mt19937 generator(Seed);
+  rtc::binary message(Size);
+  std::generate(message.begin(), message.end(), [&]() { return static_cast<std::byte>(generator()); });
+  return message;
+}
+
+int Reassembly()
+{
+  constexpr std::size_t max_message = 1024;
+  Reassembler reassembler;
+  std::mt19937 generator(11);
+  for (std::size_t size : { 0, 1, 993, 994, 1024, 5000, 1 << 20 })
+  {
+    auto message = RandomMessage(size, static_cast<unsigned>(size));
+    std::vector<rtc::binary> fragments;
+    FragmentMessage(message, max_message, static_cast<uint32_t>(size), std::byte(50), [&](rtc::binary Fragment) { fragments.push_back(std::move(Fragment)); });
+    // the data channel is ordered, but the reassembly must not depend on it
+    std::shuffle(fragments.begin(), fragments.end(), generator);
+    std::optional<rtc::binary> result;
+    for (auto& fragment : fragments)
+    {
+      if (fragment.size() > max_message || !IsFragment(fragment, std::byte(50)))
+      {
+        std::cout << "Invalid fragment for a message of size " << size << std::endl;
+        return 1;
+      }
+      if (result.has_value())
+      {
+        std::cout << "Message of size " << size << " completed early" << std::endl;
+        return 1;
+      }
+      result = reassembler.Add(fragment);
+    }
+    if (!result.has_value() || result.value() != message)
+    {
+      std::cout << "Reassembly failed for a message of size " << size << std::endl;
+      return 1;
+    }
+  }
+  if (reassembler.Pending() != 0)
+  {
+    std::cout << "Reassembler kept completed messages" << std::endl;
+    return 1;
+  }
+  // headers that do not describe a tiling of the message are dropped before anything is allocated
+  std::vector<rtc::binary> fragments;
+  FragmentMessage(RandomMessage(3000, 3), max_message, 7, std::byte(50), [&](rtc::binary Fragment) { fragments.push_back(std::move(Fragment)); });
+  auto patch = [](rtc::binary Fragment, std::size_t Offset, auto Value)
+  {
+    std::memcpy(Fragment.data() + Offset, &Value, sizeof(Value));
+    return Fragment;
+  };
+  const rtc::binary malformed[] = {
+    // far more fragments than bytes
+    patch(fragments[0], 11, std::uint32_t{ 0xFFFFFFFF }),
+    // a fragment that overlaps its predecessor
+    patch(fragments[1], 23, std::uint64_t{ max_message - FragmentHeaderSize - 1 }),
+    // a last fragment that leaves a gap before the end of the message
+    patch(fragments.back(), 23, std::uint64_t{ 2 * (max_message - FragmentHeaderSize) }) };
+  for (const auto& fragment : malformed)
+  {
+    if (reassembler.Add(fragment).has_value() || reassembler.Pending() != 0)
+    {
+      std::cout << "Reassembler accepted a malformed fragment" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int Eviction()
+{
+  // two messages fit into the table, the third one pushes out the oldest
+  Reassembler reassembler(2, 1 << 20, std::chrono::milliseconds(50));
+  std::vector<std::vector<rtc::binary>> messages(3);
+  for (uint32_t id = 0; id < 3; ++id)
+    FragmentMessage(RandomMessage(4096, id), 1024, id, std::byte(50), [&](rtc::binary Fragment) { messages[id].push_back(std::move(Fragment)); });
+  for (auto& fragments : messages)
+    reassembler.Add(fragments[0]);
+  if (reassembler.Pending() != 2 || reassembler.Evicted() != 1)
+  {
+    std::cout << "Reassembler table is not bounded" << std::endl;
+    return 1;
+  }
+  // incomplete messages time out
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  std::vector<rtc::binary> fresh;
+  FragmentMessage(RandomMessage(4096, 7), 1024, 7, std::byte(50), [&](rtc::binary Fragment) { fresh.push_back(std::move(Fragment)); });
+  reassembler.Add(fresh[0]);
+  if (reassembler.Pending() != 1 || reassembler.Evicted() != 3)
+  {
+    std::cout << "Reassembler did not evict timed out messages" << std::endl;
+    return 1;
+  }
+  // duplicates and fragments that contradict their message are ignored
+  reassembler.Add(fresh[0]);
+  auto broken = fresh[1];
+  broken[15] = std::byte(0xFF);
+  if (reassembler.Add(broken).has_value())
+  {
+    std::cout << "Reassembler accepted a malformed fragment" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int Window()
+{
+  ChunkWindow window(10, 4);
+  std::vector<std::size_t> sent;
+  auto send = [&]() { while (auto chunk = window.Next()) sent.push_back(chunk.value()); };
+  send();
+  if (sent != std::vector<std::size_t>{ 0, 1, 2, 3 })
+  {
+    std::cout << "ChunkWindow did not fill the window" << std::endl;
+    return 1;
+  }
+  // the window only moves on once its oldest chunk is acknowledged
+  window.Report(1, true);
+  send();
+  window.Report(0, true);
+  send();
+  // a missing chunk is sent again before new ones, a report for an unsent chunk is ignored
+  window.Report(3, false);
+  window.Report(3, false);
+  window.Report(8, true);
+  send();
+  // the acknowledgement of chunk 2 times out
+  window.Expire();
+  send();
+  if (sent != std::vector<std::size_t>{ 0, 1, 2, 3, 4, 5, 3, 2 } || window.Oldest() != 2 || window.Retransmissions() != 2)
+  {
+    std::cout << "ChunkWindow sent the wrong chunks" << std::endl;
+    return 1;
+  }
+  // a lossy channel drops chunks and acknowledgements, every chunk has to arrive in the end
+  std::mt19937 generator(5);
+  ChunkWindow lossy(200, 16);
+  std::vector<int> received(200, 0);
+  while (!lossy.Complete())
+  {
+    std::vector<std::size_t> reports;
+    while (auto chunk = lossy.Next())
+    {
+      if (generator() % 5 == 0)
+        continue;
+      received[chunk.value()]++;
+      if (generator() % 7 != 0)
+        reports.push_back(chunk.value());
+    }
+    if (reports.empty())
+      lossy.Expire();
+    for (auto chunk : reports)
+      lossy.Report(chunk, true);
+    // the receiver notices the gap in front of its newest chunk
+    if (!reports.empty() && !lossy.Complete() && received[lossy.Oldest()] == 0)
+      lossy.Report(lossy.Oldest(), false);
+  }
+  if (std::any_of(received.begin(), received.end(), [](int Count) { return Count == 0; }) || lossy.Retransmissions() == 0)
+  {
+    std::cout << "ChunkWindow did not recover from losses" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int Queue()
+{
+  // a channel whose buffered amount only falls when the test says so, like libdatachannel
+  // it returns false for a message it had to buffer and throws once it is closed
+  std::atomic<std::size_t> buffered{ 0 };
+  std::atomic<bool> closed{ false };
+  std::vector<std::size_t> sent;
+  SendQueue queue([&](rtc::binary Message)
+    {
+      if (closed)
+        throw std::runtime_error("Channel is closed");
+      const bool immediate = buffered == 0;
+      buffered += Message.size();
+      sent.push_back(Message.size());
+      return immediate;
+    },
+    [&]() { return buffered.load(); });
+  queue.SetLimits(2, 100);
+  auto submit = [&](std::size_t Size, bool ForceBlock = false) { return queue.Submit(rtc::binary(Size), ForceBlock); };
+  if (submit(1))
+  {
+    std::cout << "SendQueue accepted a message before it was opened" << std::endl;
+    return 1;
+  }
+  queue.Open();
+  // below the high watermark messages go straight to the channel, above it they wait,
+  // a message the channel buffered counts as sent
+  if (!submit(60) || !submit(61) || !submit(62) || !submit(63) || sent.size() != 2 || queue.Size() != 2)
+  {
+    std::cout << "SendQueue did not queue above the high watermark" << std::endl;
+    return 1;
+  }
+  queue.SetPolicy(EBackPressurePolicy::WouldBlock);
+  if (submit(64) || queue.Size() != 2)
+  {
+    std::cout << "SendQueue did not reject a message with WouldBlock" << std::endl;
+    return 1;
+  }
+  // forced and blocking producers wait for the low watermark
+  queue.SetPolicy(EBackPressurePolicy::Block);
+  auto forced = std::async(std::launch::async, [&]() { return submit(65, true); });
+  if (forced.wait_for(std::chrono::milliseconds(50)) != std::future_status::timeout)
+  {
+    std::cout << "SendQueue did not block a producer on a full queue" << std::endl;
+    return 1;
+  }
+  buffered = 0;
+  queue.Drain();
+  if (!forced.get() || sent != std::vector<std::size_t>{ 60, 61, 62, 63 } || queue.Size() != 1)
+  {
+    std::cout << "SendQueue did not drain at the low watermark" << std::endl;
+    return 1;
+  }
+  buffered = 0;
+  queue.Drain();
+  if (sent.back() != 65 || queue.Size() != 0)
+  {
+    std::cout << "SendQueue did not send in order" << std::endl;
+    return 1;
+  }
+  // a channel that refuses the message is a failure
+  buffered = 0;
+  closed = true;
+  if (submit(1))
+  {
+    std::cout << "SendQueue reported a refused message as sent" << std::endl;
+    return 1;
+  }
+  closed = false;
+  buffered = 65;
+  // closing the channel releases a waiting producer
+  submit(66);
+  submit(67);
+  submit(68);
+  auto waiting = std::async(std::launch::async, [&]() { return submit(69); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  queue.Close();
+  if (waiting.get() || queue.Size() != 0 || submit(70))
+  {
+    std::cout << "SendQueue did not release its producers on close" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+rtc::binary Widen(std::u16string_view Text)
+{
+  rtc::binary data;
+  for (auto c : Text)
+  {
+    data.push_back(static_cast<std::byte>(c & 0xFF));
+    data.push_back(static_cast<std::byte>(c >> 8));
+  }
+  return data;
+}
+
+int Scan()
+{
+  // a telemetry message of about 60 kB with braces in every part of the vector blocks
+  std::string telemetry = "xx{\"type\":\"telemetry\",\"values\":[";
+  for (int i = 0; telemetry.size() < 60000; ++i)
+    telemetry += "{\"id\":" + std::to_string(i) + ",\"v\":{\"x\":1.5}},";
+  telemetry += "{}]}trailing}";
+  const auto expected = std::string_view(telemetry).substr(2, telemetry.size() - 2 - 9);
+  auto object = FindJsonObject(telemetry);
+  if (object != expected)
+  {
+    std::cout << "FindJsonObject returned " << object.size() << " bytes instead of " << expected.size() << std::endl;
+    return 1;
+  }
+  for (std::string_view text : { "", "no braces", "{unbalanced", "}{" })
+  {
+    if (!FindJsonObject(text).empty())
+    {
+      std::cout << "FindJsonObject found an object in \"" << text << "\"" << std::endl;
+      return 1;
+    }
+  }
+  // Unreal strings are UTF-16, including characters beyond ASCII and surrogate pairs
+  auto wide = Widen(u"{\"name\":\"Bl\u00e4tter \u6797 \U0001F331\",\"padding\":\"abcdefghijklmnopqrstuvwxyz\"}");
+  std::string buffer;
+  if (!IsUtf16Text(wide) || NarrowUtf16(wide, buffer) != "{\"name\":\"Bl\u00e4tter \u6797 \U0001F331\",\"padding\":\"abcdefghijklmnopqrstuvwxyz\"}")
+  {
+    std::cout << "UTF-16 conversion failed" << std::endl;
+    return 1;
+  }
+  // the receiver gets Unreal messages framed by a message byte and their length in units,
+  // from 256 characters on the high byte of the length is no longer zero
+  std::u16string long_text = u"{\"type\":\"response\",\"padding\":\"";
+  std::string long_expected = "{\"type\":\"response\",\"padding\":\"";
+  for (int i = 0; i < 300; ++i)
+  {
+    long_text += u'\u00e4';
+    long_expected += "\u00e4";
+  }
+  long_text += u"\"}";
+  long_expected += "\"}";
+  auto framed = Widen(long_text);
+  framed.insert(framed.begin(), { std::byte(1), static_cast<std::byte>(long_text.size() & 0xFF), static_cast<std::byte>(long_text.size() >> 8) });
+  // anything behind the length is not part of the message
+  const auto trailing = Widen(u"{\"type\":\"trailing\"}");
+  framed.insert(framed.end(), trailing.begin(), trailing.end());
+  std::string narrowed;
+  if (RouteInbound(framed, std::byte(50)) != EInboundRoute::Message
+    || FindJsonObject(UnrealMessageText(framed, narrowed)) != long_expected)
+  {
+    std::cout << "Framed UTF-16 message of " << long_text.size() << " characters was not decoded" << std::endl;
+    return 1;
+  }
+  // Synavis frames UTF-8 text with its length in bytes and a terminating zero
+  const std::string_view utf8 = R"({"type":"buffer","padding":"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"})";
+  rtc::binary utf8_framed{ std::byte(1), static_cast<std::byte>(utf8.size() & 0xFF), static_cast<std::byte>(utf8.size() >> 8) };
+  for (auto c : utf8)
+    utf8_framed.push_back(static_cast<std::byte>(c));
+  utf8_framed.push_back(std::byte(0));
+  if (UnrealMessageText(utf8_framed, narrowed) != utf8)
+  {
+    std::cout << "Framed UTF-8 message was not decoded" << std::endl;
+    return 1;
+  }
+  // SendJSON of another connector frames its text the same way behind its marker byte,
+  // the receiver dispatches it like an Unreal response
+  utf8_framed[0] = std::byte(50);
+  MessageDispatcher dispatcher;
+  bool dispatched = false;
+  dispatcher.On("buffer", [&dispatched](LazyMessage&) { dispatched = true; });
+  if (RouteInbound(utf8_framed, std::byte(50)) != EInboundRoute::Message
+    || !dispatcher.Dispatch(FindJsonObject(UnrealMessageText(utf8_framed, narrowed))) || !dispatched)
+  {
+    std::cout << "Framed message of a connector was not dispatched" << std::endl;
+    return 1;
+  }
+  // a fragment carries the marker with a zero length and stays data
+  std::size_t fragments = 0;
+  const auto count = FragmentMessage(rtc::binary(300), 100, 1, std::byte(50), [&fragments](rtc::binary Fragment)
+    {
+      fragments += RouteInbound(Fragment, std::byte(50)) == EInboundRoute::Data;
+    });
+  if (fragments != count)
+  {
+    std::cout << "Fragments were routed as messages" << std::endl;
+    return 1;
+  }
+  if (IsUtf16Text(std::as_bytes(std::span(telemetry))))
+  {
+    std::cout << "UTF-8 text was detected as UTF-16" << std::endl;
+    return 1;
+  }
+  // once the buffer has grown, neither the scan nor the conversion allocate
+  auto wide_telemetry = Widen(std::u16string(telemetry.begin(), telemetry.end()));
+  NarrowUtf16(wide_telemetry, buffer);
+  const auto before = Allocations.load();
+  for (int i = 0; i < 10; ++i)
+  {
+    if (FindJsonObject(NarrowUtf16(wide_telemetry, buffer)) != expected)
+    {
+      std::cout << "Scan of the converted telemetry failed" << std::endl;
+      return 1;
+    }
+  }
+  if (Allocations.load() != before)
+  {
+    std::cout << "Inbound scan allocated " << Allocations.load() - before << " times" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int Dispatch()
+{
+  const std::string_view meter = R"({ "data":{"type":"nested","s":"}\"{"}, "values":[1,[2,3],"]"], "type" : "meter", "player_id":17})";
+  if (FindJsonString(meter, "type") != "meter" || FindJsonField(meter, "player_id") != "17"
+    || FindJsonField(meter, "values") != R"([1,[2,3],"]"])" || !FindJsonField(meter, "missing").empty())
+  {
+    std::cout << "FindJsonField did not find the top-level fields" << std::endl;
+    return 1;
+  }
+  MessageDispatcher dispatcher;
+  int meters = 0, parsed = 0;
+  dispatcher.On("meter", [&](LazyMessage&) { meters++; });
+  dispatcher.On("track", [&](LazyMessage& Message) { parsed += Message.Document()["data"]["x"].get<int>(); });
+  // a handler may change the registrations while it runs
+  dispatcher.On("once", [&](LazyMessage&) { dispatcher.Remove("once"); });
+  const auto before = Allocations.load();
+  for (int i = 0; i < 100; ++i)
+    dispatcher.Dispatch(meter);
+  if (meters != 100 || Allocations.load() != before)
+  {
+    std::cout << "Dispatching without a document allocated or missed messages" << std::endl;
+    return 1;
+  }
+  if (!dispatcher.Dispatch(R"({"type":"track","data":{"x":4}})") || parsed != 4
+    || !dispatcher.Dispatch(R"({"type":"once"})") || dispatcher.Dispatch(R"({"type":"once"})")
+    || dispatcher.Dispatch(R"({"type":"unknown"})") || dispatcher.Dispatch("not json"))
+  {
+    std::cout << "Dispatcher called the wrong handlers" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int Requests()
+{
+  RequestTracker tracker;
+  auto [first, first_reply] = tracker.Open(5.0);
+  auto [second, second_reply] = tracker.Open(5.0);
+  auto reply = [](int Id) { return "{\"type\":\"reply\",\"player_id\":" + std::to_string(Id) + ",\"value\":" + std::to_string(Id * 10) + "}"; };
+  // replies arrive in any order and are matched by their player_id
+  const auto second_text = reply(second);
+  if (first == second || !tracker.Resolve(LazyMessage(second_text)) || tracker.Resolve(LazyMessage(second_text))
+    || tracker.Resolve(LazyMessage(reply(second + 100))) || tracker.Resolve(LazyMessage(R"({"type":"reply"})")))
+  {
+    std::cout << "RequestTracker matched the wrong replies" << std::endl;
+    return 1;
+  }
+  if (second_reply.wait_for(std::chrono::seconds(0)) != std::future_status::ready || second_reply.get()["value"] != second * 10
+    || first_reply.wait_for(std::chrono::seconds(0)) == std::future_status::ready || tracker.Outstanding() != 1)
+  {
+    std::cout << "RequestTracker did not resolve the right request" << std::endl;
+    return 1;
+  }
+  auto failed = [](std::future<nlohmann::json>& Reply)
+  {
+    try
+    {
+      Reply.get();
+      return false;
+    }
+    catch (const std::runtime_error&)
+    {
+      return true;
+    }
+  };
+  // a request that is not answered in time fails, the others keep waiting
+  auto [late, late_reply] = tracker.Open(0.05);
+  if (late_reply.wait_for(std::chrono::seconds(5)) != std::future_status::ready || !failed(late_reply)
+    || tracker.Outstanding() != 1 || tracker.Resolve(LazyMessage(reply(late))))
+  {
+    std::cout << "RequestTracker did not time out a request" << std::endl;
+    return 1;
+  }
+  tracker.Fail(first, "Could not send the request");
+  auto [pending, pending_reply] = tracker.Open(10.0);
+  tracker.Stop();
+  if (!failed(first_reply) || !failed(pending_reply) || tracker.Outstanding() != 0)
+  {
+    std::cout << "RequestTracker left requests unresolved" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int Telemetry()
+{
+  TelemetryCache cache;
+  auto track = [](double X) { return nlohmann::json{ {"type", "track"}, {"data", {{"drone.Position", {X, 0.0, 1.0}}, {"drone.Speed", X}}} }; };
+  // the unordered channel delivers sequence 3 before 2
+  if (cache.Apply(track(1.0), 1) != 2 || cache.Apply(track(3.0), 3) != 2 || cache.Apply(track(2.0), 2) != 0)
+  {
+    std::cout << "TelemetryCache applied a stale update" << std::endl;
+    return 1;
+  }
+  if (cache.Get("drone.Speed")->Data != 3.0 || cache.Get("drone.Speed")->Sequence != 3 || cache.Dropped() != 2
+    || cache.Snapshot()["drone.Position"][0] != 3.0 || cache.Get("missing").has_value())
+  {
+    std::cout << "TelemetryCache does not hold the latest values" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int Compression()
+{
+  // vertex data repeats a lot, random data does not compress at all
+  std::vector<std::uint8_t> vertices(200000);
+  for (std::size_t i = 0; i < vertices.size(); ++i)
+    vertices[i] = static_cast<std::uint8_t>((i % 12 < 8) ? (i / 96) % 7 : i % 12);
+  const auto noise = RandomMessage(70000, 7);
+  const std::span<const std::uint8_t> random(reinterpret_cast<const std::uint8_t*>(noise.data()), noise.size());
+  for (auto level : { ECompression::None, ECompression::Fast, ECompression::Strong })
+  {
+    for (std::span<const std::uint8_t> source : { std::span<const std::uint8_t>(vertices), random, random.first(3), random.first(0) })
+    {
+      std::vector<std::uint8_t> block(CompressBound(source.size()));
+      const auto size = Synavis::Compress(source, block.data(), block.size(), level);
+      std::vector<std::uint8_t> restored(source.size());
+      if (size == 0 || !Decompress(std::span(block).first(size), restored.data(), restored.size())
+        || !std::equal(restored.begin(), restored.end(), source.begin()))
+      {
+        std::cout << "Compression did not restore " << source.size() << " bytes" << std::endl;
+        return 1;
+      }
+      if (level != ECompression::None && source.size() == vertices.size() && size > source.size() / 4)
+      {
+        std::cout << "Compression only reached " << size << " bytes" << std::endl;
+        return 1;
+      }
+      // a block that does not fit is refused instead of truncated
+      if (source.size() == random.size() && Synavis::Compress(source, block.data(), source.size() * 9 / 10, level) != 0)
+      {
+        std::cout << "Compression exceeded the capacity" << std::endl;
+        return 1;
+      }
+    }
+  }
+  std::vector<std::uint8_t> block(CompressBound(vertices.size()));
+  const auto size = Synavis::Compress(vertices, block.data(), block.size(), ECompression::Fast);
+  std::vector<std::uint8_t> restored(vertices.size());
+  if (Decompress(std::span(block).first(size - 1), restored.data(), restored.size())
+    || Decompress(std::span(block).first(size), restored.data(), restored.size() - 1))
+  {
+    std::cout << "Decompress accepted a damaged block" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  if (Reassembly() != 0)
+  {
+    return 1;
+  }
+  if (Eviction() != 0)
+  {
+    return 1;
+  }
+  if (Queue() != 0)
+  {
+    return 1;
+  }
+  if (Window() != 0)
+  {
+    return 1;
+  }
+  if (Scan() != 0)
+  {
+    return 1;
+  }
+  if (Dispatch() != 0)
+  {
+    return 1;
+  }
+  if (Requests() != 0)
+  {
+    return 1;
+  }
+  if (Telemetry() != 0)
+  {
+    return 1;
+  }
+  if (Compression() != 0)
+  {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,353 @@
+#include "Synavis.hpp"
+
+#include <array>
+#include <cstring>
+
+// the vectorized paths are only available on x86, everything else uses the scalar code
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SYNAVIS_BASE64_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows intrinsics of any instruction set in every function
+#define SYNAVIS_TARGET(x)
+#else
+#define SYNAVIS_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace
+{
+  constexpr char EncodeTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  // 0xFF marks characters that are not part of the base64 alphabet
+  constexpr std::array<uint8_t, 256> MakeDecodeTable()
+  {
+    std::array<uint8_t, 256> table{};
+    for (auto& v : table) v = 0xFF;
+    for (uint8_t i = 0; i < 64; ++i)
+      table[static_cast<uint8_t>(EncodeTable[i])] = i;
+    return table;
+  }
+  constexpr std::array<uint8_t, 256> DecodeTable = MakeDecodeTable();
+
+  std::size_t EncodeScalar(const uint8_t* Source, std::size_t Length, char* Destination)
+  {
+    char* c = Destination;
+    std::size_t i = 0;
+    for (; i + 2 < Length; i += 3)
+    {
+      *c++ = EncodeTable[(Source[i] >> 2) & 0x3F];
+      *c++ = EncodeTable[((Source[i] & 0x3) << 4) | (Source[i + 1] >> 4)];
+      *c++ = EncodeTable[((Source[i + 1] & 0xF) << 2) | (Source[i + 2] >> 6)];
+      *c++ = EncodeTable[Source[i + 2] & 0x3F];
+    }
+    if (i < Length)
+    {
+      *c++ = EncodeTable[(Source[i] >> 2) & 0x3F];
+      if (i == (Length - 1))
+      {
+        *c++ = EncodeTable[((Source[i] & 0x3) << 4)];
+        *c++ = '=';
+      }
+      else
+      {
+        *c++ = EncodeTable[((Source[i] & 0x3) << 4) | (Source[i + 1] >> 4)];
+        *c++ = EncodeTable[((Source[i + 1] & 0xF) << 2)];
+      }
+      *c++ = '=';
+    }
+    return static_cast<std::size_t>(c - Destination);
+  }
+
+  // decodes complete or padded quadruples, Length has to be the length without trailing padding
+  bool DecodeScalar(const char* Source, std::size_t Length, uint8_t* Destination, std::size_t& Written)
+  {
+    const auto* s = reinterpret_cast<const uint8_t*>(Source);
+    uint8_t* d = Destination;
+    std::size_t i = 0;
+    for (; i + 3 < Length; i += 4)
+    {
+      const uint32_t a = DecodeTable[s[i]], b = DecodeTable[s[i + 1]], c = DecodeTable[s[i + 2]], e = DecodeTable[s[i + 3]];
+      if ((a | b | c | e) & 0x80)
+        return false;
+      const uint32_t v = (a << 18) | (b << 12) | (c << 6) | e;
+      *d++ = static_cast<uint8_t>(v >> 16);
+      *d++ = static_cast<uint8_t>(v >> 8);
+      *d++ = static_cast<uint8_t>(v);
+    }
+    const std::size_t rest = Length - i;
+    if (rest == 1)
+    {
+      return false;
+    }
+    else if (rest > 1)
+    {
+      const uint32_t a = DecodeTable[s[i]], b = DecodeTable[s[i + 1]];
+      const uint32_t c = (rest == 3) ? DecodeTable[s[i + 2]] : 0;
+      if ((a | b | c) & 0x80)
+        return false;
+      *d++ = static_cast<uint8_t>((a << 2) | (b >> 4));
+      if (rest == 3)
+        *d++ = static_cast<uint8_t>((b << 4) | (c >> 2));
+    }
+    Written = static_cast<std::size_t>(d - Destination);
+    return true;
+  }
+
+#ifdef SYNAVIS_BASE64_X86
+  // The vectorized codecs follow the approach of W. Mula and D. Lemire,
+  // "Faster Base64 Encoding and Decoding Using AVX2 Instructions" (2018).
+  // Bytes are spread into 6-bit indices with multiply-shift tricks and translated
+  // to ASCII with a single pshufb lookup of offsets, decoding inverts this.
+
+  SYNAVIS_TARGET("ssse3")
+  inline __m128i EncodeLookup128(__m128i indices)
+  {
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(shift, result), indices);
+  }
+
+  SYNAVIS_TARGET("ssse3")
+  std::size_t EncodeSSSE3(const uint8_t* Source, std::size_t Length, char* Destination)
+  {
+    const __m128i shuffle = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    std::size_t i = 0;
+    char* c = Destination;
+    // 12 bytes are consumed per iteration but 16 are loaded
+    for (; i + 16 <= Length; i += 12, c += 16)
+    {
+      __m128i in = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + i)), shuffle);
+      const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+      const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+      const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+      const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(c), EncodeLookup128(_mm_or_si128(t1, t3)));
+    }
+    return static_cast<std::size_t>(c - Destination) + EncodeScalar(Source + i, Length - i, c);
+  }
+
+  SYNAVIS_TARGET("avx2")
+  std::size_t EncodeAVX2(const uint8_t* Source, std::size_t Length, char* Destination)
+  {
+    const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i shift = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    std::size_t i = 0;
+    char* c = Destination;
+    // 24 bytes are consumed per iteration, the second lane loads from offset 12
+    for (; i + 28 <= Length; i += 24, c += 32)
+    {
+      const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + i));
+      const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + i + 12));
+      __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+      in = _mm256_shuffle_epi8(in, shuffle);
+      const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+      const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+      const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+      const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+      const __m256i indices = _mm256_or_si256(t1, t3);
+      __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+      const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+      result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+      result = _mm256_add_epi8(_mm256_shuffle_epi8(shift, result), indices);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(c), result);
+    }
+    return static_cast<std::size_t>(c - Destination) + EncodeSSSE3(Source + i, Length - i, c);
+  }
+
+  SYNAVIS_TARGET("ssse3")
+  bool DecodeSSSE3(const char* Source, std::size_t Length, uint8_t* Destination, std::size_t& Written)
+  {
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2F);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    std::size_t i = 0;
+    uint8_t* d = Destination;
+    // 16 bytes are stored per 12 decoded bytes, so we stop early enough for the output to have room
+    for (; i + 24 <= Length; i += 16, d += 12)
+    {
+      __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + i));
+      const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask_2f);
+      const __m128i lo_nibbles = _mm_and_si128(in, mask_2f);
+      const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+      const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+      // invalid characters are handed to the scalar code, which reports them
+      if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0)
+        break;
+      const __m128i eq_2f = _mm_cmpeq_epi8(in, mask_2f);
+      const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+      in = _mm_add_epi8(in, roll);
+      const __m128i merged = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+      const __m128i out = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_shuffle_epi8(out, pack));
+    }
+    std::size_t rest = 0;
+    if (!DecodeScalar(Source + i, Length - i, d, rest))
+      return false;
+    Written = static_cast<std::size_t>(d - Destination) + rest;
+    return true;
+  }
+
+  SYNAVIS_TARGET("avx2")
+  bool DecodeAVX2(const char* Source, std::size_t Length, uint8_t* Destination, std::size_t& Written)
+  {
+    const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+    std::size_t i = 0;
+    uint8_t* d = Destination;
+    // 32 bytes are stored per 24 decoded bytes
+    for (; i + 48 <= Length; i += 32, d += 24)
+    {
+      __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Source + i));
+      const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask_2f);
+      const __m256i lo_nibbles = _mm256_and_si256(in, mask_2f);
+      const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+      const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+      if (!_mm256_testz_si256(lo, hi))
+        break;
+      const __m256i eq_2f = _mm256_cmpeq_epi8(in, mask_2f);
+      const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+      in = _mm256_add_epi8(in, roll);
+      const __m256i merged = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+      __m256i out = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+      out = _mm256_shuffle_epi8(out, pack);
+      out = _mm256_permutevar8x32_epi32(out, lanes);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), out);
+    }
+    std::size_t rest = 0;
+    if (!DecodeSSSE3(Source + i, Length - i, d, rest))
+      return false;
+    Written = static_cast<std::size_t>(d - Destination) + rest;
+    return true;
+  }
+
+  enum class EInstructionSet { Scalar, SSSE3, AVX2 };
+
+  EInstructionSet DetectInstructionSet()
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    if (max_leaf < 1)
+      return EInstructionSet::Scalar;
+    __cpuid(info, 1);
+    const bool ssse3 = (info[2] & (1 << 9)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx2 = false;
+    if (max_leaf >= 7 && osxsave && (_xgetbv(0) & 0x6) == 0x6)
+    {
+      __cpuidex(info, 7, 0);
+      avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    const bool ssse3 = __builtin_cpu_supports("ssse3");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return EInstructionSet::AVX2;
+    if (ssse3) return EInstructionSet::SSSE3;
+    return EInstructionSet::Scalar;
+  }
+#endif
+
+  struct Base64Kernels
+  {
+    std::size_t(*Encode)(const uint8_t*, std::size_t, char*) = &EncodeScalar;
+    bool(*Decode)(const char*, std::size_t, uint8_t*, std::size_t&) = &DecodeScalar;
+    std::string_view Name = "scalar";
+  };
+
+  // the dispatch is resolved once on first use
+  const Base64Kernels& Kernels()
+  {
+    static const Base64Kernels kernels = []()
+    {
+      Base64Kernels k;
+#ifdef SYNAVIS_BASE64_X86
+      switch (DetectInstructionSet())
+      {
+      case EInstructionSet::AVX2:
+        k.Encode = &EncodeAVX2;
+        k.Decode = &DecodeAVX2;
+        k.Name = "avx2";
+        break;
+      case EInstructionSet::SSSE3:
+        k.Encode = &EncodeSSSE3;
+        k.Decode = &DecodeSSSE3;
+        k.Name = "ssse3";
+        break;
+      default:
+        break;
+      }
+#endif
+      return k;
+    }();
+    return kernels;
+  }
+}
+
+std::size_t Synavis::Encode64Into(const uint8_t* Source, std::size_t Length, char* Destination)
+{
+  return Kernels().Encode(Source, Length, Destination);
+}
+
+std::size_t Synavis::DecodedSize(std::string_view Encoded)
+{
+  std::size_t padding = 0;
+  while (padding < 2 && Encoded.size() > padding && Encoded[Encoded.size() - 1 - padding] == '=')
+    ++padding;
+  const std::size_t length = Encoded.size() - padding;
+  return (length / 4) * 3 + ((length % 4) ? (length % 4) - 1 : 0);
+}
+
+bool Synavis::Decode64Into(std::string_view Encoded, uint8_t* Destination, std::size_t& Written)
+{
+  // trailing padding is not part of the payload
+  std::size_t length = Encoded.size();
+  while (length > 0 && Encoded.size() - length < 2 && Encoded[length - 1] == '=')
+    --length;
+  Written = 0;
+  return Kernels().Decode(Encoded.data(), length, Destination, Written);
+}
+
+std::vector<uint8_t> Synavis::Decode64(std::string_view Encoded)
+{
+  std::vector<uint8_t> result(DecodedSize(Encoded));
+  std::size_t written = 0;
+  if (!Decode64Into(Encoded, result.data(), written))
+  {
+    throw std::runtime_error("Decode64: input is not valid base64");
+  }
+  result.resize(written);
+  return result;
+}
+
+std::string_view Synavis::Base64Implementation()
+{
+  return Kernels().Name;
+}
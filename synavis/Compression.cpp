@@ -0,0 +1,258 @@
+#include "Compression.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  constexpr std::size_t MinMatch = 4;
+  constexpr std::size_t MaxOffset = 65535;
+  // Fast keeps its table small enough for the L1/L2 cache, Strong also needs a chain
+  // link for every position of the window
+  constexpr unsigned FastHashBits = 14;
+  constexpr unsigned StrongHashBits = 16;
+  constexpr unsigned StrongAttempts = 64;
+
+  std::uint32_t Read32(const std::uint8_t* Data)
+  {
+    std::uint32_t value;
+    std::memcpy(&value, Data, sizeof(value));
+    return value;
+  }
+
+  std::uint32_t Hash(std::uint32_t Value, unsigned Bits)
+  {
+    return (Value * 2654435761u) >> (32 - Bits);
+  }
+
+  // length of the common prefix of Earlier and Current, Current may not pass End
+  std::size_t MatchLength(const std::uint8_t* Earlier, const std::uint8_t* Current, const std::uint8_t* End)
+  {
+    const std::uint8_t* start = Current;
+    while (Current + sizeof(std::uint64_t) <= End)
+    {
+      std::uint64_t a, b;
+      std::memcpy(&a, Earlier, sizeof(a));
+      std::memcpy(&b, Current, sizeof(b));
+      if (const std::uint64_t difference = a ^ b)
+      {
+        const int bits = (std::endian::native == std::endian::little) ? std::countr_zero(difference) : std::countl_zero(difference);
+        return static_cast<std::size_t>(Current - start) + static_cast<std::size_t>(bits / 8);
+      }
+      Earlier += sizeof(a);
+      Current += sizeof(b);
+    }
+    while (Current < End && *Earlier == *Current)
+    {
+      ++Earlier;
+      ++Current;
+    }
+    return static_cast<std::size_t>(Current - start);
+  }
+
+  class BlockWriter
+  {
+  public:
+    BlockWriter(std::uint8_t* Data, std::size_t Capacity) : Data(Data), Capacity(Capacity) {}
+    // a match length of 0 writes the closing entry that only holds literals
+    bool Write(const std::uint8_t* Literals, std::size_t LiteralLength, std::size_t Offset, std::size_t MatchLength)
+    {
+      const std::size_t match_code = (MatchLength > 0) ? MatchLength - MinMatch : 0;
+      const std::size_t needed = 1 + (LiteralLength / 255 + 1) + LiteralLength + ((MatchLength > 0) ? 2 + match_code / 255 + 1 : 0);
+      if (needed > Capacity - Size)
+        return false;
+      Data[Size++] = static_cast<std::uint8_t>((std::min<std::size_t>(LiteralLength, 15) << 4) | std::min<std::size_t>(match_code, 15));
+      if (LiteralLength >= 15)
+        Extend(LiteralLength - 15);
+      if (LiteralLength > 0)
+        std::memcpy(Data + Size, Literals, LiteralLength);
+      Size += LiteralLength;
+      if (MatchLength > 0)
+      {
+        Data[Size++] = static_cast<std::uint8_t>(Offset & 0xFF);
+        Data[Size++] = static_cast<std::uint8_t>(Offset >> 8);
+        if (match_code >= 15)
+          Extend(match_code - 15);
+      }
+      return true;
+    }
+    std::size_t Written() const { return Size; }
+  private:
+    void Extend(std::size_t Value)
+    {
+      for (; Value >= 255; Value -= 255)
+        Data[Size++] = 255;
+      Data[Size++] = static_cast<std::uint8_t>(Value);
+    }
+    std::uint8_t* Data;
+    std::size_t Capacity;
+    std::size_t Size{ 0 };
+  };
+
+  // reads a 255-run extension of a length
+  bool ReadExtension(std::span<const std::uint8_t> Source, std::size_t& i, std::size_t& Length)
+  {
+    std::uint8_t value;
+    do
+    {
+      if (i >= Source.size())
+        return false;
+      value = Source[i++];
+      Length += value;
+    } while (value == 255);
+    return true;
+  }
+}
+
+std::size_t Synavis::CompressBound(std::size_t Size)
+{
+  return 1 + Size / 255 + 1 + Size;
+}
+
+std::size_t Synavis::Compress(std::span<const std::uint8_t> Source, std::uint8_t* Destination, std::size_t Capacity, ECompression Level)
+{
+  const std::uint8_t* base = Source.data();
+  const std::size_t size = Source.size();
+  const std::uint8_t* end = base + size;
+  BlockWriter block(Destination, Capacity);
+  std::size_t anchor = 0;
+  if (Level != ECompression::None && size > MinMatch)
+  {
+    const bool strong = (Level == ECompression::Strong);
+    const unsigned bits = strong ? StrongHashBits : FastHashBits;
+    // positions are stored plus one, so that a zeroed table is empty. The tables are
+    // kept per thread to compress chunk after chunk without allocating
+    thread_local std::vector<std::uint32_t> head;
+    thread_local std::vector<std::uint32_t> chain;
+    head.assign(std::size_t{ 1 } << bits, 0);
+    if (strong)
+      chain.resize(MaxOffset + 1);
+    auto insert = [&](std::size_t Position)
+    {
+      auto& entry = head[Hash(Read32(base + Position), bits)];
+      if (strong)
+        chain[Position & MaxOffset] = entry;
+      entry = static_cast<std::uint32_t>(Position + 1);
+    };
+    auto find = [&](std::size_t Position, std::size_t& Offset) -> std::size_t
+    {
+      const std::uint32_t sequence = Read32(base + Position);
+      std::uint32_t candidate = head[Hash(sequence, bits)];
+      std::size_t best = 0;
+      for (unsigned attempts = strong ? StrongAttempts : 1; candidate != 0 && attempts > 0; --attempts)
+      {
+        const std::size_t earlier = candidate - 1;
+        if (Position - earlier > MaxOffset)
+          break;
+        if (Read32(base + earlier) == sequence)
+        {
+          const std::size_t length = MatchLength(base + earlier, base + Position, end);
+          if (length > best)
+          {
+            best = length;
+            Offset = Position - earlier;
+          }
+        }
+        // links of positions further back than the window may be overwritten already,
+        // these are caught by the distance check above
+        candidate = strong ? chain[earlier & MaxOffset] : 0;
+      }
+      return best;
+    };
+    std::size_t position = 0;
+    while (position + MinMatch <= size)
+    {
+      std::size_t offset = 0;
+      std::size_t length = find(position, offset);
+      if (length < MinMatch)
+      {
+        insert(position);
+        // without matches the search speeds up, incompressible data is skipped quickly
+        position += strong ? 1 : 1 + ((position - anchor) >> 6);
+        continue;
+      }
+      insert(position);
+      // Strong defers the match while the next position has a longer one
+      while (strong && position + 1 + MinMatch <= size)
+      {
+        std::size_t next_offset = 0;
+        const std::size_t next_length = find(position + 1, next_offset);
+        if (next_length <= length)
+          break;
+        insert(++position);
+        length = next_length;
+        offset = next_offset;
+      }
+      if (!block.Write(base + anchor, position - anchor, offset, length))
+        return 0;
+      const std::size_t match_end = position + length;
+      if (strong)
+      {
+        for (std::size_t covered = position + 1; covered < match_end && covered + MinMatch <= size; ++covered)
+          insert(covered);
+      }
+      else if (match_end >= 2 && match_end - 2 > position && match_end + 2 <= size)
+      {
+        insert(match_end - 2);
+      }
+      position = match_end;
+      anchor = position;
+    }
+  }
+  if (!block.Write(base + anchor, size - anchor, 0, 0))
+    return 0;
+  return block.Written();
+}
+
+bool Synavis::Decompress(std::span<const std::uint8_t> Source, std::uint8_t* Destination, std::size_t Size)
+{
+  std::size_t i = 0, written = 0;
+  // a block that ends without its closing entry was cut off
+  while (i < Source.size())
+  {
+    const std::uint8_t token = Source[i++];
+    std::size_t literals = token >> 4;
+    if (literals == 15 && !ReadExtension(Source, i, literals))
+      return false;
+    if (literals > Source.size() - i || literals > Size - written)
+      return false;
+    if (literals > 0)
+      std::memcpy(Destination + written, Source.data() + i, literals);
+    i += literals;
+    written += literals;
+    // the closing entry has no match
+    if (i == Source.size())
+      return written == Size;
+    if (Source.size() - i < 2)
+      return false;
+    const std::size_t offset = static_cast<std::size_t>(Source[i]) | (static_cast<std::size_t>(Source[i + 1]) << 8);
+    i += 2;
+    std::size_t length = token & 0x0F;
+    if (length == 15 && !ReadExtension(Source, i, length))
+      return false;
+    length += MinMatch;
+    if (offset == 0 || offset > written || length > Size - written)
+      return false;
+    std::uint8_t* target = Destination + written;
+    const std::uint8_t* match = target - offset;
+    if (offset >= length)
+    {
+      std::memcpy(target, match, length);
+    }
+    else
+    {
+      // overlapping matches repeat the last offset bytes
+      for (std::size_t k = 0; k < length; ++k)
+        target[k] = match[k];
+    }
+    written += length;
+  }
+  return false;
+}
+
+const char* Synavis::CompressionName(ECompression Level)
+{
+  return (Level == ECompression::None) ? "none" : "lz";
+}
@@ -0,0 +1,38 @@
+#ifndef SYNAVIS_COMPRESSION_HPP
+#define SYNAVIS_COMPRESSION_HPP
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include "Synavis.hpp"
+
+namespace Synavis
+{
+  // A byte-oriented LZ77 block codec in the spirit of LZ4. Every block is compressed on
+  // its own, so buffers can be compressed and decompressed chunk by chunk. A block is a
+  // sequence of [token][literal length][literals][offset][match length] entries, where
+  // the high nibble of the token holds the literal length and the low one the match length
+  // minus four, both extended by 255-runs. The last entry has literals only. Offsets are
+  // 16-bit little endian, matches reach back at most 65535 bytes.
+
+  // the largest possible block for Size input bytes
+  SYNAVIS_EXPORT std::size_t CompressBound(std::size_t Size);
+
+  // Compresses Source into Destination and returns the size of the block. Fast uses one
+  // candidate per position, Strong searches a hash chain and defers matches by one byte
+  // if the next position has a longer one.
+  // \return 0 if the block would not fit into Capacity bytes, Source is not compressed
+  // enough for this capacity then
+  SYNAVIS_EXPORT std::size_t Compress(std::span<const std::uint8_t> Source, std::uint8_t* Destination, std::size_t Capacity, ECompression Level = ECompression::Fast);
+
+  // Decompresses a block into exactly Size bytes. Malformed blocks never write outside
+  // of the destination.
+  // \return false if the block is malformed or does not decompress to Size bytes
+  SYNAVIS_EXPORT bool Decompress(std::span<const std::uint8_t> Source, std::uint8_t* Destination, std::size_t Size);
+
+  // the name of the codec in buffer start messages
+  SYNAVIS_EXPORT const char* CompressionName(ECompression Level);
+}
+
+#endif
@@ -5,6 +5,10 @@
 #include <locale>
 #include <bit>
 #include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include <charconv>
+#include <climits>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -22,14 +26,45 @@ inline constexpr std::byte operator "" _b(unsigned long long i) noexcept
 }
 
 Synavis::DataConnector::DataConnector()
+  : Outgoing([this](rtc::binary Message) { MainCounters.Sent(Message.size()); return DataChannel->send(std::move(Message)); },
+    [this]() { return DataChannel->bufferedAmount(); })
 {
+  // coalesced messages are unpacked and every part is delivered on its own
+  MessageHandlers.On("multi", [this](LazyMessage& Message)
+    {
+      const auto& content = Message.Document();
+      if (!content.contains("messages") || !content["messages"].is_array())
+        return;
+      for (auto& part : content["messages"])
+        DeliverMessage(part.dump());
+    });
+  // the receiver of shared geometry freed a slot
+  MessageHandlers.On("sharedrelease", [this](LazyMessage& Message)
+    {
+      const auto name = FindJsonString(Message.Text(), "ring");
+      std::unique_lock<std::mutex> lock(SharedRingLock);
+      auto entry = SharedRings.find(std::string(name));
+      if (entry == SharedRings.end())
+        return;
+      if (auto ring = entry->second.lock())
+        ring->NotifyReleased();
+      else
+        SharedRings.erase(entry);
+    });
 }
 
 Synavis::DataConnector::~DataConnector()
 {
+  SetMessageCoalescing(false);
+  Requests.Stop();
   SignallingServer->close();
   PeerConnection->close();
+  TransferHandler.Stop();
   SubmissionHandler.Stop();
+  for (auto& target : Stripes)
+    target->Channel->close();
+  if (TelemetryChannel)
+    TelemetryChannel->close();
   DataChannel->close();
 }
 
@@ -38,45 +73,43 @@ void Synavis::DataConnector::StartSignalling()
   std::string address = "ws://" + config_["SignallingIP"].get<std::string>()
     + ":" + std::to_string(config_["SignallingPort"].get<unsigned>());
   lconnector(ELogVerbosity::Info) << "Starting Signalling to " << address << std::endl;
-  state_ = EConnectionState::STARTUP;
+  State.Set(EConnectionState::STARTUP);
   SignallingServer->open(address);
-  while (Block && state_ < EConnectionState::SIGNUP)
-  {
-    std::this_thread::yield();
-  }
+  if (Block)
+    State.WaitFor(EConnectionState::SIGNUP);
 }
 
-void Synavis::DataConnector::SendData(rtc::binary Data)
+bool Synavis::DataConnector::SendData(rtc::binary Data)
 {
-  if (this->state_ != EConnectionState::CONNECTED)
-    return;
+  if (State.Get() != EConnectionState::CONNECTED)
+    return false;
+  FlushMessages();
   if (Data.size() > this->MaxMessageSize)
   {
-    rtc::binary Chunk(this->MaxMessageSize);
-    const auto meta_size = sizeof(int) + sizeof(int) + sizeof(uint16_t) + sizeof(std::byte);
-    unsigned int chunks{ 1 };
-    for (; (meta_size * chunks + Data.size()) / chunks < this->MaxMessageSize; ++chunks);
-
-    // iterate through the chunks
-    for (auto i = 0u; i < chunks; ++i)
+    std::vector<std::shared_ptr<Stripe>> targets;
     {
-      std::size_t n = 0u;
-      n = InsertIntoBinary(Chunk, n, std::byte(50), uint16_t(0));
-      n = InsertIntoBinary(Chunk, n, i, chunks);
-      memcpy(Chunk.data() + n, Data.data() + i * chunks, this->MaxMessageSize - meta_size);
-      DataChannel->sendBuffer(Chunk);
+      std::unique_lock<std::mutex> lock(StripeLock);
+      std::copy_if(Stripes.begin(), Stripes.end(), std::back_inserter(targets), [](const auto& Target) { return Target->Channel->isOpen(); });
     }
+    if (!targets.empty())
+      return SendStriped(Data, targets);
+    // a message must not be torn apart, so the fragments wait for the queue
+    bool accepted = true;
+    FragmentMessage(Data, this->MaxMessageSize, NextMessageId++, DataChannelByte,
+      [this, &accepted](rtc::binary Fragment) { accepted = SubmitMessage(std::move(Fragment), true) && accepted; });
+    return accepted;
   }
   else
   {
-    DataChannel->sendBuffer(Data);
+    return SubmitMessage(std::move(Data));
   }
 }
 
-void Synavis::DataConnector::SendString(std::string Message)
+bool Synavis::DataConnector::SendString(std::string Message)
 {
-  if (this->state_ != EConnectionState::CONNECTED)
-    return;
+  if (State.Get() != EConnectionState::CONNECTED)
+    return false;
+  FlushMessages();
   json content = { {"origin","dataconnector"},{"data",Message} };
   std::string json_message = content.dump();
   // prepare bytes that Unreal expects at the beginning of the message
@@ -92,156 +125,550 @@ void Synavis::DataConnector::SendString(std::string Message)
     //bytes.at(3 + 2 * i + 1) = 0_b;
     bytes.at(3 + i) = static_cast<std::byte>(json_message.at(i));
   }
-  DataChannel->sendBuffer(bytes);
+  return SubmitMessage(std::move(bytes));
 }
 
-void Synavis::DataConnector::SendJSON(json Message)
+rtc::binary Synavis::DataConnector::FrameMessage(std::string_view Message)
 {
-  if (this->state_ != EConnectionState::CONNECTED)
-    return;
-  std::string json_message = Message.dump();
   // prepare bytes that Unreal expects at the beginning of the message
-  rtc::binary bytes(4 + json_message.length());
+  rtc::binary bytes(4 + Message.length());
   bytes[bytes.size() - 1] = std::byte(0);
   bytes.at(0) = DataChannelByte;
   uint16_t* buffer = reinterpret_cast<uint16_t*>(&(bytes.at(1)));
-  *buffer = static_cast<uint16_t>(json_message.size());
+  *buffer = static_cast<uint16_t>(Message.size());
 
   // copy the json string into the buffer
-  memcpy(bytes.data() + 3, json_message.data(), json_message.size());
+  memcpy(bytes.data() + 3, Message.data(), Message.size());
+  return bytes;
+}
+
+bool Synavis::DataConnector::SendJSON(json Message)
+{
+  if (State.Get() != EConnectionState::CONNECTED)
+    return false;
+  std::string json_message = Message.dump();
+  if (CoalesceMessages)
+  {
+    std::unique_lock<std::mutex> lock(CoalesceLock);
+    while (!CoalesceBuffer.empty() && CoalesceBuffer.size() + json_message.size() + 1 > CoalesceMaxBytes)
+    {
+      lock.unlock();
+      FlushCoalesced();
+      lock.lock();
+    }
+    if (CoalesceBuffer.empty())
+    {
+      CoalesceDeadline = std::chrono::steady_clock::now() + CoalesceDelay;
+      CoalesceCondition.notify_all();
+    }
+    else
+    {
+      CoalesceBuffer += ',';
+    }
+    CoalesceBuffer += json_message;
+    CoalescedMessages++;
+    const bool full = CoalesceBuffer.size() >= CoalesceMaxBytes;
+    lock.unlock();
+    // otherwise the message is only accepted, a later flush may still fail to send it
+    return full ? FlushCoalesced() : true;
+  }
+  lconnector(ELogVerbosity::Info) << "Sending JSON: " << json_message << std::endl;
+  return SubmitMessage(FrameMessage(json_message));
+}
+
+void Synavis::DataConnector::SetMessageCoalescing(bool Coalesce, double Delay, std::size_t MaxBytes)
+{
+  std::unique_lock<std::mutex> lock(CoalesceLock);
+  CoalesceDelay = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(Delay));
+  // the coalesced message has to fit into a single message with a 16 bit length
+  constexpr std::size_t envelope = 64;
+  CoalesceMaxBytes = std::min({ MaxBytes, static_cast<std::size_t>(UINT16_MAX) - envelope, MaxMessageSize - envelope });
+  if (Coalesce == CoalesceMessages)
+    return;
+  CoalesceMessages = Coalesce;
+  if (Coalesce)
+  {
+    CoalesceThread = std::async(std::launch::async, &DataConnector::CoalesceRun, this);
+  }
+  else
+  {
+    CoalesceCondition.notify_all();
+    lock.unlock();
+    CoalesceThread.wait();
+    FlushCoalesced();
+  }
+}
+
+void Synavis::DataConnector::FlushMessages()
+{
+  if (!CoalesceMessages)
+    return;
+  FlushCoalesced();
+}
+
+std::optional<rtc::binary> Synavis::DataConnector::TakeCoalescedLocked()
+{
+  if (CoalesceBuffer.empty())
+    return std::nullopt;
+  lconnector(ELogVerbosity::Verbose) << "Sending " << CoalescedMessages << " coalesced messages" << std::endl;
+  auto frame = (CoalescedMessages == 1) ? FrameMessage(CoalesceBuffer)
+    : FrameMessage("{\"type\":\"multi\",\"messages\":[" + CoalesceBuffer + "]}");
+  CoalesceBuffer.clear();
+  CoalescedMessages = 0;
+  return frame;
+}
+
+bool Synavis::DataConnector::FlushCoalesced()
+{
+  std::unique_lock<std::mutex> flush(CoalesceFlushLock);
+  std::unique_lock<std::mutex> lock(CoalesceLock);
+  const auto count = CoalescedMessages;
+  auto frame = TakeCoalescedLocked();
+  lock.unlock();
+  if (!frame.has_value())
+    return true;
+  if (State.Get() != EConnectionState::CONNECTED || !SubmitMessage(std::move(frame.value())))
+  {
+    lconnector(ELogVerbosity::Warning) << "Dropping " << count << " coalesced messages, they could not be sent" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void Synavis::DataConnector::CoalesceRun()
+{
+  std::unique_lock<std::mutex> lock(CoalesceLock);
+  while (CoalesceMessages)
+  {
+    if (CoalesceBuffer.empty())
+    {
+      CoalesceCondition.wait(lock, [this]() { return !CoalesceBuffer.empty() || !CoalesceMessages; });
+    }
+    else if (!CoalesceCondition.wait_until(lock, CoalesceDeadline, [this]() { return !CoalesceMessages; })
+      && std::chrono::steady_clock::now() >= CoalesceDeadline)
+    {
+      // the deadline might have moved on if the buffer was flushed in the meantime
+      lock.unlock();
+      FlushCoalesced();
+      lock.lock();
+    }
+  }
+}
+
+void Synavis::DataConnector::DeliverMessage(std::string_view Message)
+{
+  // registered types only read their "type" field here and skip the callbacks
+  LazyMessage message(Message);
+  if (Requests.Outstanding() > 0 && Requests.Resolve(message))
+    return;
+  if (TelemetryCaching && message.Type() == "track" && !AcceptTelemetry(message))
+    return;
+  // an exception of a handler or callback must not end up on the network thread
+  try
+  {
+    if (TransferHandlers.Dispatch(message) || MessageHandlers.Dispatch(message))
+      return;
+    if (MessageViewCallback.has_value())
+      MessageViewCallback.value()(Message);
+    if (MessageReceptionCallback.has_value())
+      MessageReceptionCallback.value()(std::string(Message));
+  }
+  catch (const std::exception& e)
+  {
+    lconnector(ELogVerbosity::Warning) << "Could not handle message of type " << message.Type() << ": " << e.what() << std::endl;
+  }
+}
+
+std::future<nlohmann::json> Synavis::DataConnector::Request(json Command, double Timeout)
+{
+  auto [id, future] = Requests.Open(Timeout);
+  // the request is registered before sending, so that an early reply finds it
+  Command["pid"] = id;
+  if (!SendJSON(Command))
+    Requests.Fail(id, "Could not send the request");
+  return std::move(future);
+}
+
+std::size_t Synavis::DataConnector::GetOutstandingRequests()
+{
+  return Requests.Outstanding();
+}
+
+bool Synavis::DataConnector::AcceptTelemetry(LazyMessage& Message)
+{
+  try
+  {
+    const auto& content = Message.Document();
+    if (!content.contains("data") || !content["data"].is_object() || content["data"].empty())
+      return true;
+    const auto sequence = (content.contains("seq") && content["seq"].is_number_unsigned())
+      ? content["seq"].get<std::uint64_t>() : ++TelemetryArrivals;
+    if (Telemetry.Apply(content, sequence) > 0)
+      return true;
+    lconnector(ELogVerbosity::Verbose) << "Dropping stale telemetry " << sequence << std::endl;
+    return false;
+  }
+  catch (const json::exception& e)
+  {
+    lconnector(ELogVerbosity::Warning) << "Could not read telemetry: " << e.what() << std::endl;
+    return true;
+  }
+}
+
+bool Synavis::DataConnector::SendTelemetry(json Data)
+{
+  if (!TelemetryChannel || !TelemetryChannel->isOpen())
+    return false;
+  json message = { {"type", "track"}, {"seq", ++TelemetrySequence}, {"data", std::move(Data)} };
+  auto text = message.dump();
+  // an unreliable message can not be fragmented, and a full channel would only deliver old values
+  if (text.size() > MaxMessageSize || TelemetryChannel->bufferedAmount() >= BufferedAmountHighWater)
+  {
+    lconnector(ELogVerbosity::Debug) << "Dropping telemetry of size " << text.size() << std::endl;
+    return false;
+  }
+  // false from send only means that the channel buffered the message
+  try
+  {
+    TelemetryChannel->send(std::move(text));
+    return true;
+  }
+  catch (const std::exception& e)
+  {
+    lconnector(ELogVerbosity::Debug) << "Telemetry channel refused a message: " << e.what() << std::endl;
+    return false;
+  }
+}
+
+std::optional<nlohmann::json> Synavis::DataConnector::GetTelemetry(const std::string& Key)
+{
+  auto value = Telemetry.Get(Key);
+  if (!value.has_value())
+    return std::nullopt;
+  return value->Data;
+}
+
+nlohmann::json Synavis::DataConnector::GetTelemetrySnapshot()
+{
+  return Telemetry.Snapshot();
+}
 
-  std::string temp = std::string((char*)bytes.data(), bytes.size());
-  lconnector(ELogVerbosity::Info) << "Sending JSON: " << temp << std::endl;
-  DataChannel->sendBuffer(bytes);
+void Synavis::DataConnector::DeliverData(std::span<const std::byte> Data)
+{
+  try
+  {
+    if (DataViewCallback.has_value())
+      DataViewCallback.value()(Data);
+    if (DataReceptionCallback.has_value())
+      DataReceptionCallback.value()(rtc::binary(Data.begin(), Data.end()));
+  }
+  catch (const std::exception& e)
+  {
+    lconnector(ELogVerbosity::Warning) << "Could not handle data of size " << Data.size() << ": " << e.what() << std::endl;
+  }
 }
 
 bool Synavis::DataConnector::SendBuffer(const std::span<const uint8_t>& Buffer, std::string Name, std::string Format)
 {
-  // this method briefly exchanges the callback for message reception
-  auto msg_callback = MessageReceptionCallback;
-  int MessageState = (this->DontWaitForAnswer) ? 1 : 0;
+  std::unique_lock<std::recursive_mutex> transfer(TransferLock);
+  // acknowledgements of the receiver, these are filled by the message handlers. The state
+  // is shared with the handlers, as one of them may still run when the transfer returns
+  struct Acknowledgements
+  {
+    std::mutex Lock;
+    std::condition_variable Received;
+    int MessageState{ 0 };
+    unsigned AgreedWindow{ 1 };
+    // chunk-indexed reports of the receiver in windowed mode (state, chunk)
+    std::deque<std::pair<bool, std::size_t>> ChunkReports;
+  };
+  auto acks = std::make_shared<Acknowledgements>();
+  acks->MessageState = (this->DontWaitForAnswer) ? 1 : 0;
   int StateTracker = 1;
-  this->SetMessageCallback([&msg_callback, &MessageState, this](std::string Message)
+  // the replies of the receiver are taken for the duration of the transfer, handlers that
+  // the user registered for these types stay in place and get them again afterwards
+  TransferHandlers.On("buffer", [acks](LazyMessage& Message)
     {
-      lconnector(ELogVerbosity::Info) << "Message received: " << Message << std::endl;
-      json content = json::parse(Message);
-      if (content["type"] == "buffer")
+      const auto& content = Message.Document();
+      std::unique_lock<std::mutex> lock(acks->Lock);
+      if (content.contains("chunk"))
       {
-        MessageState = MessageState + 1;
+        // the receiver either confirms a chunk or reports it as missing
+        acks->ChunkReports.emplace_back(content.value("state", "transit") != "missing", content["chunk"].get<std::size_t>());
       }
-      else if (content["type"] == "error")
-      {
-        MessageState = -1;
-      }
-      else if (msg_callback.has_value())
+      else
       {
-        msg_callback.value()(Message);
+        if (content.contains("window"))
+        {
+          acks->AgreedWindow = std::max(content["window"].get<unsigned>(), 1u);
+        }
+        acks->MessageState = acks->MessageState + 1;
       }
+      lock.unlock();
+      acks->Received.notify_all();
+    });
+  TransferHandlers.On("error", [acks](LazyMessage& Message)
+    {
+      lconnector(ELogVerbosity::Warning) << "Receiver reported an error during the transfer: " << Message.Text() << std::endl;
+      std::unique_lock<std::mutex> lock(acks->Lock);
+      acks->MessageState = -1;
+      lock.unlock();
+      acks->Received.notify_all();
     });
-  auto WaitTimeout = [&MessageState, &StateTracker, this](bool bFail = true, double failtime = 2.0)
+  struct HandlerScope
   {
-    auto start_time = std::chrono::system_clock::now();
-    auto failtime_seconds = std::chrono::duration<double>(failtime);
-    auto waittime = failtime_seconds / 10.0;
-    while (MessageState < StateTracker)
+    MessageDispatcher& Handlers;
+    ~HandlerScope()
     {
-      if (this->LogVerbosity >= ELogVerbosity::Verbose)
-      {
-        std::this_thread::sleep_for(waittime);
-        lconnector(ELogVerbosity::Verbose) << "Waiting for message " << StateTracker << " time " << std::chrono::duration<double>(std::chrono::system_clock::now() - start_time).count() << " of " << failtime_seconds.count() << "." << std::endl;
-      }
-      else
-      {
-        std::this_thread::yield();
-      }
-      if (bFail && (std::chrono::duration<double>(std::chrono::system_clock::now() - start_time) > failtime_seconds))
+      Handlers.Remove("buffer");
+      Handlers.Remove("error");
+    }
+  } handler_scope{ TransferHandlers };
+  auto WaitTimeout = [&](bool bFail = true, double failtime = 2.0)
+  {
+    std::unique_lock<std::mutex> lock(acks->Lock);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(failtime));
+    auto arrived = [&]() { return acks->MessageState < 0 || acks->MessageState >= StateTracker; };
+    lconnector(ELogVerbosity::Verbose) << "Waiting for message " << StateTracker << std::endl;
+    if (bFail)
+    {
+      if (!acks->Received.wait_until(lock, deadline, arrived))
       {
         lconnector(ELogVerbosity::Debug) << "Message reception timed out" << std::endl;
-        MessageState = -1;
-        break;
+        acks->MessageState = -1;
       }
     }
+    else
+    {
+      acks->Received.wait(lock, arrived);
+    }
     StateTracker++;
   };
-  std::size_t chunk_size{}, chunks{}, total_size{};
-  const uint8_t* Source = nullptr;
-  bool NeedToDelete = false;
+  // a message of the transfer that the channel refused ends the transfer
+  auto Refused = [&](const char* What)
+  {
+    lconnector(ELogVerbosity::Warning) << "Could not submit the " << What << " of buffer " << Name << std::endl;
+    std::unique_lock<std::mutex> lock(acks->Lock);
+    acks->MessageState = -1;
+    lock.unlock();
+    acks->Received.notify_all();
+  };
+  const unsigned RequestedWindow = DontWaitForAnswer ? 1u : std::max(TransferWindow, 1u);
+  // every chunk carries the message byte, its size and a terminator, windowed chunks
+  // also carry their index behind the size bytes
+  constexpr std::size_t plain_overhead = 4;
+  constexpr std::size_t indexed_overhead = plain_overhead + sizeof(uint32_t);
+  std::size_t total_size{}, chunks{};
+  bool Encode = false;
+  const bool Compressed = (Format == "raw" && BufferCompression != ECompression::None);
+  // the size of a chunk on the wire and the part of the buffer it carries
+  auto ChunkLayout = [&](std::size_t Overhead) -> std::pair<std::size_t, std::size_t>
+  {
+    if (Format == "raw")
+    {
+      const auto chunk = this->MaxMessageSize - Overhead;
+      // compressed chunks start with a byte that tells if the chunk is compressed or stored
+      return { chunk, Compressed ? chunk - 1 : chunk };
+    }
+    if (Format == "base64")
+    {
+      // the buffer is encoded chunk by chunk directly into the outgoing message,
+      // so the encoded chunks must consist of complete 4-character groups.
+      // This way only the last chunk carries padding and the concatenation of all
+      // chunks is identical to encoding the whole buffer at once
+      const auto chunk = ((this->MaxMessageSize - Overhead) / 4) * 4;
+      return { chunk, (chunk / 4) * 3 };
+    }
+    return { 0, 0 };
+  };
   if (Format == "raw")
   {
     total_size = Buffer.size();
-    chunk_size = this->MaxMessageSize - 4;
-    chunks = std::max(Buffer.size() / chunk_size, static_cast<std::size_t>(1));
-    Source = reinterpret_cast<const uint8_t*>(Buffer.data());
   }
   else if (Format == "base64")
   {
     total_size = EncodedSize(Buffer);
-    chunk_size = this->MaxMessageSize - 4;
-    chunks = total_size / chunk_size + 1;
-    const auto ConvertedDat = Encode64(Buffer);
-    const std::string DebugTest(ConvertedDat.begin(), ConvertedDat.end());
-    Source = reinterpret_cast<const uint8_t*>(ConvertedDat.data());
-    NeedToDelete = true;
+    Encode = true;
   }
   else if (Format == "ascii")
   {
 
   }
-  if (!Source)
+  if (ChunkLayout(RequestedWindow > 1 ? indexed_overhead : plain_overhead).second == 0)
   {
-    if (NeedToDelete)
-    {
-      delete[] Source;
-    }
     throw std::runtime_error(Prefix + "Invalid format for buffer transmission");
   }
-  // transmit
-  lconnector(ELogVerbosity::Debug) << "Transmitting buffer of size " << Buffer.size() << " in " << chunks << " chunks of size " << chunk_size << std::endl;
-  this->SendJSON({ {"type","buffer"}, {"start",Name }, {"size", total_size}, {"format", Format} });
+  // chunks only lose room to their index once the receiver agreed to a window
+  auto [chunk_size, source_chunk_size] = ChunkLayout(plain_overhead);
+  json start = { {"type","buffer"}, {"start",Name }, {"size", total_size}, {"format", Format} };
+  if (RequestedWindow > 1)
+  {
+    // the receiver accepts the windowed mode by answering with a window field,
+    // otherwise we fall back to waiting for every chunk
+    const auto windowed = ChunkLayout(indexed_overhead);
+    start["window"] = RequestedWindow;
+    start["chunksize"] = windowed.first;
+    // the source chunk of a compressed transfer is announced now, so it is the windowed one
+    if (Compressed)
+      std::tie(chunk_size, source_chunk_size) = windowed;
+  }
+  if (Compressed)
+  {
+    // every chunk decompresses to sourcechunk bytes, only the last one may be shorter
+    start["compression"] = CompressionName(BufferCompression);
+    start["sourcechunk"] = source_chunk_size;
+  }
+  if (!this->SendJSON(start))
+    Refused("start message");
+  FlushMessages();
   lconnector(ELogVerbosity::Debug) << "Sent start message" << std::endl;
   if (!DontWaitForAnswer)
   {
     WaitTimeout(this->FailIfNotComplete, TimeOut);
     lconnector(ELogVerbosity::Debug) << "Received start message" << std::endl;
   }
-  rtc::binary bytes(std::min(chunk_size, total_size) + 4);
-  bytes.at(bytes.size() - 1) = std::byte(0);
-  uint8_t* buffer = reinterpret_cast<uint8_t*>(&(bytes.at(3)));
+  const unsigned Window = (RequestedWindow > 1 && acks->AgreedWindow > 1) ? std::min(RequestedWindow, acks->AgreedWindow) : 1u;
+  const std::size_t header_size = (Window > 1) ? 3 + sizeof(uint32_t) : 3;
+  if (Window > 1 && !Compressed)
+  {
+    std::tie(chunk_size, source_chunk_size) = ChunkLayout(indexed_overhead);
+  }
+  chunks = std::max((Buffer.size() + source_chunk_size - 1) / source_chunk_size, static_cast<std::size_t>(1));
+  // transmit
+  lconnector(ELogVerbosity::Debug) << "Transmitting buffer of size " << Buffer.size() << " in " << chunks << " chunks of size " << chunk_size << std::endl;
+  // this is the only intermediate buffer of the transmission, it is reused for every chunk
+  rtc::binary bytes(std::min(chunk_size, total_size + (Compressed ? 1 : 0)) + header_size + 1);
   bytes.at(0) = DataChannelByte;
-  // move through the chunks
-  lconnector(ELogVerbosity::Verbose) << "Message state is " << MessageState << " chunk info " << total_size << "->" << chunk_size << "(" << chunks << ")" << std::endl;
-  for (int i = 0; i < chunks && MessageState > 0; i++)
+  // chunks that do not compress are stored, after a few of those in a row the rest of
+  // the transfer is not compressed anymore
+  constexpr std::size_t BypassAfter = 4;
+  std::size_t stored_in_a_row = 0, compressed_size = 0;
+  auto SendChunk = [&](std::size_t i)
   {
-    const auto remaining = std::min(chunk_size, total_size - i * chunk_size);
-    if (bytes.size() > remaining + 4)
+    const auto offset = i * source_chunk_size;
+    const auto source_remaining = std::min(source_chunk_size, Buffer.size() - offset);
+    auto remaining = Encode ? 4 * ((source_remaining + 2) / 3) : source_remaining;
+    if (Compressed)
     {
-      bytes.resize(remaining + 4);
+      bytes.resize(source_remaining + header_size + 2);
+      auto* target = reinterpret_cast<uint8_t*>(bytes.data() + header_size);
+      std::size_t packed = 0;
+      if (stored_in_a_row < BypassAfter)
+      {
+        const auto capacity = static_cast<std::size_t>(static_cast<double>(source_remaining) * BufferCompressionRatio);
+        packed = Compress(Buffer.subspan(offset, source_remaining), target + 1, capacity, BufferCompression);
+      }
+      if (packed > 0)
+      {
+        target[0] = 1;
+        remaining = packed + 1;
+        stored_in_a_row = 0;
+      }
+      else
+      {
+        target[0] = 0;
+        memcpy(target + 1, Buffer.data() + offset, source_remaining);
+        remaining = source_remaining + 1;
+        stored_in_a_row++;
+      }
+      compressed_size += remaining;
+      bytes.resize(remaining + header_size + 1);
       bytes.at(bytes.size() - 1) = std::byte(0);
+      *(reinterpret_cast<uint16_t*>(&(bytes.at(1)))) = static_cast<uint16_t>(remaining);
+      if (Window > 1)
+      {
+        InsertIntoBinary(bytes, 3, static_cast<uint32_t>(i));
+      }
+      lconnector(ELogVerbosity::Debug) << "Sending chunk " << i << " of length " << remaining << (target[0] ? " (compressed)" : " (stored)") << std::endl;
+      if (!SubmitMessage(bytes, true))
+        Refused("chunk");
+      return;
     }
-    // copy the chunk into the buffer, the std::min is to avoid copying too much
-    memcpy(buffer, Source + i * chunk_size, remaining);
+    bytes.resize(remaining + header_size + 1);
+    bytes.at(bytes.size() - 1) = std::byte(0);
     // set the second and third bytes to the chunk size
     *(reinterpret_cast<uint16_t*>(&(bytes.at(1)))) = static_cast<uint16_t>(remaining);
+    if (Window > 1)
+    {
+      InsertIntoBinary(bytes, 3, static_cast<uint32_t>(i));
+    }
+    // fill the chunk directly from the source buffer
+    char* buffer = reinterpret_cast<char*>(bytes.data() + header_size);
+    if (Encode)
+    {
+      Encode64Into(Buffer.data() + offset, source_remaining, buffer);
+    }
+    else
+    {
+      memcpy(buffer, Buffer.data() + offset, source_remaining);
+    }
     // send the buffer
     lconnector(ELogVerbosity::Debug) << "Sending chunk " << i << " of length " << remaining << std::endl;
-    DataChannel->sendBuffer(bytes);
-    // wait for the message to be received
-    if (!DontWaitForAnswer)
+    if (!SubmitMessage(bytes, true))
+      Refused("chunk");
+  };
+  // move through the chunks
+  lconnector(ELogVerbosity::Verbose) << "Message state is " << acks->MessageState << " chunk info " << total_size << "->" << chunk_size << "(" << chunks << ")" << " window " << Window << std::endl;
+  if (Window > 1)
+  {
+    // sliding window: up to Window chunks are in flight, only chunks that are
+    // reported missing or whose acknowledgement times out are sent again
+    const auto chunk_timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(TimeOut));
+    std::vector<std::chrono::steady_clock::time_point> sent_at(chunks);
+    ChunkWindow window(chunks, Window);
+    while (!window.Complete() && acks->MessageState > 0)
     {
-      WaitTimeout(this->FailIfNotComplete, TimeOut);
-      lconnector(ELogVerbosity::Debug) << "Received message " << i << std::endl;
+      while (auto chunk = window.Next())
+      {
+        SendChunk(chunk.value());
+        sent_at[chunk.value()] = std::chrono::steady_clock::now();
+        if (acks->MessageState < 0)
+          break;
+      }
+      std::unique_lock<std::mutex> lock(acks->Lock);
+      const bool reported = acks->Received.wait_until(lock, sent_at[window.Oldest()] + chunk_timeout, [&]() { return !acks->ChunkReports.empty() || acks->MessageState < 0; });
+      for (const auto& [received, chunk] : acks->ChunkReports)
+      {
+        window.Report(chunk, received);
+      }
+      acks->ChunkReports.clear();
+      if (!reported && acks->MessageState > 0)
+      {
+        lconnector(ELogVerbosity::Debug) << "Acknowledgement for chunk " << window.Oldest() << " timed out" << std::endl;
+        if (this->FailIfNotComplete)
+          acks->MessageState = -1;
+        else
+          window.Expire();
+      }
     }
+    lconnector(ELogVerbosity::Debug) << "Retransmitted " << window.Retransmissions() << " chunks" << std::endl;
   }
-  this->SendJSON({ {"type","buffer"},{"stop",Name} });
-    if (!DontWaitForAnswer) WaitTimeout(this->FailIfNotComplete, TimeOut);
-    lconnector(ELogVerbosity::Info) << "Sent stop message" << std::endl;
-    // restore the original callback
-      MessageReceptionCallback = msg_callback;
-    if (NeedToDelete)
+  else
+  {
+    for (std::size_t i = 0; i < chunks && acks->MessageState > 0; i++)
     {
-      delete[] Source;
+      SendChunk(i);
+      // wait for the message to be received
+      if (!DontWaitForAnswer)
+      {
+        WaitTimeout(this->FailIfNotComplete, TimeOut);
+        lconnector(ELogVerbosity::Debug) << "Received message " << i << std::endl;
+      }
     }
-  return this->DontWaitForAnswer || MessageState > 0;
+  }
+  if (Compressed)
+  {
+    lconnector(ELogVerbosity::Debug) << "Compressed " << Buffer.size() << " bytes into " << compressed_size << " bytes" << std::endl;
+  }
+  // the stop message is also sent after a failure, so that the receiver drops the transfer
+  if (!this->SendJSON({ {"type","buffer"},{"stop",Name} }))
+    Refused("stop message");
+  FlushMessages();
+  if (!DontWaitForAnswer) WaitTimeout(this->FailIfNotComplete, TimeOut);
+  lconnector(ELogVerbosity::Info) << "Sent stop message" << std::endl;
+  // without answers the transfer only fails if one of its messages was refused
+  std::unique_lock<std::mutex> lock(acks->Lock);
+  return acks->MessageState > 0;
 }
 
 bool Synavis::DataConnector::SendFloat64Buffer(const std::vector<double>& Buffer, std::string Name, std::string Format)
@@ -260,10 +687,72 @@ bool Synavis::DataConnector::SendInt32Buffer(const std::vector<int32_t>& Buffer,
   return this->SendBuffer(std::span(reinterpret_cast<const uint8_t*>(Buffer.data()), Buffer.size() * sizeof(int32_t)), Name, Format);
 }
 
-void Synavis::DataConnector::SendGeometry(const std::vector<double>& Vertices, const std::vector<uint32_t>& Indices,
+bool Synavis::DataConnector::SendGeometry(const std::vector<double>& Vertices, const std::vector<uint32_t>& Indices,
   std::string Name, std::optional<std::vector<double>> Normals, std::optional<std::vector<double>> UVs,
   std::optional<std::vector<double>> Tangents, bool AutoMessage)
 {
+  std::unique_lock<std::recursive_mutex> transfer(TransferLock);
+  if (GeometryEncoding != EGeometryEncoding::Base64)
+  {
+    MeshView Geometry;
+    Geometry.Name = Name;
+    Geometry.Vertices = Vertices;
+    Geometry.Indices = Indices;
+    if (Normals.has_value()) Geometry.Normals = Normals.value();
+    if (UVs.has_value()) Geometry.UVs = UVs.value();
+    if (Tangents.has_value()) Geometry.Tangents = Tangents.value();
+    const auto Precision = GeometryPrecision();
+    if (IncrementalGeometry)
+    {
+      auto Previous = SentGeometry.find(Name);
+      bool success = false;
+      std::optional<rtc::binary> Patch;
+      if (Previous != SentGeometry.end())
+      {
+        auto PatchPrecision = (Precision == EMeshScalar::Float64) ? EMeshScalar::Float64 : EMeshScalar::Float32;
+        // the patch competes with the full message at the precision it would be sent with,
+        // EncodeMeshPatch measures its threshold against the patch precision
+        auto Threshold = GeometryPatchThreshold;
+        if (PatchPrecision != Precision)
+          Threshold *= static_cast<double>(EncodedMeshSize(Geometry, Precision)) / static_cast<double>(EncodedMeshSize(Geometry, PatchPrecision));
+        Patch = EncodeMeshPatch(View(Previous->second), Geometry, PatchPrecision, Threshold);
+      }
+      if (Patch.has_value())
+      {
+        lconnector(ELogVerbosity::Debug) << "Sending patch of " << Patch->size() << " bytes for " << Name << std::endl;
+        success = this->SendData(std::move(Patch.value()));
+      }
+      else
+      {
+        success = this->SendData(EncodeMesh(Geometry, Precision));
+      }
+      // SendData only reports that the message was accepted for sending, a message that is
+      // lost later goes unnoticed and ForgetGeometry has to be called for a full send.
+      // A rejected message drops the copy, so that the next send is complete
+      if (success)
+      {
+        auto& Sent = SentGeometry[Name];
+        Sent.Name = Name;
+        Sent.Vertices.assign(Vertices.begin(), Vertices.end());
+        Sent.Indices.assign(Indices.begin(), Indices.end());
+        Sent.Normals = Normals;
+        Sent.UVs = UVs;
+        Sent.Tangents = Tangents;
+      }
+      else
+      {
+        SentGeometry.erase(Name);
+      }
+      return success;
+    }
+    // the mesh message is self-contained, the receiver spawns the mesh on arrival
+    if (OptimizeGeometryOrder)
+    {
+      auto Optimized = OptimizeVertexOrder(Geometry);
+      return this->SendData(EncodeMesh(View(Optimized), Precision));
+    }
+    return this->SendData(EncodeMesh(Geometry, Precision));
+  }
   json Message = { {"type","geometry"},{"name",Name} };
   // calculate the total size[bytes] of the message if we were to send it as a single buffer
   std::size_t total_size = 3;
@@ -300,48 +789,292 @@ void Synavis::DataConnector::SendGeometry(const std::vector<double>& Vertices, c
     {
       Message["tangents"] = Encode64(Tangents.value());
     }
-    this->SendJSON(Message);
+    return this->SendJSON(Message);
   }
   else
   {
-    bool state = false;
+    bool state = false, success = true;
     std::span<const uint8_t> data(reinterpret_cast<const uint8_t*>(Vertices.data()), reinterpret_cast<const uint8_t*>(Vertices.data() + Vertices.size()));
     // send the vertices
     do { state = this->SendBuffer(data, "points", "base64"); } while (!state && RetryOnErrorResponse);
+    success = success && state;
     state = false;
     // send the indices
-    data = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(Indices.data()), Indices.size() * sizeof(float));
+    data = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(Indices.data()), Indices.size() * sizeof(uint32_t));
     do { state = this->SendBuffer(data, "triangles", "base64"); } while (!state && RetryOnErrorResponse);
+    success = success && state;
     state = false;
     // send the normals
-    if (UVs.has_value())
+    if (Normals.has_value())
     {
-      data = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(Normals.value().data()), Normals.value().size() * sizeof(float));
+      data = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(Normals.value().data()), Normals.value().size() * sizeof(double));
       do { state = this->SendBuffer(data, "normals", "base64"); } while (!state && RetryOnErrorResponse);
+      success = success && state;
       state = false;
     }
     // send the UVs
     if (UVs.has_value())
     {
-      data = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(UVs.value().data()), UVs.value().size() * sizeof(float));
+      data = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(UVs.value().data()), UVs.value().size() * sizeof(double));
       do { state = this->SendBuffer(data, "uvs", "base64"); } while (!state && RetryOnErrorResponse);
+      success = success && state;
       state = false;
     }
     // send the tangents
     if (Tangents.has_value())
     {
-      data = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(Tangents.value().data()), Tangents.value().size() * sizeof(float));
+      data = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(Tangents.value().data()), Tangents.value().size() * sizeof(double));
       do { state = this->SendBuffer(data, "tangents", "base64"); } while (!state && RetryOnErrorResponse);
+      success = success && state;
       state = false;
     }
-    if (AutoMessage)
+    if (AutoMessage && success)
       this->SendJSON({ {"type","spawn"},{"object","ProceduralMeshComponent"} });
+    return success;
+  }
+}
+
+bool Synavis::DataConnector::SendGeometryBatch(const GeometryBatch& Batch)
+{
+  if (Batch.Count() == 0)
+    return true;
+  auto Message = Batch.Finish();
+  lconnector(ELogVerbosity::Debug) << "Sending batch of " << Batch.Count() << " meshes in " << Message.size() << " bytes" << std::endl;
+  // a receiver that does not know the buffer rejects every attempt, so the retries are bounded
+  constexpr int attempts = 3;
+  bool state = false;
+  for (int attempt = 0; attempt < (RetryOnErrorResponse ? attempts : 1) && !state; ++attempt)
+    state = this->SendBuffer(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(Message.data()), Message.size()), "geometrybatch", "raw");
+  if (!state)
+    lconnector(ELogVerbosity::Warning) << "Could not send batch of " << Batch.Count() << " meshes" << std::endl;
+  return state;
+}
+
+bool Synavis::DataConnector::SendGeometryShared(std::shared_ptr<SharedMemoryRing> Ring, const MeshView& Geometry)
+{
+  const auto Precision = GeometryPrecision();
+  const auto size = EncodedMeshSize(Geometry, Precision);
+  if (size > Ring->GetSlotSize())
+  {
+    lconnector(ELogVerbosity::Warning) << "Mesh " << Geometry.Name << " of " << size << " bytes does not fit into the slots of " << Ring->GetName() << std::endl;
+    return false;
+  }
+  {
+    std::unique_lock<std::mutex> lock(SharedRingLock);
+    SharedRings.insert_or_assign(Ring->GetName(), Ring);
+  }
+  auto slot = Ring->Acquire(TimeOut);
+  if (slot.empty())
+  {
+    lconnector(ELogVerbosity::Warning) << "No slot of " << Ring->GetName() << " was released in time" << std::endl;
+    return false;
+  }
+  EncodeMeshInto(Geometry, slot, Precision);
+  // published before the announcement, so that a receiver on the same node finds it with Peek
+  const auto sequence = Ring->Commit(size);
+  if (!this->SendJSON({ {"type","sharedgeometry"}, {"ring",Ring->GetName()}, {"sequence",sequence}, {"size",size}, {"name",Geometry.Name} }))
+  {
+    // the receiver still reads the slot when it drains the ring for the next announcement
+    lconnector(ELogVerbosity::Warning) << "Could not announce mesh " << Geometry.Name << " in " << Ring->GetName() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void Synavis::DataConnector::ReleaseSharedSlot(SharedMemoryRing& Ring)
+{
+  Ring.Release();
+  this->SendJSON({ {"type","sharedrelease"}, {"ring",Ring.GetName()} });
+}
+
+Synavis::EMeshScalar Synavis::DataConnector::GeometryPrecision() const
+{
+  if (GeometryEncoding == EGeometryEncoding::BinaryFloat64)
+    return EMeshScalar::Float64;
+  if (GeometryEncoding == EGeometryEncoding::Quantized)
+    return EMeshScalar::Quantized16;
+  return EMeshScalar::Float32;
+}
+
+void Synavis::DataConnector::SetIncrementalGeometry(bool Incremental, double Threshold)
+{
+  std::unique_lock<std::recursive_mutex> transfer(TransferLock);
+  IncrementalGeometry = Incremental;
+  GeometryPatchThreshold = Threshold;
+  if (!Incremental)
+    SentGeometry.clear();
+}
+
+void Synavis::DataConnector::ForgetGeometry(std::string Name)
+{
+  std::unique_lock<std::recursive_mutex> transfer(TransferLock);
+  SentGeometry.erase(Name);
+}
+
+std::future<bool> Synavis::DataConnector::SendBufferAsync(std::vector<uint8_t> Buffer, std::string Name, std::string Format)
+{
+  // std::function requires a copyable callable, hence the shared task
+  auto Task = std::make_shared<std::packaged_task<bool()>>(
+    [this, Buffer = std::move(Buffer), Name = std::move(Name), Format = std::move(Format)]()
+    {
+      return this->SendBuffer(std::span<const uint8_t>(Buffer), Name, Format);
+    });
+  auto Result = Task->get_future();
+  PendingTransfers++;
+  TransferHandler.AddTask([this, Task]() { (*Task)(); PendingTransfers--; });
+  return Result;
+}
+
+std::future<bool> Synavis::DataConnector::SendGeometryAsync(std::vector<double> Vertices, std::vector<uint32_t> Indices, std::string Name,
+  std::optional<std::vector<double>> Normals, std::optional<std::vector<double>> UVs, std::optional<std::vector<double>> Tangents, bool AutoMessage)
+{
+  auto Task = std::make_shared<std::packaged_task<bool()>>(
+    [this, Vertices = std::move(Vertices), Indices = std::move(Indices), Name = std::move(Name),
+     Normals = std::move(Normals), UVs = std::move(UVs), Tangents = std::move(Tangents), AutoMessage]()
+    {
+      return this->SendGeometry(Vertices, Indices, Name, Normals, UVs, Tangents, AutoMessage);
+    });
+  auto Result = Task->get_future();
+  PendingTransfers++;
+  TransferHandler.AddTask([this, Task]() { (*Task)(); PendingTransfers--; });
+  return Result;
+}
+
+std::size_t Synavis::DataConnector::GetPendingTransfers()
+{
+  return PendingTransfers;
+}
+
+void Synavis::DataConnector::SetSendQueueLimits(std::size_t MaxMessages, std::size_t HighWater, std::size_t LowWater)
+{
+  BufferedAmountHighWater = HighWater;
+  BufferedAmountLowWater = std::min(LowWater, HighWater);
+  Outgoing.SetLimits(MaxMessages, HighWater);
+  if (DataChannel)
+    DataChannel->setBufferedAmountLowThreshold(BufferedAmountLowWater);
+}
+
+std::size_t Synavis::DataConnector::GetSendQueueDepth()
+{
+  return Outgoing.Size();
+}
+
+std::size_t Synavis::DataConnector::GetBufferedAmount()
+{
+  return DataChannel ? DataChannel->bufferedAmount() : 0;
+}
+
+void Synavis::DataConnector::ChannelCounters::Sent(std::size_t Bytes)
+{
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  std::chrono::steady_clock::rep never = 0;
+  FirstSend.compare_exchange_strong(never, now);
+  LastSend = now;
+  BytesSent += Bytes;
+  MessagesSent++;
+}
+
+Synavis::DataConnector::ChannelStatistics Synavis::DataConnector::ChannelCounters::Statistics(std::string Label, std::size_t BufferedAmount) const
+{
+  const auto active = std::chrono::duration<double>(std::chrono::steady_clock::duration(LastSend - FirstSend)).count();
+  const std::size_t sent = BytesSent;
+  return { std::move(Label), sent, BytesReceived, MessagesSent, BufferedAmount, (active > 0.0) ? sent / active : 0.0 };
+}
+
+std::size_t Synavis::DataConnector::GetOpenStripeChannels()
+{
+  std::unique_lock<std::mutex> lock(StripeLock);
+  return std::count_if(Stripes.begin(), Stripes.end(), [](const auto& Target) { return Target->Channel->isOpen(); });
+}
+
+std::vector<Synavis::DataConnector::ChannelStatistics> Synavis::DataConnector::GetChannelStatistics()
+{
+  std::vector<ChannelStatistics> statistics;
+  statistics.push_back(MainCounters.Statistics(DataChannel ? DataChannel->label() : "", GetBufferedAmount()));
+  std::unique_lock<std::mutex> lock(StripeLock);
+  for (const auto& target : Stripes)
+    statistics.push_back(target->Counters.Statistics(target->Channel->label(), target->Channel->bufferedAmount()));
+  return statistics;
+}
+
+void Synavis::DataConnector::AddStripe(std::shared_ptr<rtc::DataChannel> Channel)
+{
+  auto target = std::make_shared<Stripe>();
+  target->Channel = Channel;
+  // the channel owns its callbacks, a strong reference would keep the stripe alive forever
+  std::weak_ptr<Stripe> weak = target;
+  auto release = [weak]()
+  {
+    if (auto stripe = weak.lock())
+    {
+      std::unique_lock<std::mutex> lock(stripe->SpaceLock);
+      lock.unlock();
+      stripe->Space.notify_all();
+    }
+  };
+  Channel->setBufferedAmountLowThreshold(BufferedAmountLowWater);
+  Channel->onBufferedAmountLow(release);
+  Channel->onClosed(release);
+  Channel->onOpen([label = Channel->label()]()
+    {
+      lconnector(ELogVerbosity::Info) << "Stripe channel " << label << " is open" << std::endl;
+    });
+  Channel->onMessage([this, weak](rtc::message_variant messageordata)
+    {
+      if (auto stripe = weak.lock())
+        stripe->Counters.BytesReceived += std::visit([](const auto& Content) { return Content.size(); }, messageordata);
+      DataChannelMessageHandling(std::move(messageordata));
+    });
+  std::unique_lock<std::mutex> lock(StripeLock);
+  Stripes.push_back(std::move(target));
+}
+
+bool Synavis::DataConnector::SendStriped(std::span<const std::byte> Data, const std::vector<std::shared_ptr<Stripe>>& Targets)
+{
+  // ranges of fragments rotate over the channels, so that every channel has data in flight
+  constexpr std::size_t range = 8;
+  const std::size_t channels = Targets.size() + 1;
+  std::size_t index = 0;
+  bool accepted = true;
+  FragmentMessage(Data, this->MaxMessageSize, NextMessageId++, DataChannelByte, [&](rtc::binary Fragment)
+    {
+      const auto channel = (index++ / range) % channels;
+      if (channel == 0)
+        accepted = SubmitMessage(std::move(Fragment), true) && accepted;
+      else
+        accepted = SendOnStripe(*Targets[channel - 1], std::move(Fragment)) && accepted;
+    });
+  return accepted;
+}
+
+bool Synavis::DataConnector::SendOnStripe(Stripe& Target, rtc::binary Message)
+{
+  std::unique_lock<std::mutex> lock(Target.SpaceLock);
+  Target.Space.wait(lock, [this, &Target]() { return Target.Channel->bufferedAmount() < BufferedAmountHighWater || !Target.Channel->isOpen(); });
+  if (!Target.Channel->isOpen())
+    return false;
+  Target.Counters.Sent(Message.size());
+  // false from send only means that the channel buffered the fragment, it is still delivered
+  try
+  {
+    Target.Channel->send(std::move(Message));
+    return true;
+  }
+  catch (const std::exception& e)
+  {
+    lconnector(ELogVerbosity::Warning) << "Stripe " << Target.Channel->label() << " refused a fragment: " << e.what() << std::endl;
+    return false;
   }
 }
 
+bool Synavis::DataConnector::SubmitMessage(rtc::binary Message, bool ForceBlock)
+{
+  return Outgoing.Submit(std::move(Message), ForceBlock);
+}
+
 Synavis::EConnectionState Synavis::DataConnector::GetState()
 {
-  return state_;
+  return State.Get();
 }
 
 void Synavis::DataConnector::SetDataCallback(std::function<void(rtc::binary)> Callback)
@@ -354,6 +1087,26 @@ void Synavis::DataConnector::SetMessageCallback(std::function<void(std::string)>
   this->MessageReceptionCallback = Callback;
 }
 
+void Synavis::DataConnector::SetDataViewCallback(std::function<void(std::span<const std::byte>)> Callback)
+{
+  this->DataViewCallback = Callback;
+}
+
+void Synavis::DataConnector::SetMessageViewCallback(std::function<void(std::string_view)> Callback)
+{
+  this->MessageViewCallback = Callback;
+}
+
+void Synavis::DataConnector::OnMessageType(std::string Type, MessageDispatcher::Handler Callback)
+{
+  MessageHandlers.On(std::move(Type), std::move(Callback));
+}
+
+void Synavis::DataConnector::RemoveMessageType(std::string_view Type)
+{
+  MessageHandlers.Remove(Type);
+}
+
 void Synavis::DataConnector::SetConfigFile(std::string ConfigFile)
 {
   std::ifstream file(ConfigFile);
@@ -405,7 +1158,7 @@ void Synavis::DataConnector::SetConfig(json Config)
 bool Synavis::DataConnector::IsRunning()
 {
   // returns true if the connection is in a state where it can send and receive data
-  return state_ < EConnectionState::CLOSED || SignallingServer->isOpen();
+  return State.Get() < EConnectionState::CLOSED || SignallingServer->isOpen();
 
 }
 
@@ -418,12 +1171,29 @@ void Synavis::DataConnector::PrintCommunicationData()
   lconnector(ELogVerbosity::Info) << "Data Channel " << label << " has protocol " << protocol << " and max message size " << max_message << std::endl;
 }
 
+bool Synavis::DataConnector::WaitForState(EConnectionState Target, double Timeout)
+{
+  return State.WaitFor(Target, Timeout);
+}
+
+bool Synavis::DataConnector::WaitWhileState(EConnectionState Target, double Timeout)
+{
+  return State.WaitWhile(Target, Timeout);
+}
+
+std::size_t Synavis::DataConnector::AddStateCallback(ConnectionState::TransitionCallback Callback)
+{
+  return State.AddTransitionCallback(std::move(Callback));
+}
+
+void Synavis::DataConnector::RemoveStateCallback(std::size_t Id)
+{
+  State.RemoveTransitionCallback(Id);
+}
+
 void Synavis::DataConnector::LockUntilConnected(unsigned additional_wait)
 {
-  while (state_ < EConnectionState::CONNECTED)
-  {
-    std::this_thread::yield();
-  }
+  State.WaitFor(EConnectionState::CONNECTED);
   if(additional_wait > 0)
     std::this_thread::sleep_for(std::chrono::milliseconds(additional_wait));
 }
@@ -467,144 +1237,97 @@ void Synavis::DataConnector::exp__DeactivateCallbacks()
 
 inline void Synavis::DataConnector::DataChannelMessageHandling(rtc::message_variant messageordata)
 {
+  // the hot path must not build log lines (time stamps) that are filtered anyway
+  const bool verbose = ELogVerbosity::Verbose <= Logger::Get()->GetVerbosity();
   if (std::holds_alternative<rtc::binary>(messageordata))
   {
-    auto data = std::get<rtc::binary>(messageordata);
-    std::byte message_byte = data[0];
-    if(message_byte == 0_b)
-    {
-      // Quality control ownership
-      lconnector(ELogVerbosity::Verbose) << "Received quality control ownership" << std::endl;
-    }
-    else if (message_byte == 1_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "Received response" << std::endl;
-    }
-    else if(message_byte == 2_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "Received command" << std::endl;
-    }
-    else if (message_byte == 3_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "Received freeze frame" << std::endl;
-    }
-    else if (message_byte == 3_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "Received freeze frame" << std::endl;
-    }
-    else if (message_byte == 4_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "Received unfreeze frame" << std::endl;
-    }
-    else if(message_byte == 5_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "Received video encoder AVgQP" << std::endl;
-    }
-    else if (message_byte == 6_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "Latency Test" << std::endl;
-    }
-    else if (message_byte == 7_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "Initial Settings" << std::endl;
-    }
-    else if (message_byte == 8_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "File Extension" << std::endl;
-    }
-    else if (message_byte == 9_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "File MIME Type" << std::endl;
-    }
-    else if (message_byte == 10_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "File Content" << std::endl;
-    }
-    else if (message_byte == 11_b)
-    {
-      lconnector(ELogVerbosity::Verbose) << "Test Echo" << std::endl;
-    }
-    else if (message_byte == 12_b)
+    const std::span<const std::byte> data = std::get<rtc::binary>(messageordata);
+    if (data.empty())
+      return;
+    if (IsFragment(data, DataChannelByte))
     {
-      lconnector(ELogVerbosity::Verbose) << "Input Control Ownership" << std::endl;
+      auto message = Fragments.Add(data);
+      if (message.has_value())
+      {
+        if (verbose)
+          lconnector(ELogVerbosity::Verbose) << "Reassembled data of size " << message.value().size() << std::endl;
+        try
+        {
+          if (DataViewCallback.has_value())
+            DataViewCallback.value()(message.value());
+          if (DataReceptionCallback.has_value())
+            DataReceptionCallback.value()(std::move(message.value()));
+        }
+        catch (const std::exception& e)
+        {
+          lconnector(ELogVerbosity::Warning) << "Could not handle reassembled data: " << e.what() << std::endl;
+        }
+      }
+      return;
     }
-    else if (message_byte == 13_b)
+    // binary meshes and other data that does not start with an Unreal message byte
+    // or the marker of a framed message are passed on as they are
+    const auto route = RouteInbound(data, DataChannelByte);
+    if (route == EInboundRoute::Data)
     {
-      lconnector(ELogVerbosity::Verbose) << "Gamepad response" << std::endl;
+      if (verbose)
+        lconnector(ELogVerbosity::Verbose) << "Received data of size " << data.size() << std::endl;
+      DeliverData(data);
+      return;
     }
-    else if (message_byte == 255_b)
+    if (verbose)
     {
-      lconnector(ELogVerbosity::Verbose) << "Protocoll" << std::endl;
+      switch (std::to_integer<std::uint8_t>(data[0]))
+      {
+      case 0: lconnector(ELogVerbosity::Verbose) << "Received quality control ownership" << std::endl; break;
+      case 1: lconnector(ELogVerbosity::Verbose) << "Received response" << std::endl; break;
+      case 2: lconnector(ELogVerbosity::Verbose) << "Received command" << std::endl; break;
+      case 3: lconnector(ELogVerbosity::Verbose) << "Received freeze frame" << std::endl; break;
+      case 4: lconnector(ELogVerbosity::Verbose) << "Received unfreeze frame" << std::endl; break;
+      case 5: lconnector(ELogVerbosity::Verbose) << "Received video encoder AVgQP" << std::endl; break;
+      case 6: lconnector(ELogVerbosity::Verbose) << "Latency Test" << std::endl; break;
+      case 7: lconnector(ELogVerbosity::Verbose) << "Initial Settings" << std::endl; break;
+      case 8: lconnector(ELogVerbosity::Verbose) << "File Extension" << std::endl; break;
+      case 9: lconnector(ELogVerbosity::Verbose) << "File MIME Type" << std::endl; break;
+      case 10: lconnector(ELogVerbosity::Verbose) << "File Content" << std::endl; break;
+      case 11: lconnector(ELogVerbosity::Verbose) << "Test Echo" << std::endl; break;
+      case 12: lconnector(ELogVerbosity::Verbose) << "Input Control Ownership" << std::endl; break;
+      case 13: lconnector(ELogVerbosity::Verbose) << "Gamepad response" << std::endl; break;
+      case 255: lconnector(ELogVerbosity::Verbose) << "Protocoll" << std::endl; break;
+      default: break;
+      }
     }
-    if (message_byte != 1_b && message_byte != 255_b && message_byte != 7_b)
+    if (route == EInboundRoute::Ignore)
       return;
     if (data.size() < 5) // {a:1}
     {
-      if (DataReceptionCallback.has_value())
-        DataReceptionCallback.value()(data);
+      DeliverData(data);
       return;
     }
-    try
+    // the text behind the message byte and its length is viewed in place, only UTF-16
+    // text is narrowed into a buffer that every thread keeps for its next message
+    thread_local std::string narrowed;
+    const auto message = UnrealMessageText(data, narrowed);
+    auto object = FindJsonObject(message);
+    if (!object.empty())
     {
-      // try parse string
-      std::string_view message(reinterpret_cast<char*>(data.data() + 1), data.size());
-      // the first character pair to see if the string is wchar_t or char
-      if (message[1] == '\0' && message[3] == '\0')
-      {
-        // wchar_t
-        lconnector(ELogVerbosity::Verbose) << "We assume that the 0x00 characters mean that the string is wchar_t" << std::endl;
-        auto wstringview = std::wstring_view(reinterpret_cast<wchar_t*>(data.data() + 1), data.size() / sizeof(wchar_t));
-        char* cstr = new char[wstringview.size()];
-        std::size_t it = 0;
-        std::generate(cstr, cstr + wstringview.size(), [&wstringview, &it]() { return static_cast<char>(wstringview[it++]); });
-        message = std::string_view(cstr, wstringview.size());
-      }
-      // find readable json subset
-      auto first_lbrace = message.find_first_of('{');
-      // find the rbrace that closes this lbrace by counting the braces
-      auto last_rbrace = first_lbrace;
-      int brace_count = 1;
-      for (auto i = first_lbrace + 1; i < message.length(); i++)
-      {
-        if (message[i] == '{')
-          brace_count++;
-        else if (message[i] == '}')
-          brace_count--;
-        if (brace_count == 0)
-        {
-          last_rbrace = i;
-          break;
-        }
-      }
-
-      if (first_lbrace < message.length() && last_rbrace < message.length())
-        //&& std::ranges::all_of(message.begin() + first_lbrace, message.begin() + last_rbrace, &isprint))
-      {
-
-        lconnector(ELogVerbosity::Verbose) << "Decoded message reception of size " << last_rbrace - first_lbrace + 1 << " of " << message.length() << std::endl;
-        if (MessageReceptionCallback.has_value())
-          MessageReceptionCallback.value()(std::string(message.substr(first_lbrace, last_rbrace - first_lbrace + 1)));
-      }
-      else if (DataReceptionCallback.has_value())
-      {
-        lconnector(ELogVerbosity::Verbose) << "Received data of size " << data.size() << std::endl;
-        DataReceptionCallback.value()(data);
-      }
+      if (verbose)
+        lconnector(ELogVerbosity::Verbose) << "Decoded message reception of size " << object.size() << " of " << message.size() << std::endl;
+      DeliverMessage(object);
     }
-    catch (const std::exception&)
+    else
     {
-      lconnector(ELogVerbosity::Warning) << "Encountered an error while trying to parse a string from the package." << std::endl;
-      lconnector(ELogVerbosity::Verbose) << "Error was: " << std::current_exception << std::endl;
-      lconnector(ELogVerbosity::Verbose) << "From data of size " << data.size() << std::endl;
-      lconnector(ELogVerbosity::Verbose) << "And first 10 characters: " << std::string(reinterpret_cast<char*>(data.data()), std::min(data.size(), static_cast<std::size_t>(10))) << std::endl;
+      if (verbose)
+        lconnector(ELogVerbosity::Verbose) << "Received data of size " << data.size() << std::endl;
+      DeliverData(data);
     }
   }
   else
   {
-    auto message = std::get<std::string>(messageordata);
-    lconnector(ELogVerbosity::Verbose) << "Direct message reception of size " << message.size() << std::endl;
-    if (MessageReceptionCallback.has_value())
-      MessageReceptionCallback.value()(message);
+    const auto& message = std::get<std::string>(messageordata);
+    if (verbose)
+      lconnector(ELogVerbosity::Verbose) << "Direct message reception of size " << message.size() << std::endl;
+    DeliverMessage(message);
   }
 }
 
@@ -643,6 +1366,23 @@ void Synavis::DataConnector::Initialize()
     });
   PeerConnection->onDataChannel([this](auto datachannel)
     {
+      if (datachannel->label() == "telemetry")
+      {
+        lconnector(ELogVerbosity::Info) << "Peer opened the telemetry channel" << std::endl;
+        TelemetryChannel = datachannel;
+        TelemetryCaching = true;
+        TelemetryChannel->onMessage([this](rtc::message_variant messageordata)
+          {
+            DataChannelMessageHandling(std::move(messageordata));
+          });
+        return;
+      }
+      if (datachannel->label().starts_with("stripe"))
+      {
+        lconnector(ELogVerbosity::Info) << "Peer opened stripe channel " << datachannel->label() << std::endl;
+        AddStripe(datachannel);
+        return;
+      }
       lconnector(ELogVerbosity::Warning) << "I received a channel I did not ask for" << std::endl;
       datachannel->onOpen([this]()
         {
@@ -650,7 +1390,7 @@ void Synavis::DataConnector::Initialize()
         });
       datachannel->onMessage([this](auto messageordata)
         {
-          DataChannelMessageHandling(messageordata);
+          DataChannelMessageHandling(std::move(messageordata));
         });
     });
   PeerConnection->onTrack([this](auto track)
@@ -691,10 +1431,32 @@ void Synavis::DataConnector::Initialize()
         lconnector(ELogVerbosity::Warning) << "****************************************************************************" << std::endl;
       }
       this->MaxMessageSize = std::min(DataChannel->maxMessageSize(), static_cast<std::size_t>(std::numeric_limits<uint16_t>::max() - 3));
-    
-      state_ = EConnectionState::CONNECTED;
+      Outgoing.Open();
+      State.Set(EConnectionState::CONNECTED);
+    });
+  DataChannel->onMessage([this](rtc::message_variant messageordata)
+    {
+      MainCounters.BytesReceived += std::visit([](const auto& Content) { return Content.size(); }, messageordata);
+      DataChannelMessageHandling(std::move(messageordata));
     });
-  DataChannel->onMessage(std::bind(&DataConnector::DataChannelMessageHandling, this, std::placeholders::_1));
+  for (unsigned i = 0; i < StripeChannelCount; ++i)
+  {
+    AddStripe(PeerConnection->createDataChannel("stripe" + std::to_string(i)));
+  }
+  if (OpenTelemetryChannel)
+  {
+    // telemetry is replaced every tick, so it is neither ordered nor retransmitted
+    rtc::DataChannelInit telemetry;
+    telemetry.reliability.type = rtc::Reliability::Type::Rexmit;
+    telemetry.reliability.unordered = true;
+    telemetry.reliability.rexmit = 0;
+    TelemetryChannel = PeerConnection->createDataChannel("telemetry", telemetry);
+    TelemetryChannel->onMessage([this](rtc::message_variant messageordata)
+      {
+        DataChannelMessageHandling(std::move(messageordata));
+      });
+    TelemetryCaching = true;
+  }
   DataChannel->onError([this](std::string error)
     {
       lconnector(ELogVerbosity::Error) << "DataChannel error: " << error << std::endl;
@@ -705,14 +1467,19 @@ void Synavis::DataConnector::Initialize()
       if (OnDataChannelAvailableCallback.has_value())
         OnDataChannelAvailableCallback.value()();
     });
+  DataChannel->setBufferedAmountLowThreshold(BufferedAmountLowWater);
   DataChannel->onBufferedAmountLow([this]()
     {
-      lconnector(ELogVerbosity::Info) << "DataChannel buffered amount low" << std::endl;
+      lconnector(ELogVerbosity::Verbose) << "DataChannel buffered amount low" << std::endl;
+      // the queue is drained off the network thread, sending from within this callback could re-enter it
+      SubmissionHandler.AddTask([this]() { Outgoing.Drain(); });
     });
   DataChannel->onClosed([this]()
     {
       lconnector(ELogVerbosity::Info) << "DataChannel is CLOSED again" << std::endl;
-      this->state_ = EConnectionState::CLOSED;
+      State.Set(EConnectionState::CLOSED);
+      // release producers that wait for the queue
+      Outgoing.Close();
       if (OnClosedCallback.has_value())
       {
         OnClosedCallback.value()();
@@ -720,7 +1487,7 @@ void Synavis::DataConnector::Initialize()
     });
   SignallingServer->onOpen([this]()
     {
-      state_ = EConnectionState::SIGNUP;
+      State.Set(EConnectionState::SIGNUP);
       lconnector(ELogVerbosity::Info) << "Signalling server connected" << std::endl;
       if (TakeFirstStep)
       {
@@ -740,7 +1507,7 @@ void Synavis::DataConnector::Initialize()
           lconnector(ELogVerbosity::Info) << "PeerConnection has no Media!" << std::endl;
         }
         SignallingServer->send(offer.dump());
-        state_ = EConnectionState::OFFERED;
+        State.Set(EConnectionState::OFFERED);
       }
     });
   SignallingServer->onMessage([this](auto messageordata)
@@ -838,9 +1605,9 @@ void Synavis::DataConnector::Initialize()
           if (RequiredCandidate.size() == 0)
           {
             lconnector(ELogVerbosity::Info) << "I have received all required candidates" << std::endl;
-            if (!TakeFirstStep && PeerConnection->localDescription().has_value() && state_ < EConnectionState::OFFERED)
+            if (!TakeFirstStep && PeerConnection->localDescription().has_value() && State.Get() < EConnectionState::OFFERED)
             {
-              this->state_ = EConnectionState::OFFERED;
+              State.Set(EConnectionState::OFFERED);
               SubmissionHandler.AddTask(std::bind(&DataConnector::CommunicateSDPs, this));
             }
             if (OnIceGatheringFinished.has_value())
@@ -909,7 +1676,7 @@ void Synavis::DataConnector::Initialize()
     });
   SignallingServer->onClosed([this]()
     {
-      state_ = EConnectionState::CLOSED;
+      State.Set(EConnectionState::CLOSED);
       auto unix_time = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 
       lconnector(ELogVerbosity::Info) << "Signalling server was closed at timestamp " << unix_time << std::endl;
@@ -917,7 +1684,7 @@ void Synavis::DataConnector::Initialize()
     });
   SignallingServer->onError([this](std::string error)
     {
-      state_ = EConnectionState::STARTUP;
+      State.Set(EConnectionState::STARTUP);
       SignallingServer->close();
       lconnector(ELogVerbosity::Error) << "Signalling server error: " << error << std::endl;
     });
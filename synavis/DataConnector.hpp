@@ -5,10 +5,22 @@
 #include <json.hpp>
 #include <span>
 #include <variant>
+#include <future>
+#include <atomic>
+#include <map>
+#include <unordered_map>
 #include <rtc/rtc.hpp>
 #include "Synavis/export.hpp"
 
 #include "Synavis.hpp"
+#include "MeshCodec.hpp"
+#include "Fragmentation.hpp"
+#include "MessageScan.hpp"
+#include "MessageDispatcher.hpp"
+#include "Telemetry.hpp"
+#include "Compression.hpp"
+#include "SharedMemory.hpp"
+#include "SendQueue.hpp"
 #include <rtc/peerconnection.hpp>
 #include <rtc/datachannel.hpp>
 #include <rtc/configuration.hpp>
@@ -26,24 +38,94 @@ public:
   virtual void Initialize();
   void StartSignalling();
 
-  virtual void SendData(rtc::binary Data);
-  void SendString(std::string Message);
-  void SendJSON(json Message);
+  virtual bool SendData(rtc::binary Data);
+  bool SendString(std::string Message);
+  bool SendJSON(json Message);
   bool SendBuffer(const std::span<const uint8_t>& Buffer, std::string Name, std::string Format = "raw");
   bool SendFloat64Buffer(const std::vector<double>& Buffer, std::string Name, std::string Format = "raw");
   bool SendFloat32Buffer(const std::vector<float>& Buffer, std::string Name, std::string Format = "raw");
   bool SendInt32Buffer(const std::vector<int32_t>& Buffer, std::string Name, std::string Format = "raw");
-  void SendGeometry(const std::vector<double>& Vertices, const std::vector<uint32_t>& Indices, std::string Name, std::optional<std::vector<double>> Normals = std::nullopt, 
+  bool SendGeometry(const std::vector<double>& Vertices, const std::vector<uint32_t>& Indices, std::string Name, std::optional<std::vector<double>> Normals = std::nullopt, 
                     std::optional<std::vector<double>> UVs = std::nullopt, std::optional<std::vector<double>> Tangents = std::nullopt, bool AutoMessage = true);
+
+  /**
+   * \brief Queues a buffer transmission on the transfer thread and returns immediately.
+   * The connector takes ownership of the buffer, so the caller can move its data in and
+   * continue working. Transfers are carried out one after another in submission order.
+   * \return A future that holds the result of SendBuffer once the transfer is complete
+   */
+  std::future<bool> SendBufferAsync(std::vector<uint8_t> Buffer, std::string Name, std::string Format = "raw");
+
+  /**
+   * \brief Queues a geometry transmission on the transfer thread, see SendBufferAsync.
+   * \return A future that is true if all buffers of the geometry were transmitted
+   */
+  std::future<bool> SendGeometryAsync(std::vector<double> Vertices, std::vector<uint32_t> Indices, std::string Name, std::optional<std::vector<double>> Normals = std::nullopt,
+                    std::optional<std::vector<double>> UVs = std::nullopt, std::optional<std::vector<double>> Tangents = std::nullopt, bool AutoMessage = true);
+  std::size_t GetPendingTransfers();
+
+  /**
+   * \brief Sends a JSON command tagged with a request id in its "pid" field. The reply
+   * that carries this id as "player_id" fulfils the returned future and is not passed to
+   * the message callbacks. Any number of requests may be outstanding at the same time.
+   * \param Timeout seconds after which the future fails with a std::runtime_error
+   * \return A future that holds the reply of the receiver
+   */
+  std::future<json> Request(json Command, double Timeout = 5.0);
+  std::size_t GetOutstandingRequests();
+
+  /**
+   * \brief Sends all meshes of the batch in a single raw buffer transfer named
+   * "geometrybatch", so the start and stop handshake is paid once for the whole batch.
+   * The receiver has to know this buffer, the Unreal plugin only accepts the buffers of
+   * SendGeometry. With RetryOnErrorResponse a rejected batch is tried three times.
+   * \return true if the transfer was completed
+   */
+  bool SendGeometryBatch(const GeometryBatch& Batch);
+
+  /**
+   * \brief Sends a mesh to a receiver on the same node through a shared memory ring.
+   * The mesh is encoded as a binary mesh message (MeshCodec.hpp) with the precision of
+   * the geometry encoding straight into the next free slot and announced with
+   * {"type":"sharedgeometry","ring":...,"sequence":...,"size":...,"name":...}.
+   * The slot is committed before the announcement. The receiver maps the ring by its name
+   * and on every announcement reads the slots with Peek and ReleaseSharedSlot until
+   * Pending is zero, this also picks up slots whose announcement was lost.
+   * \return false if no slot became free within the timeout, the mesh is larger than a slot
+   * or the announcement could not be sent
+   */
+  bool SendGeometryShared(std::shared_ptr<SharedMemoryRing> Ring, const MeshView& Geometry);
+  // releases the oldest slot of a ring that this side reads from and tells the sender
+  void ReleaseSharedSlot(SharedMemoryRing& Ring);
   EConnectionState GetState();
   std::optional<std::function<void(rtc::binary)>> DataReceptionCallback;
   std::optional<std::function<void(std::string)>> MessageReceptionCallback;
+  std::optional<std::function<void(std::span<const std::byte>)>> DataViewCallback;
+  std::optional<std::function<void(std::string_view)>> MessageViewCallback;
   std::optional<std::string> IP {std::nullopt};
   std::optional<std::pair<int, int>> PortRange {std::nullopt};
 
 
   void SetDataCallback(std::function<void(rtc::binary)> Callback);
   void SetMessageCallback(std::function<void(std::string)> Callback);
+  /**
+   * \brief Receives data without copying it out of the data channel message.
+   * The view is only valid during the call. It is called in addition to the data callback.
+   */
+  void SetDataViewCallback(std::function<void(std::span<const std::byte>)> Callback);
+  /**
+   * \brief Receives JSON messages as views into the data channel message, so that
+   * reception does not allocate. The view is only valid during the call.
+   * It is called in addition to the message callback.
+   */
+  void SetMessageViewCallback(std::function<void(std::string_view)> Callback);
+  /**
+   * \brief Registers a handler for JSON messages with this "type". Only the type is
+   * read to find the handler, the message is parsed when the handler asks for its
+   * Document(). Handled messages are not passed to the message callbacks.
+   */
+  void OnMessageType(std::string Type, MessageDispatcher::Handler Callback);
+  void RemoveMessageType(std::string_view Type);
   auto GetMessageCallback() { return MessageReceptionCallback; }
   auto GetDataCallback() { return DataReceptionCallback; }
   std::shared_ptr<rtc::DataChannel> DataChannel;
@@ -65,6 +147,24 @@ public:
   void SetRetryOnErrorResponse(bool Retry) { RetryOnErrorResponse = Retry; }
 
   void LockUntilConnected(unsigned additional_wait = 0);
+  /**
+   * \brief Sleeps until the connection reached Target or a later state (closed or failed).
+   * \param Timeout in seconds, negative values wait forever
+   * \return false if the timeout passed first
+   */
+  bool WaitForState(EConnectionState Target, double Timeout = -1.0);
+  /**
+   * \brief Sleeps as long as the connection is in Target, e.g. until a connection ends.
+   * \return false if the timeout passed first
+   */
+  bool WaitWhileState(EConnectionState Target, double Timeout = -1.0);
+  /**
+   * \brief The callback is called with the previous and the new state on every transition,
+   * on the thread that caused the transition.
+   * \return An id for RemoveStateCallback
+   */
+  std::size_t AddStateCallback(ConnectionState::TransitionCallback Callback);
+  void RemoveStateCallback(std::size_t Id);
 
   /**
    * \brief Set the DontWaitForAnswer flag. If set to true, the DataConnector
@@ -81,10 +181,149 @@ public:
    * \param Fail 
    */
   void SetFailIfNotComplete(bool Fail) { FailIfNotComplete = Fail; }
+
+  /**
+   * \brief Sets the wire format of SendGeometry. Base64 uses JSON messages and buffer
+   * transfers, the binary encodings send a single mesh message (see MeshCodec.hpp)
+   * through SendData with float, double or 16-bit quantized attributes. The receiver
+   * must understand binary mesh messages.
+   * \param Encoding
+   */
+  void SetGeometryEncoding(EGeometryEncoding Encoding) { GeometryEncoding = Encoding; }
+  EGeometryEncoding GetGeometryEncoding() const { return GeometryEncoding; }
+
+  /**
+   * \brief Renumbers the vertices of binary geometry messages in the order of their
+   * first use before encoding them. The mesh is unchanged but its vertex order is
+   * not the one that was passed to SendGeometry.
+   * \param Optimize
+   */
+  void SetOptimizeVertexOrder(bool Optimize) { OptimizeGeometryOrder = Optimize; }
+
+  /**
+   * \brief Enables coalescing of SendJSON messages. Messages are collected and sent together
+   * as {"type":"multi","messages":[...]} once the oldest one waited for Delay seconds or
+   * MaxBytes are reached, other sends flush the collected messages first to keep the order.
+   * The receiver must unpack these messages, DataConnector does this for incoming messages.
+   * While coalescing, SendJSON returning true only means that the message was accepted;
+   * it reports a failed send only if the message filled the collection and was sent at once.
+   * \param Coalesce
+   * \param Delay longest time in seconds that a message is held back
+   * \param MaxBytes size of the collected messages at which they are sent right away
+   */
+  void SetMessageCoalescing(bool Coalesce, double Delay = 0.001, std::size_t MaxBytes = 16 * 1024);
+  // sends the coalesced messages right away
+  void FlushMessages();
+
+  /**
+   * \brief Enables incremental geometry updates for the binary encodings. The connector
+   * keeps a copy of the last mesh that was sent under each name and only sends the changed
+   * vertex ranges and appended triangles when the same name is sent again. A full mesh is
+   * sent if the patch would be larger than Threshold times the full message in the current
+   * geometry encoding. The copy is kept once a message was accepted for sending, call
+   * ForgetGeometry if the receiver lost a mesh. Vertex reordering is not applied to
+   * incremental meshes.
+   * \param Incremental
+   * \param Threshold
+   */
+  void SetIncrementalGeometry(bool Incremental, double Threshold = 0.5);
+  // drops the copy of a mesh, the next SendGeometry with this name sends the full mesh
+  void ForgetGeometry(std::string Name);
+
+  /**
+   * \brief Sets the number of chunks that SendBuffer keeps in flight. The window
+   * is offered to the receiver in the buffer start message and only used if the
+   * receiver answers with its own window size; chunks then carry their index and
+   * are acknowledged individually. The default window of 1 disables the negotiation,
+   * which receivers without windowed transfers require.
+   * \param Window
+   */
+  void SetTransferWindow(unsigned Window) { TransferWindow = Window; }
+  unsigned GetTransferWindow() const { return TransferWindow; }
+
+  /**
+   * \brief Compresses the chunks of raw SendBuffer transfers, this includes geometry
+   * batches. Every chunk is compressed on its own and stored instead if it does not shrink
+   * below Ratio of its size; after a few stored chunks in a row the rest of the transfer
+   * is not compressed. The codec is announced in the buffer start message and the receiver
+   * must decode the chunks (see Compression.hpp). Base64 transfers are not compressed.
+   * \param Level None, Fast or Strong
+   * \param Ratio largest compressed size, relative to the chunk, that is still sent compressed
+   */
+  void SetBufferCompression(ECompression Level, double Ratio = 0.9) { BufferCompression = Level; BufferCompressionRatio = Ratio; }
+  ECompression GetBufferCompression() const { return BufferCompression; }
   void CommunicateSDPs();
   void WriteSDPsToFile(std::string Filename);
   void SetLogVerbosity(ELogVerbosity Verbosity) { LogVerbosity = Verbosity; }
 
+  /**
+   * \brief Configures the outgoing queue. Messages are handed to the data channel
+   * while its buffered amount is below HighWater, otherwise they are queued and
+   * released once libdatachannel reports that the buffered amount fell below LowWater.
+   * \param MaxMessages number of queued messages at which the back pressure policy applies
+   * \param HighWater buffered amount in bytes above which messages are queued
+   * \param LowWater buffered amount in bytes at which the queue is drained again
+   */
+  void SetSendQueueLimits(std::size_t MaxMessages, std::size_t HighWater, std::size_t LowWater);
+
+  /**
+   * \brief Sets whether SendData, SendString and SendJSON block while the outgoing
+   * queue is full or return false right away. Buffer transfers always block.
+   * \param Policy
+   */
+  void SetBackPressurePolicy(EBackPressurePolicy Policy) { Outgoing.SetPolicy(Policy); }
+  EBackPressurePolicy GetBackPressurePolicy() { return Outgoing.GetPolicy(); }
+  std::size_t GetSendQueueDepth();
+  std::size_t GetBufferedAmount();
+
+  /**
+   * \brief Opens Count additional data channels ("stripe0", "stripe1", ...) on the peer
+   * connection with the next Initialize. SendData messages that are fragmented rotate
+   * their fragments in ranges over the main channel and all open stripes, the receiver
+   * reassembles them by fragment index. The receiving connector accepts stripes opened by
+   * its peer on its own. Unreal only reads the main channel, so keep this at 0 there.
+   * SendBuffer always uses the main channel.
+   */
+  void SetStripeChannels(unsigned Count) { StripeChannelCount = Count; }
+  std::size_t GetOpenStripeChannels();
+
+  struct ChannelStatistics
+  {
+    std::string Label;
+    std::size_t BytesSent;
+    std::size_t BytesReceived;
+    std::size_t MessagesSent;
+    std::size_t BufferedAmount;
+    // bytes per second between the first and the last message handed to the channel
+    double SendRate;
+  };
+  /**
+   * \brief Traffic of the main channel (first entry) and every stripe channel.
+   */
+  std::vector<ChannelStatistics> GetChannelStatistics();
+
+  /**
+   * \brief Opens a "telemetry" data channel with the next Initialize. It is unordered and
+   * never retransmits, so pose updates do not wait behind geometry transfers and a lost
+   * update is simply replaced by the next one. This also enables the telemetry cache.
+   * The peer accepts the channel on its own, Unreal keeps using the main channel.
+   */
+  void SetTelemetryChannel(bool Open) { OpenTelemetryChannel = Open; }
+  /**
+   * \brief Sends {"type":"track","seq":..,"data":Data} over the telemetry channel, where
+   * Data maps "object.property" to values. Telemetry is never queued.
+   * \return false if the telemetry channel is not open or too full
+   */
+  bool SendTelemetry(json Data);
+  /**
+   * \brief Keeps the latest value of every "object.property" of received track messages.
+   * Messages whose "seq" is older than the cached values are dropped before they reach the
+   * handlers and callbacks, messages without a "seq" are ordered by their arrival.
+   */
+  void SetTelemetryCache(bool Cache) { TelemetryCaching = Cache; }
+  std::optional<json> GetTelemetry(const std::string& Key);
+  json GetTelemetrySnapshot();
+
   // webrtc settings
   void SetIPForICE(std::string IP) { rtcconfig_.bindAddress = IP; }
   void SetPortRangeForICE(uint16_t Min, uint16_t Max) { rtcconfig_.portRangeBegin = Min; rtcconfig_.portRangeBegin = Max; }
@@ -124,9 +363,27 @@ protected:
 
   inline void DataChannelMessageHandling(rtc::message_variant Data);
 
+  // frames a text message the way Unreal expects it
+  rtc::binary FrameMessage(std::string_view Message);
+  // passes a received JSON message on, coalesced messages are unpacked
+  void DeliverMessage(std::string_view Message);
+  void DeliverData(std::span<const std::byte> Data);
+  MessageDispatcher MessageHandlers;
+  // the replies of the receiver to a buffer transfer, these come before the registered handlers
+  MessageDispatcher TransferHandlers;
+  EMeshScalar GeometryPrecision() const;
+  // the frame of the collected messages, this empties the collection
+  std::optional<rtc::binary> TakeCoalescedLocked();
+  // sends the collected messages without holding CoalesceLock while the queue blocks
+  bool FlushCoalesced();
+  void CoalesceRun();
+
+  // all outgoing data channel messages pass through here to honour the back pressure
+  bool SubmitMessage(rtc::binary Message, bool ForceBlock = false);
+
   ELogVerbosity LogVerbosity = ELogVerbosity::Warning;
 
-  EConnectionState state_;
+  ConnectionState State;
 
   rtc::Configuration rtcconfig_;
   rtc::Configuration webconfig_;
@@ -140,6 +397,17 @@ protected:
   bool RetryOnErrorResponse = false;
   bool DontWaitForAnswer = false;
   double TimeOut = 10.0;
+  unsigned TransferWindow = 1;
+  ECompression BufferCompression = ECompression::None;
+  double BufferCompressionRatio = 0.9;
+  EGeometryEncoding GeometryEncoding = EGeometryEncoding::Base64;
+  bool OptimizeGeometryOrder = false;
+  bool IncrementalGeometry = false;
+  double GeometryPatchThreshold = 0.5;
+  std::unordered_map<std::string, Mesh> SentGeometry;
+  // rings that SendGeometryShared wrote to, woken when the receiver releases a slot
+  std::mutex SharedRingLock;
+  std::unordered_map<std::string, std::weak_ptr<SharedMemoryRing>> SharedRings;
   unsigned int MessagesReceived{ 0 };
   std::size_t MaxMessageSize{ static_cast<std::size_t>(-1) };
   std::vector<std::string> RequiredCandidate;
@@ -148,6 +416,72 @@ protected:
     {"SignallingPort",int()}
   };
   WorkerThread SubmissionHandler;
+
+  SendQueue Outgoing;
+  // the stripes and the telemetry channel use the watermarks of the send queue
+  std::atomic<std::size_t> BufferedAmountHighWater{ 16 * 1024 * 1024 };
+  std::atomic<std::size_t> BufferedAmountLowWater{ 4 * 1024 * 1024 };
+
+  // traffic counters of one data channel, these are updated from several threads
+  struct ChannelCounters
+  {
+    std::atomic<std::size_t> BytesSent{ 0 };
+    std::atomic<std::size_t> BytesReceived{ 0 };
+    std::atomic<std::size_t> MessagesSent{ 0 };
+    std::atomic<std::chrono::steady_clock::rep> FirstSend{ 0 };
+    std::atomic<std::chrono::steady_clock::rep> LastSend{ 0 };
+    void Sent(std::size_t Bytes);
+    ChannelStatistics Statistics(std::string Label, std::size_t BufferedAmount) const;
+  };
+  struct Stripe
+  {
+    std::shared_ptr<rtc::DataChannel> Channel;
+    ChannelCounters Counters;
+    // a sender waits here while the buffered amount of the channel is too high
+    std::mutex SpaceLock;
+    std::condition_variable Space;
+  };
+  void AddStripe(std::shared_ptr<rtc::DataChannel> Channel);
+  bool SendStriped(std::span<const std::byte> Data, const std::vector<std::shared_ptr<Stripe>>& Targets);
+  bool SendOnStripe(Stripe& Target, rtc::binary Message);
+  unsigned StripeChannelCount{ 0 };
+  std::mutex StripeLock;
+  std::vector<std::shared_ptr<Stripe>> Stripes;
+  ChannelCounters MainCounters;
+
+  // returns false for track messages that only carry stale values
+  bool AcceptTelemetry(LazyMessage& Message);
+  bool OpenTelemetryChannel{ false };
+  std::atomic<bool> TelemetryCaching{ false };
+  std::shared_ptr<rtc::DataChannel> TelemetryChannel;
+  TelemetryCache Telemetry;
+  std::atomic<std::uint64_t> TelemetrySequence{ 0 };
+  std::atomic<std::uint64_t> TelemetryArrivals{ 0 };
+
+  // binary messages above MaxMessageSize are sent in fragments
+  std::atomic<std::uint32_t> NextMessageId{ 0 };
+  Reassembler Fragments;
+
+  std::mutex CoalesceLock;
+  // taken before CoalesceLock, keeps the flushed frames in order while they are submitted
+  std::mutex CoalesceFlushLock;
+  std::condition_variable CoalesceCondition;
+  // comma separated messages that wait for the flush
+  std::string CoalesceBuffer;
+  std::size_t CoalescedMessages{ 0 };
+  std::chrono::steady_clock::time_point CoalesceDeadline;
+  std::chrono::steady_clock::duration CoalesceDelay{ std::chrono::milliseconds(1) };
+  std::size_t CoalesceMaxBytes{ 16 * 1024 };
+  std::atomic<bool> CoalesceMessages{ false };
+  std::future<void> CoalesceThread;
+
+  RequestTracker Requests;
+
+  // buffer transfers register the acknowledgement handlers, so only one may run at a time
+  std::recursive_mutex TransferLock;
+  std::atomic<std::size_t> PendingTransfers{ 0 };
+  // declared last so that it is stopped before the state that transfers rely on is destroyed
+  WorkerThread TransferHandler;
 };
 
 }
@@ -0,0 +1,433 @@
+#include "Depacketizer.hpp"
+#include "Synavis.hpp"
+
+#include <algorithm>
+
+#include <rtc/rtc.hpp>
+
+static const Synavis::Logger::LoggerInstance ldepacketizer = Synavis::Logger::Get()->LogStarter("Depacketizer");
+
+namespace
+{
+  constexpr std::byte StartCode[4] = { std::byte{ 0 }, std::byte{ 0 }, std::byte{ 0 }, std::byte{ 1 } };
+
+  // H.264 NAL unit types (RFC 6184 section 5.2)
+  constexpr uint8_t NalIDR = 5;
+  constexpr uint8_t NalSPS = 7;
+  constexpr uint8_t NalSTAPA = 24;
+  constexpr uint8_t NalFUA = 28;
+
+  uint8_t NalType(std::byte Header)
+  {
+    return static_cast<uint8_t>(Header) & 0x1F;
+  }
+
+  // the VP8 and VP9 picture ID, the M bit of the first byte selects 15 instead of 7 bits
+  bool ReadPictureId(std::span<const std::byte> Payload, std::size_t& Index, std::optional<uint16_t>& Id)
+  {
+    if (Index >= Payload.size())
+      return false;
+    const auto high = static_cast<uint8_t>(Payload[Index++]);
+    if (!(high & 0x80))
+    {
+      Id = high;
+      return true;
+    }
+    if (Index >= Payload.size())
+      return false;
+    Id = static_cast<uint16_t>(((high & 0x7F) << 8) | static_cast<uint8_t>(Payload[Index++]));
+    return true;
+  }
+}
+
+namespace Synavis
+{
+  void PacketDepacketizer::AddPacket(std::span<const std::byte> Packet)
+  {
+    if (Packet.size() < sizeof(uint32_t) * 3)
+      return;
+    auto* header = reinterpret_cast<const rtc::RtpHeader*>(Packet.data());
+    // the CSRC list and the extension header must be inside the packet before they are read
+    if (Packet.size() < header->getSize() + (header->extension() ? sizeof(uint32_t) : 0))
+      return;
+    const auto body = static_cast<std::size_t>(header->getBody() - reinterpret_cast<const char*>(Packet.data()));
+    if (header->version() != 2 || body > Packet.size())
+    {
+      ldepacketizer(ELogVerbosity::Verbose) << "Ignoring malformed RTP packet" << std::endl;
+      return;
+    }
+    auto payload = Packet.subspan(body);
+    if (header->padding())
+    {
+      // the last byte counts the padding bytes including itself
+      const auto padding = static_cast<std::size_t>(Packet.back());
+      if (padding > payload.size())
+        return;
+      payload = payload.first(payload.size() - padding);
+    }
+    // the buffer of the previous frame is reused
+    if (complete)
+    {
+      complete = false;
+      started = false;
+    }
+    const uint16_t seq = header->seqNumber();
+    const bool gap = sequence.has_value() && seq != static_cast<uint16_t>(sequence.value() + 1);
+    sequence = seq;
+    if (started && header->timestamp() != timestamp)
+    {
+      // the packet with the marker bit of the previous frame never arrived
+      ldepacketizer(ELogVerbosity::Debug) << "Frame " << timestamp << " ended without its marker" << std::endl;
+      DropFrame();
+    }
+    if (!started)
+    {
+      started = true;
+      broken = false;
+      keyframe = false;
+      timestamp = header->timestamp();
+      frame.clear();
+      BeginFrame();
+    }
+    // after a complete frame, a gap can only have taken the start of this one
+    if (gap)
+    {
+      ldepacketizer(ELogVerbosity::Debug) << "Packet loss before sequence number " << seq << std::endl;
+      broken = true;
+    }
+    if (!broken && !payload.empty() && !AddPayload(payload))
+    {
+      ldepacketizer(ELogVerbosity::Debug) << "Malformed payload in sequence number " << seq << std::endl;
+      broken = true;
+    }
+    if (header->marker())
+    {
+      if (broken || !EndFrame())
+        DropFrame();
+      else
+        complete = !frame.empty();
+    }
+  }
+
+  std::span<const std::byte> PacketDepacketizer::GetFrame() const
+  {
+    if (!complete)
+      return {};
+    return frame;
+  }
+
+  void PacketDepacketizer::ResetPacket()
+  {
+    frame.clear();
+    timestamp = static_cast<uint32_t>(-1);
+    started = false;
+    broken = false;
+    complete = false;
+    keyframe = false;
+    sequence.reset();
+  }
+
+  void PacketDepacketizer::DropFrame()
+  {
+    dropped++;
+    frame.clear();
+    started = false;
+    broken = false;
+    keyframe = false;
+  }
+
+  VP8Depacketizer::~VP8Depacketizer()
+  {
+  }
+
+  void VP8Depacketizer::BeginFrame()
+  {
+    pictureid.reset();
+  }
+
+  bool VP8Depacketizer::AddPayload(std::span<const std::byte> Payload)
+  {
+    /*       Westin et al. (2016), RTP Payload Format for VP8 Video
+     *
+     *             0 1 2 3 4 5 6 7
+     *            +-+-+-+-+-+-+-+-+
+     *            |X|R|N|S|R| PID | (REQUIRED)
+     *            +-+-+-+-+-+-+-+-+
+     *       X:   |I|L|T|K| RSV   | (OPTIONAL)
+     *            +-+-+-+-+-+-+-+-+
+     *       I:   |M| PictureID   | (OPTIONAL)
+     *            +-+-+-+-+-+-+-+-+
+     *            |   PictureID   |
+     *            +-+-+-+-+-+-+-+-+
+     *       L:   |   TL0PICIDX   | (OPTIONAL)
+     *            +-+-+-+-+-+-+-+-+
+     *       T/K: |TID|Y| KEYIDX  | (OPTIONAL)
+     *            +-+-+-+-+-+-+-+-+
+     */
+    const auto descriptor = static_cast<uint8_t>(Payload[0]);
+    std::size_t i = 1;
+    std::optional<uint16_t> id;
+    if (descriptor & 0x80)
+    {
+      if (i >= Payload.size())
+        return false;
+      const auto extension = static_cast<uint8_t>(Payload[i++]);
+      if ((extension & 0x80) && !ReadPictureId(Payload, i, id))
+        return false;
+      if (extension & 0x40)
+        i++;
+      if (extension & 0x30)
+        i++;
+    }
+    if (i >= Payload.size())
+      return false;
+    // S with partition index 0 marks the first packet of a frame
+    const bool start = (descriptor & 0x10) && (descriptor & 0x07) == 0;
+    if (frame.empty())
+    {
+      if (!start)
+        return false;
+      pictureid = id;
+      // the P bit of the VP8 payload header is 0 for key frames
+      keyframe = (static_cast<uint8_t>(Payload[i]) & 0x01) == 0;
+    }
+    else if (start || id != pictureid)
+    {
+      return false;
+    }
+    frame.insert(frame.end(), Payload.begin() + i, Payload.end());
+    return true;
+  }
+
+  VP9Depacketizer::~VP9Depacketizer()
+  {
+  }
+
+  void VP9Depacketizer::BeginFrame()
+  {
+    pictureid.reset();
+    layers.clear();
+    layerstart = 0;
+    open = false;
+  }
+
+  bool VP9Depacketizer::AddPayload(std::span<const std::byte> Payload)
+  {
+    /*       Uberti et al. (2024), RTP Payload Format for VP9 Video
+     *
+     *             0 1 2 3 4 5 6 7
+     *            +-+-+-+-+-+-+-+-+
+     *            |I|P|L|F|B|E|V|Z| (REQUIRED)
+     *            +-+-+-+-+-+-+-+-+
+     *       I:   |M| PICTURE ID  | (RECOMMENDED)
+     *            +-+-+-+-+-+-+-+-+
+     *       M:   | EXTENDED PID  | (RECOMMENDED)
+     *            +-+-+-+-+-+-+-+-+
+     *       L:   | TID |U| SID |D| (CONDITIONALLY RECOMMENDED)
+     *            +-+-+-+-+-+-+-+-+
+     *            |   TL0PICIDX   | (CONDITIONALLY REQUIRED, non-flexible mode)
+     *            +-+-+-+-+-+-+-+-+
+     *   F and P: | P_DIFF      |N| (CONDITIONALLY REQUIRED, up to 3 times)
+     *            +-+-+-+-+-+-+-+-+
+     *       V:   | SS            | (OPTIONAL)
+     *            +-+-+-+-+-+-+-+-+
+     */
+    VP9Payload descriptor{ static_cast<uint8_t>(Payload[0]), 0 };
+    std::size_t i = 1;
+    std::optional<uint16_t> id;
+    if (descriptor.picture_id_present() && !ReadPictureId(Payload, i, id))
+      return false;
+    uint8_t spatial = 0;
+    if (descriptor.layer_idx())
+    {
+      if (i >= Payload.size())
+        return false;
+      spatial = (static_cast<uint8_t>(Payload[i++]) >> 1) & 0x07;
+      if (!descriptor.flexible())
+        i++;
+    }
+    if (descriptor.flexible() && descriptor.inter_pic_predicted())
+    {
+      // the N bit marks that another reference follows
+      for (int reference = 0;; ++reference)
+      {
+        if (i >= Payload.size() || reference == 3)
+          return false;
+        if (!(static_cast<uint8_t>(Payload[i++]) & 0x01))
+          break;
+      }
+    }
+    if (descriptor.scalability())
+    {
+      // N_S|Y|G, optionally the resolutions of the spatial layers and the picture group
+      if (i >= Payload.size())
+        return false;
+      const auto structure = static_cast<uint8_t>(Payload[i++]);
+      if (structure & 0x10)
+        i += 4 * ((structure >> 5) + 1);
+      if (structure & 0x08)
+      {
+        if (i >= Payload.size())
+          return false;
+        const auto pictures = static_cast<uint8_t>(Payload[i++]);
+        for (uint8_t picture = 0; picture < pictures; ++picture)
+        {
+          if (i >= Payload.size())
+            return false;
+          i += 1 + ((static_cast<uint8_t>(Payload[i]) >> 2) & 0x03);
+        }
+      }
+    }
+    if (i >= Payload.size())
+      return false;
+    if (descriptor.start())
+    {
+      // a layer frame cannot begin before the previous one ended
+      if (open)
+        return false;
+      if (frame.empty())
+      {
+        pictureid = id;
+        keyframe = !descriptor.inter_pic_predicted() && spatial == 0;
+      }
+      else if (id != pictureid)
+      {
+        return false;
+      }
+      open = true;
+      layerstart = frame.size();
+    }
+    else if (!open || id != pictureid)
+    {
+      return false;
+    }
+    frame.insert(frame.end(), Payload.begin() + i, Payload.end());
+    if (descriptor.end())
+    {
+      layers.push_back(frame.size() - layerstart);
+      open = false;
+    }
+    return true;
+  }
+
+  bool VP9Depacketizer::EndFrame()
+  {
+    if (open || layers.empty() || layers.size() > 8)
+      return false;
+    if (layers.size() == 1)
+      return true;
+    // superframe index: marker, the sizes in little endian with the fewest bytes that fit, marker
+    const auto largest = *std::max_element(layers.begin(), layers.end());
+    uint8_t bytes = 1;
+    while (bytes < 4 && (largest >> (8 * bytes)) != 0)
+      bytes++;
+    if ((largest >> (8 * bytes)) != 0)
+      return false;
+    const auto marker = static_cast<std::byte>(0xC0 | ((bytes - 1) << 3) | (layers.size() - 1));
+    frame.push_back(marker);
+    for (const auto size : layers)
+    {
+      for (uint8_t b = 0; b < bytes; ++b)
+        frame.push_back(static_cast<std::byte>((size >> (8 * b)) & 0xFF));
+    }
+    frame.push_back(marker);
+    return true;
+  }
+
+  H264Depacketizer::~H264Depacketizer()
+  {
+  }
+
+  void H264Depacketizer::BeginFrame()
+  {
+    fragmented = false;
+  }
+
+  bool H264Depacketizer::EndFrame()
+  {
+    // the last NAL unit of the frame is still missing fragments
+    return !fragmented;
+  }
+
+  void H264Depacketizer::AppendNal(std::span<const std::byte> Nal)
+  {
+    const auto type = NalType(Nal[0]);
+    if (type == NalIDR || type == NalSPS)
+      keyframe = true;
+    frame.insert(frame.end(), std::begin(StartCode), std::end(StartCode));
+    frame.insert(frame.end(), Nal.begin(), Nal.end());
+  }
+
+  bool H264Depacketizer::AddPayload(std::span<const std::byte> Payload)
+  {
+    /*       Wang et al. (2016), RTP Payload format for High Efficiency Video Coding (HEVC)
+     *       and Wang, et al. (2011), RTP Payload Format for H.264 Video
+     *       Informative note: The first byte of a NAL unit co-serves as the
+     *        RTP payload header.
+     *
+     *       0                   1                   2                   3
+     *       0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+     *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     *      |F|NRI|  Type   |                                               |
+     *      +-+-+-+-+-+-+-+-+                                               |
+     *      |                                                               |
+     *      |               Bytes 2..n of a single NAL unit                 |
+     *      |                                                               |
+     *      |                               +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     *      |                               :...OPTIONAL RTP padding        |
+     *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     */
+    const auto type = NalType(Payload[0]);
+    if (type >= 1 && type < NalSTAPA)
+    {
+      // a fragmented NAL unit cannot be interrupted by another one
+      if (fragmented)
+        return false;
+      AppendNal(Payload);
+      return true;
+    }
+    if (type == NalSTAPA)
+    {
+      // STAP-A: the payload header is followed by NAL units with a 16-bit size each
+      if (fragmented)
+        return false;
+      std::size_t i = 1;
+      while (i < Payload.size())
+      {
+        if (Payload.size() - i < 2)
+          return false;
+        const auto size = (static_cast<std::size_t>(Payload[i]) << 8) | static_cast<std::size_t>(Payload[i + 1]);
+        i += 2;
+        if (size == 0 || size > Payload.size() - i)
+          return false;
+        AppendNal(Payload.subspan(i, size));
+        i += size;
+      }
+      return true;
+    }
+    if (type == NalFUA)
+    {
+      // FU-A: the indicator carries F and NRI, the FU header start, end and the NAL type
+      if (Payload.size() < 3)
+        return false;
+      const auto fu = static_cast<uint8_t>(Payload[1]);
+      const bool start = fu & 0x80;
+      const bool end = fu & 0x40;
+      if (start == fragmented)
+        return false;
+      if (start)
+      {
+        const auto nal = static_cast<std::byte>((static_cast<uint8_t>(Payload[0]) & 0xE0) | (fu & 0x1F));
+        if (NalType(nal) == NalIDR || NalType(nal) == NalSPS)
+          keyframe = true;
+        frame.insert(frame.end(), std::begin(StartCode), std::end(StartCode));
+        frame.push_back(nal);
+      }
+      frame.insert(frame.end(), Payload.begin() + 2, Payload.end());
+      fragmented = !end;
+      return true;
+    }
+    // STAP-B, MTAP and FU-B only exist in the interleaved mode, which WebRTC does not use
+    return false;
+  }
+}
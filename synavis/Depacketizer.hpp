@@ -0,0 +1,144 @@
+#ifndef SYNAVIS_DEPACKETIZER_HPP
+#define SYNAVIS_DEPACKETIZER_HPP
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+#pragma pack(push, 1)
+  struct SYNAVIS_EXPORT VP9Payload
+  {
+    uint8_t payload;
+    bool picture_id_present() { return payload & 0b10000000; }
+    bool inter_pic_predicted() { return payload & 0b01000000; }
+    bool layer_idx() { return payload & 0b00100000; }
+    bool flexible() { return payload & 0b00010000; }
+    bool start() { return payload & 0b00001000; }
+    bool end() { return payload & 0b00000100; }
+    bool scalability() { return payload & 0b00000010; }
+    bool reserved() { return payload & 0b00000001; }
+    uint8_t ext_payload;
+    bool extended_pid() { return ext_payload & 0b10000000; }
+  };
+#pragma pack(pop)
+
+  // Reassembles the frames of a video stream from its RTP packets. The packets must be
+  // added in sequence order, reordering is left to the caller. A frame is complete once
+  // the packet with the marker bit arrived and no sequence number was missing since the
+  // first packet of the frame. Frames with gaps or malformed payloads are dropped.
+  // The frame buffer is kept between frames, so its memory is reused.
+  class SYNAVIS_EXPORT PacketDepacketizer
+  {
+  public:
+    PacketDepacketizer() = default;
+    virtual ~PacketDepacketizer() = default;
+
+    // this function should be called in sequence order
+    // package reception handling is NOT handled here
+    // this is purely for depacketizing the data
+    void AddPacket(std::span<const std::byte> Packet);
+    bool IsFrameComplete() const { return complete; }
+    // the complete frame, valid until the next call of AddPacket or ResetPacket
+    std::span<const std::byte> GetFrame() const;
+    uint32_t GetTimestamp() const { return timestamp; }
+    bool IsKeyFrame() const { return keyframe; }
+    std::size_t GetDroppedFrames() const { return dropped; }
+    // forgets the current frame and the sequence number of the last packet
+    virtual void ResetPacket();
+
+  protected:
+    // called before the first payload of every frame
+    virtual void BeginFrame() {}
+    // appends the payload of a packet to the frame, returns false if it is malformed
+    virtual bool AddPayload(std::span<const std::byte> Payload) = 0;
+    // called for the packet with the marker bit, returns false if the frame is cut off
+    virtual bool EndFrame() { return true; }
+
+    uint32_t timestamp { static_cast<uint32_t>(-1) };
+    std::vector<std::byte> frame;
+    bool keyframe { false };
+
+  private:
+    void DropFrame();
+    bool started { false };
+    bool broken { false };
+    bool complete { false };
+    std::optional<uint16_t> sequence;
+    std::size_t dropped { 0 };
+  };
+
+  // RFC 7741: the payload descriptor with the optional picture ID, TL0PICIDX and
+  // TID/KEYIDX fields is removed, the frames are the plain VP8 frames. A frame has to
+  // start with the beginning of partition 0 and keep its picture ID in every packet.
+  class SYNAVIS_EXPORT VP8Depacketizer : public PacketDepacketizer
+  {
+  public:
+    VP8Depacketizer() = default;
+    virtual ~VP8Depacketizer() override;
+
+    // the 7 or 15 bit picture ID of the last frame, if the sender includes it
+    std::optional<uint16_t> GetPictureId() const { return pictureid; }
+
+  protected:
+    virtual void BeginFrame() override;
+    virtual bool AddPayload(std::span<const std::byte> Payload) override;
+
+  private:
+    std::optional<uint16_t> pictureid;
+  };
+
+  // RFC 9628 in flexible and non-flexible mode. Every packet carries a part of one
+  // layer frame between its B (beginning) and E (end) bits, the layer frames of one
+  // picture share the RTP timestamp. Pictures with more than one spatial layer are
+  // emitted as a superframe, i.e. the layer frames followed by the superframe index
+  // that the decoder uses to split them again.
+  class SYNAVIS_EXPORT VP9Depacketizer : public PacketDepacketizer
+  {
+  public:
+    VP9Depacketizer() = default;
+    virtual ~VP9Depacketizer() override;
+
+    std::optional<uint16_t> GetPictureId() const { return pictureid; }
+    // number of layer frames in the last frame
+    std::size_t GetLayerFrames() const { return layers.size(); }
+
+  protected:
+    virtual void BeginFrame() override;
+    virtual bool AddPayload(std::span<const std::byte> Payload) override;
+    virtual bool EndFrame() override;
+
+  private:
+    std::optional<uint16_t> pictureid;
+    // the sizes of the completed layer frames
+    std::vector<std::size_t> layers;
+    std::size_t layerstart { 0 };
+    bool open { false };
+  };
+
+  // RFC 6184 in non-interleaved mode (packetization-mode 0 and 1), which is what WebRTC
+  // uses: single NAL unit packets, STAP-A aggregates and FU-A fragments. The frames are
+  // Annex B access units, every NAL unit is preceded by a four byte start code.
+  class SYNAVIS_EXPORT H264Depacketizer : public PacketDepacketizer
+  {
+  public:
+    H264Depacketizer() = default;
+    virtual ~H264Depacketizer() override;
+
+  protected:
+    virtual void BeginFrame() override;
+    virtual bool AddPayload(std::span<const std::byte> Payload) override;
+    virtual bool EndFrame() override;
+
+  private:
+    void AppendNal(std::span<const std::byte> Nal);
+    bool fragmented { false };
+  };
+}
+
+#endif
@@ -0,0 +1,221 @@
+#include "Fragmentation.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+  // fragments use the same little endian layout on every platform
+  template < typename T > void Put(std::byte* Destination, T Value)
+  {
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+      Destination[i] = static_cast<std::byte>((static_cast<std::uint64_t>(Value) >> (8 * i)) & 0xFF);
+  }
+
+  template < typename T > T Get(const std::byte* Source)
+  {
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+      value |= static_cast<std::uint64_t>(Source[i]) << (8 * i);
+    return static_cast<T>(value);
+  }
+}
+
+std::size_t Synavis::FragmentMessage(std::span<const std::byte> Data, std::size_t MaxMessageSize,
+  std::uint32_t MessageId, std::byte Marker, const std::function<void(rtc::binary)>& Submit)
+{
+  if (MaxMessageSize <= FragmentHeaderSize)
+    throw std::runtime_error("Maximum message size is too small for fragmentation");
+  const auto payload = MaxMessageSize - FragmentHeaderSize;
+  const auto count = std::max<std::size_t>((Data.size() + payload - 1) / payload, 1);
+  if (count > UINT32_MAX)
+    throw std::runtime_error("Message has too many fragments");
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const auto offset = i * payload;
+    const auto length = std::min(payload, Data.size() - offset);
+    rtc::binary fragment(FragmentHeaderSize + length);
+    auto* header = fragment.data();
+    header[0] = Marker;
+    Put<std::uint16_t>(header + 1, 0);
+    Put<std::uint32_t>(header + 3, MessageId);
+    Put<std::uint32_t>(header + 7, static_cast<std::uint32_t>(i));
+    Put<std::uint32_t>(header + 11, static_cast<std::uint32_t>(count));
+    Put<std::uint64_t>(header + 15, Data.size());
+    Put<std::uint64_t>(header + 23, offset);
+    if (length > 0)
+      std::memcpy(fragment.data() + FragmentHeaderSize, Data.data() + offset, length);
+    Submit(std::move(fragment));
+  }
+  return count;
+}
+
+bool Synavis::IsFragment(std::span<const std::byte> Message, std::byte Marker)
+{
+  return Message.size() >= FragmentHeaderSize && Message[0] == Marker && Get<std::uint16_t>(Message.data() + 1) == 0;
+}
+
+Synavis::Reassembler::Reassembler(std::size_t MaxMessages, std::size_t MaxBytes, std::chrono::steady_clock::duration Timeout)
+  : MaxMessages(std::max<std::size_t>(MaxMessages, 1)), MaxBytes(MaxBytes), Timeout(Timeout)
+{
+}
+
+std::optional<rtc::binary> Synavis::Reassembler::Add(std::span<const std::byte> Fragment)
+{
+  if (Fragment.size() < FragmentHeaderSize)
+    return std::nullopt;
+  const auto* header = Fragment.data();
+  const auto id = Get<std::uint32_t>(header + 3);
+  const auto index = Get<std::uint32_t>(header + 7);
+  const auto count = Get<std::uint32_t>(header + 11);
+  const auto total = Get<std::uint64_t>(header + 15);
+  const auto offset = Get<std::uint64_t>(header + 23);
+  const auto payload = Fragment.subspan(FragmentHeaderSize);
+  if (index >= count || offset > total || payload.size() > total - offset || total > MaxBytes)
+    return std::nullopt;
+  // a message of one fragment does not need the table
+  if (count == 1)
+  {
+    if (payload.size() != total)
+      return std::nullopt;
+    return rtc::binary(payload.begin(), payload.end());
+  }
+
+  // all fragments but the last carry the same payload size, every fragment tells it
+  // and the fragments of a message have to tile it without gaps or overlaps
+  std::uint64_t stride;
+  if (index + 1 < count)
+  {
+    stride = payload.size();
+    if (stride == 0 || offset != index * stride)
+      return std::nullopt;
+  }
+  else
+  {
+    if (payload.empty() || offset + payload.size() != total || offset % (count - 1) != 0)
+      return std::nullopt;
+    stride = offset / (count - 1);
+    if (payload.size() > stride)
+      return std::nullopt;
+  }
+  // this also bounds the fragment table of the message by its size
+  if ((total + stride - 1) / stride != count)
+    return std::nullopt;
+
+  std::unique_lock<std::mutex> lock(TableLock);
+  const auto now = std::chrono::steady_clock::now();
+  auto entry = Messages.find(id);
+  if (entry == Messages.end())
+  {
+    Evict(now, total);
+    // the output buffer is allocated once, fragments are copied to their place
+    entry = Messages.emplace(id, Entry{ rtc::binary(total), std::vector<bool>(count, false), count, stride, 0, now }).first;
+    Bytes += total;
+  }
+  auto& message = entry->second;
+  if (message.Data.size() != total || message.Received.size() != count || message.Stride != stride)
+    return std::nullopt;
+  message.LastFragment = now;
+  if (message.Received[index])
+    return std::nullopt;
+  message.Received[index] = true;
+  message.Missing--;
+  message.ReceivedBytes += payload.size();
+  std::memcpy(message.Data.data() + offset, payload.data(), payload.size());
+  if (message.Missing > 0 || message.ReceivedBytes != total)
+    return std::nullopt;
+  auto complete = std::move(message.Data);
+  Bytes -= total;
+  Messages.erase(entry);
+  return complete;
+}
+
+void Synavis::Reassembler::Evict(std::chrono::steady_clock::time_point Now, std::size_t RequiredBytes)
+{
+  for (auto it = Messages.begin(); it != Messages.end();)
+  {
+    if (Now - it->second.LastFragment > Timeout)
+    {
+      Bytes -= it->second.Data.size();
+      EvictedMessages++;
+      it = Messages.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  // make room by dropping the messages that waited longest for a fragment
+  while (!Messages.empty() && (Messages.size() >= MaxMessages || Bytes + RequiredBytes > MaxBytes))
+  {
+    auto oldest = std::min_element(Messages.begin(), Messages.end(),
+      [](const auto& a, const auto& b) { return a.second.LastFragment < b.second.LastFragment; });
+    Bytes -= oldest->second.Data.size();
+    EvictedMessages++;
+    Messages.erase(oldest);
+  }
+}
+
+std::size_t Synavis::Reassembler::Pending()
+{
+  std::unique_lock<std::mutex> lock(TableLock);
+  return Messages.size();
+}
+
+void Synavis::Reassembler::Clear()
+{
+  std::unique_lock<std::mutex> lock(TableLock);
+  Messages.clear();
+  Bytes = 0;
+}
+
+Synavis::ChunkWindow::ChunkWindow(std::size_t Chunks, std::size_t Window)
+  : Chunks(Chunks), Window(std::max<std::size_t>(Window, 1)), Acknowledged(Chunks, false)
+{
+}
+
+std::optional<std::size_t> Synavis::ChunkWindow::Next()
+{
+  while (!Resend.empty())
+  {
+    const auto chunk = Resend.front();
+    Resend.erase(Resend.begin());
+    // the acknowledgement may have arrived after the chunk was queued again
+    if (!Acknowledged[chunk])
+    {
+      Retransmitted++;
+      return chunk;
+    }
+  }
+  if (Following < Chunks && Following < Base + Window)
+    return Following++;
+  return std::nullopt;
+}
+
+void Synavis::ChunkWindow::Report(std::size_t Chunk, bool Received)
+{
+  // reports for chunks that were never sent are not trusted
+  if (Chunk >= Following || Acknowledged[Chunk])
+    return;
+  if (!Received)
+  {
+    Retransmit(Chunk);
+    return;
+  }
+  Acknowledged[Chunk] = true;
+  while (Base < Chunks && Acknowledged[Base])
+    ++Base;
+}
+
+void Synavis::ChunkWindow::Expire()
+{
+  if (!Complete())
+    Retransmit(Base);
+}
+
+void Synavis::ChunkWindow::Retransmit(std::size_t Chunk)
+{
+  if (std::find(Resend.begin(), Resend.end(), Chunk) == Resend.end())
+    Resend.push_back(Chunk);
+}
@@ -0,0 +1,99 @@
+#ifndef SYNAVIS_FRAGMENTATION_HPP
+#define SYNAVIS_FRAGMENTATION_HPP
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include <rtc/common.hpp>
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+  // Binary messages that are larger than the maximum message size of the data
+  // channel are split into fragments with this header, all values little endian:
+  //
+  //  offset  size  content
+  //  0       1     marker byte (the DataChannelByte of the connector)
+  //  1       2     zero, this distinguishes fragments from framed text messages
+  //  3       4     message id
+  //  7       4     fragment index
+  //  11      4     number of fragments
+  //  15      8     total size of the message in bytes
+  //  23      8     offset of this fragment in the message
+  constexpr std::size_t FragmentHeaderSize = 31;
+
+  // Calls Submit with every fragment of Data, fragments are at most MaxMessageSize bytes
+  SYNAVIS_EXPORT std::size_t FragmentMessage(std::span<const std::byte> Data, std::size_t MaxMessageSize,
+    std::uint32_t MessageId, std::byte Marker, const std::function<void(rtc::binary)>& Submit);
+  SYNAVIS_EXPORT bool IsFragment(std::span<const std::byte> Message, std::byte Marker);
+
+  // Collects fragments until their message is complete. The table is bounded in the
+  // number of messages and bytes, incomplete messages are evicted after a timeout or
+  // when space is needed for newer ones.
+  class SYNAVIS_EXPORT Reassembler
+  {
+  public:
+    Reassembler(std::size_t MaxMessages = 16, std::size_t MaxBytes = 512 * 1024 * 1024,
+      std::chrono::steady_clock::duration Timeout = std::chrono::seconds(10));
+    // returns the message once its last fragment arrived
+    std::optional<rtc::binary> Add(std::span<const std::byte> Fragment);
+    std::size_t Pending();
+    std::size_t Evicted() const { return EvictedMessages; }
+    void Clear();
+  private:
+    struct Entry
+    {
+      rtc::binary Data;
+      std::vector<bool> Received;
+      std::uint32_t Missing;
+      // payload size of all fragments but the last
+      std::uint64_t Stride;
+      std::uint64_t ReceivedBytes;
+      std::chrono::steady_clock::time_point LastFragment;
+    };
+    void Evict(std::chrono::steady_clock::time_point Now, std::size_t RequiredBytes);
+    std::mutex TableLock;
+    std::unordered_map<std::uint32_t, Entry> Messages;
+    std::size_t Bytes{ 0 };
+    std::size_t EvictedMessages{ 0 };
+    std::size_t MaxMessages;
+    std::size_t MaxBytes;
+    std::chrono::steady_clock::duration Timeout;
+  };
+
+  // The sender side of a windowed buffer transfer: up to Window chunks wait for their
+  // acknowledgement, chunks that are reported missing or whose acknowledgement times
+  // out are handed out again before new ones. The timing is left to the caller.
+  class SYNAVIS_EXPORT ChunkWindow
+  {
+  public:
+    ChunkWindow(std::size_t Chunks, std::size_t Window);
+    // the next chunk to send, none while the window is full
+    std::optional<std::size_t> Next();
+    // the receiver confirmed a chunk or reported it as missing
+    void Report(std::size_t Chunk, bool Received);
+    // the acknowledgement of the oldest chunk did not arrive in time
+    void Expire();
+    // the oldest chunk that is not acknowledged yet
+    std::size_t Oldest() const { return Base; }
+    bool Complete() const { return Base == Chunks; }
+    std::size_t Retransmissions() const { return Retransmitted; }
+  private:
+    void Retransmit(std::size_t Chunk);
+    std::size_t Chunks;
+    std::size_t Window;
+    std::size_t Base{ 0 };
+    std::size_t Following{ 0 };
+    std::size_t Retransmitted{ 0 };
+    std::vector<bool> Acknowledged;
+    std::vector<std::size_t> Resend;
+  };
+}
+
+#endif
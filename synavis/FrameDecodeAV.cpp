@@ -1,5 +1,7 @@
 #include "FrameDecodeAV.hpp"
 
+#include <cstring>
+
 // libAV includes
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -29,123 +31,31 @@ namespace Synavis
     return static_cast<std::byte>(Value);
   }
 
-  void PacketDepacketizer::ResetPacket()
-  {
-    frame.clear();
-    timestamp = static_cast<uint32_t>(-1);
-  }
-
-  VP9Depacketizer::~VP9Depacketizer()
-  {
-  }
-
-  void VP9Depacketizer::AddPacket(rtc::binary Data)
+  namespace
   {
-    const rtc::RtpHeader* Header = reinterpret_cast<const rtc::RtpHeader*>(Data.data());
-
-    const uint8_t* body = reinterpret_cast<const uint8_t*>(Header->getBody());
+    // packets of a 4K key frame and the frames that may be in flight between the stages
+    constexpr std::size_t PacketQueueSize = 4096;
+    constexpr std::size_t UnitQueueSize = 8;
+    constexpr std::size_t PictureQueueSize = 4;
+    constexpr std::size_t ContentQueueSize = 4;
 
-    if (frame.empty())
-    {
-      // check if the packet is a keyframe
-      if (Header->marker() > 0 && body[0] == 0x9d && body[1] == 0x01 && body[2] == 0x2a)
-      {
-        // keyframe
-        ldecoder(ELogVerbosity::Verbose) << "Keyframe" << std::endl;
-        // create a new frame
-        frame = std::vector<std::byte>(Data.begin() + sizeof(rtc::RtpHeader), Data.end());
-        timestamp = Header->timestamp();
-      }
-      else
-      {
-        // not a keyframe
-        ldecoder(ELogVerbosity::Verbose) << "Not a keyframe" << std::endl;
-      }
-    }
-    else
+    std::string ErrorString(int Error)
     {
-      // check if the timestamp is the same
-      if (Header->timestamp() == timestamp)
-      {
-        // append the packet to the frame
-        frame.insert(frame.end(), Data.begin() + sizeof(rtc::RtpHeader), Data.end());
-      }
-      else
-      {
-        // not the same timestamp
-        ldecoder(ELogVerbosity::Verbose) << "Not the same timestamp" << std::endl;
-      }
+      char text[AV_ERROR_MAX_STRING_SIZE];
+      av_strerror(Error, text, AV_ERROR_MAX_STRING_SIZE);
+      return text;
     }
   }
 
-  bool VP9Depacketizer::IsFrameComplete()
-  {
-    return false;
-  }
-
-  AVPacket* VP9Depacketizer::GetAVFrame()
-  {
-    return nullptr;
-  }
-
-  H264Depacketizer::~H264Depacketizer()
-  {
-  }
-
-  void H264Depacketizer::AddPacket(rtc::binary Packet)
-  {
-    auto header = reinterpret_cast<const rtc::RtpHeader*>(Packet.data());
-    auto sq = header->seqNumber();
-    auto ts = header->timestamp();
-    /*       Wang et al. (2016), RTP Payload format for High Efficiency Video Coding (HEVC)
-     *       and Wang, et al. (2011), RTP Payload Format for H.264 Video
-     *       Informative note: The first byte of a NAL unit co-serves as the
-     *        RTP payload header.
-     *
-     *       0                   1                   2                   3
-     *       0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-     *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-     *      |F|NRI|  Type   |                                               |
-     *      +-+-+-+-+-+-+-+-+                                               |
-     *      |                                                               |
-     *      |               Bytes 2..n of a single NAL unit                 |
-     *      |                                                               |
-     *      |                               +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-     *      |                               :...OPTIONAL RTP padding        |
-     *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-     */
-    // remove the rtp header
-    auto* data = header->getBody();
-    auto size = Packet.size() - header->getSize();
-
-    auto * nal = reinterpret_cast<const rtc::NalUnit*> (data);
-
-    // add the data to the frame
-    frame.insert(frame.end(), nal->payload().begin(), nal->payload().end());
-  }
-
-  bool H264Depacketizer::IsFrameComplete()
-  {
-    return false;
-  }
-
-  AVPacket* H264Depacketizer::GetAVFrame()
-  {
-    AVPacket* packet = av_packet_alloc();
-
-    packet->data = AS_UINT8(frame.data());
-    packet->size = static_cast<int>(frame.size());
-
-    return packet;
-  }
-
   FrameDecode::FrameDecode(rtc::Track* VideoInfo, ECodec StreamCodec)
+    : Packets(PacketQueueSize), Units(UnitQueueSize), Pictures(PictureQueueSize), Contents(ContentQueueSize),
+      SpareUnits(UnitQueueSize + 2), SparePictures(PictureQueueSize + 2)
   {
     switch (StreamCodec)
     {
     case ECodec::VP8:
       Codec = avcodec_find_decoder(AV_CODEC_ID_VP8);
-      Depacketizer = std::make_unique<VP9Depacketizer>();
+      Depacketizer = std::make_unique<VP8Depacketizer>();
       break;
     case ECodec::VP9:
       Codec = avcodec_find_decoder(AV_CODEC_ID_VP9);
@@ -169,16 +79,9 @@ namespace Synavis
       throw std::runtime_error("Codec not found");
     }
 
-    CodecContext = avcodec_alloc_context3(Codec);
-    if (!CodecContext)
-    {
-      throw std::runtime_error("Could not allocate video codec context");
-    }
-
-    if (avcodec_open2(CodecContext, Codec, NULL) < 0)
-    {
-      throw std::runtime_error("Could not open codec");
-    }
+    // slice threads add no delay, frame threads are opted into with SetDecoderThreading
+    DecoderThreadType = FF_THREAD_SLICE;
+    OpenDecoder();
 
     Frame = av_frame_alloc();
     if (!Frame)
@@ -192,27 +95,73 @@ namespace Synavis
       throw std::runtime_error("Could not allocate packet");
     }
 
-    // TODO bitrate is also in the session description protocoll
-    // framerate and resolution should be transmitted either through data channel or as video track package
-    CodecContext->bit_rate = 400000;
-    CodecContext->framerate = {10, 1};
-    CodecContext->width = 1280;
-    CodecContext->height = 720;
+    // the pictures between decoding and conversion, one more for each of the two stages
+    for (std::size_t i = 0; i < SparePictures.GetCapacity(); ++i)
+    {
+      AVFrame* picture = av_frame_alloc();
+      if (!picture)
+      {
+        throw std::runtime_error("Could not allocate video frame");
+      }
+      AllPictures.push_back(picture);
+      SparePictures.Push(std::move(picture));
+    }
 
     if (VideoInfo)
     {
       MaxMessageSize = VideoInfo->maxMessageSize();
     }
-    DecoderThread = std::make_shared<WorkerThread>();
+    Stages[0] = std::async(std::launch::async, &FrameDecode::DepacketizeRun, this);
+    Stages[1] = std::async(std::launch::async, &FrameDecode::DecodeRun, this);
+    Stages[2] = std::async(std::launch::async, &FrameDecode::ConvertRun, this);
+    Stages[3] = std::async(std::launch::async, &FrameDecode::DeliverRun, this);
   }
 
   FrameDecode::~FrameDecode()
   {
+    // every stage drains its queue and closes the next one
+    Packets.Close();
+    for (auto& stage : Stages)
+    {
+      if (stage.valid())
+      {
+        stage.wait();
+      }
+    }
+    for (auto* picture : AllPictures)
+    {
+      av_frame_free(&picture);
+    }
     av_frame_free(&Frame);
     av_packet_free(&Packet);
     avcodec_free_context(&CodecContext);
   }
 
+  void FrameDecode::OpenDecoder()
+  {
+    avcodec_free_context(&CodecContext);
+    CodecContext = avcodec_alloc_context3(Codec);
+    if (!CodecContext)
+    {
+      throw std::runtime_error("Could not allocate video codec context");
+    }
+
+    // TODO bitrate is also in the session description protocoll
+    // framerate and resolution should be transmitted either through data channel or as video track package
+    CodecContext->bit_rate = 400000;
+    CodecContext->framerate = {10, 1};
+    CodecContext->width = 1280;
+    CodecContext->height = 720;
+    // the threading options only take effect when the codec is opened
+    CodecContext->thread_count = DecoderThreads;
+    CodecContext->thread_type = DecoderThreadType;
+
+    if (avcodec_open2(CodecContext, Codec, NULL) < 0)
+    {
+      throw std::runtime_error("Could not open codec");
+    }
+  }
+
   std::function<void(rtc::binary)> FrameDecode::CreateAcceptor(std::function<void(rtc::binary)>&& Callback)
   {
     return [this, Callback = std::move(Callback)](rtc::binary Data)
@@ -228,7 +177,6 @@ namespace Synavis
 
       // print payload type in verbose
 
-      auto* body = reinterpret_cast<uint8_t*>(Header->getBody());
       auto& l = ldecoder(ELogVerbosity::Verbose) << "Packet ssrc: " << Header->ssrc() << " - time: " << Header->
         timestamp()
         << " - seq: " << Header->seqNumber() << " - payload: " << static_cast<uint16_t>(Header->payloadType())
@@ -242,162 +190,221 @@ namespace Synavis
         ldecoder(ELogVerbosity::Verbose) << "No payload packet" << std::endl;
         return;
       }
-      // add the packet to the buffer
-      AddPacket(Data);
-
-      // check if the marker is set
-      if (Header->marker() > 0)
+      // the network thread never waits for the decoder, the jitter buffer treats a dropped packet as lost
+      if (!Packets.Push(std::move(Data), EBackPressurePolicy::WouldBlock))
       {
-        ldecoder(ELogVerbosity::Info) << "Frame complete, creating decoding task" << std::endl;
-        DecoderThread->AddTask([this, ts = Header->timestamp(), Data]()
-        {
-          //while (avcodec_receive_frame(CodecContext, Frame) != AVERROR(EAGAIN));
-
-          // create a packet from the buffer
-          AVPacket* packet = InitializePacketFromData(ts);
-          if (!packet)
-          {
-            // packet is not complete
-            //Callback(Data);
-            return;
-          }
-          // decode the frame
-#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 9, 100)
-          int GotFrame = 0;
-          int Result = avcodec_decode_video2(CodecContext, Frame, &GotFrame, Packet);
-#else
-          int Result = avcodec_send_packet(CodecContext, Packet);
-          lffmpeg(ELogVerbosity::Debug) << "Result: " << Result << std::endl;
-          int GotFrame = avcodec_receive_frame(CodecContext, Frame);
-          lffmpeg(ELogVerbosity::Debug) << "GotFrame: " << GotFrame << std::endl;
-#endif
-          // check if the frame is decoded
-          if (Result < 0)
-          {
-            //Callback(Data);
-            // get the error from the decoder
-            char Error[AV_ERROR_MAX_STRING_SIZE];
-            av_strerror(Result, Error, AV_ERROR_MAX_STRING_SIZE);
-            lffmpeg(ELogVerbosity::Error) << "Error transmitting frame: " << Error << std::endl;
-          }
-          else
-          {
-            // frame decoded
-            if (GotFrame >= 0)
-            {
-              // create a frame content
-              FrameContent Content;
-              Content.Width = Frame->width;
-              Content.Height = Frame->height;
-              Content.Data = std::vector<uint8_t>(Frame->data[0], Frame->data[0] + Frame->linesize[0] * Frame->height);
-              Content.Data.insert(Content.Data.end(), Frame->data[1],
-                                  Frame->data[1] + Frame->linesize[1] * Frame->height / 2);
-              Content.Data.insert(Content.Data.end(), Frame->data[2],
-                                  Frame->data[2] + Frame->linesize[2] * Frame->height / 2);
-              // call the callback
-              if (FrameCallback.has_value())
-              {
-                FrameCallback.value()(Content);
-              }
-            }
-            else
-            {
-              // get the error from the decoder
-              char Error[AV_ERROR_MAX_STRING_SIZE];
-              av_strerror(Result, Error, AV_ERROR_MAX_STRING_SIZE);
-              lffmpeg(ELogVerbosity::Error) << "Error decoding frame: " << Error << std::endl;
-            }
-          }
-        });
+        Counters[0].Dropped();
+        ldecoder(ELogVerbosity::Debug) << "Packet queue is full, dropping packet" << std::endl;
       }
     };
   }
 
-  void FrameDecode::SetFrameCallback(std::function<void(FrameContent)> Callback)
+  void FrameDecode::DepacketizeRun()
   {
-    FrameCallback = Callback;
+    std::chrono::steady_clock::time_point queued;
+    while (auto data = Packets.Pop(&queued))
+    {
+      {
+        std::unique_lock<std::mutex> lock(DepacketizeLock);
+        // a rejected packet is late or a duplicate, missing ones may still have timed out
+        Jitter.Insert(std::move(data.value()));
+        while (auto packet = Jitter.Next())
+        {
+          Depacketizer->AddPacket(packet.value());
+          if (!Depacketizer->IsFrameComplete())
+          {
+            continue;
+          }
+          ldecoder(ELogVerbosity::Debug) << "Frame " << Depacketizer->GetTimestamp() << " complete, decoding" << std::endl;
+          // the buffers of decoded access units are reused
+          AccessUnit unit;
+          unit.Data = SpareUnits.TryPop().value_or(std::vector<std::byte>());
+          const auto frame = Depacketizer->GetFrame();
+          unit.Data.assign(frame.begin(), frame.end());
+          unit.Timestamp = Depacketizer->GetTimestamp();
+          unit.KeyFrame = Depacketizer->IsKeyFrame();
+          Units.Push(std::move(unit));
+        }
+      }
+      Counters[0].Processed(queued);
+    }
+    Units.Close();
   }
 
-  void FrameDecode::SetMaxFrameBuffer(uint32_t MaxFrames)
+  void FrameDecode::DecodeRun()
   {
-    this->MaxFrames = MaxFrames;
+    std::chrono::steady_clock::time_point queued;
+    while (auto unit = Units.Pop(&queued))
+    {
+      {
+        std::unique_lock<std::mutex> lock(DecodeLock);
+        Decode(unit.value(), queued);
+      }
+      SpareUnits.Push(std::move(unit->Data), EBackPressurePolicy::WouldBlock);
+    }
+    Pictures.Close();
   }
 
-  inline AVPacket* FrameDecode::InitializePacketFromData(uint32_t index)
+  void FrameDecode::Decode(const AccessUnit& Unit, std::chrono::steady_clock::time_point Queued)
   {
-    Depacketizer->ResetPacket();
-    // to extract the VP9 package from multiple RTP packages, we need to sort them by sequence number
-    // return nullptr if the frameBuffer does not contain the index
-    if (frameBuffer.find(index) == frameBuffer.end())
+    // the decoder copies the data of packets that are not reference counted
+    av_packet_unref(Packet);
+    Packet->data = AS_UINT8(const_cast<std::byte*>(Unit.Data.data()));
+    Packet->size = static_cast<int>(Unit.Data.size());
+    Packet->pts = Unit.Timestamp;
+    if (Unit.KeyFrame)
     {
-      return nullptr;
+      Packet->flags |= AV_PKT_FLAG_KEY;
     }
-    auto& frame = frameBuffer[index];
-    std::ranges::sort(frame, [](const rtc::binary& a, const rtc::binary& b)
+    int Result = avcodec_send_packet(CodecContext, Packet);
+    lffmpeg(ELogVerbosity::Debug) << "Result: " << Result << std::endl;
+    if (Result < 0)
     {
-      return reinterpret_cast<const rtc::RtpHeader*>(a.data())->seqNumber()
-        < reinterpret_cast<const rtc::RtpHeader*>(b.data())->seqNumber();
-    });
-    // ensure that the sequence numbers are correct
-    int sq = -1;
-    int size = 0;
-    for (auto& packet : frame)
+      Counters[1].Dropped();
+      lffmpeg(ELogVerbosity::Error) << "Error transmitting frame: " << ErrorString(Result) << std::endl;
+      return;
+    }
+    // with frame threads, a packet yields no picture until the threads are busy and then one per packet
+    while ((Result = avcodec_receive_frame(CodecContext, Frame)) >= 0)
     {
-      size += static_cast<int>(packet.size() - sizeof(rtc::RtpHeader));
-      const rtc::RtpHeader* header = reinterpret_cast<const rtc::RtpHeader*>(packet.data());
-      
-      if (sq == -1)
-      {
-        sq = header->seqNumber();
-      }
-      else
+      auto picture = SparePictures.Pop();
+      if (!picture)
       {
-        if (sq + 1 != header->seqNumber())
-        {
-          // sequence number is not correct
-          return nullptr;
-        }
-        else
-          sq = header->seqNumber();
+        av_frame_unref(Frame);
+        return;
       }
+      av_frame_move_ref(picture.value(), Frame);
+      Pictures.Push(std::move(picture.value()));
     }
-    for(auto& packet : frame)
+    if (Result != AVERROR(EAGAIN) && Result != AVERROR_EOF)
     {
-       Depacketizer->AddPacket(packet);
+      Counters[1].Dropped();
+      lffmpeg(ELogVerbosity::Error) << "Error decoding frame: " << ErrorString(Result) << std::endl;
+      return;
     }
-    return Depacketizer->GetAVFrame(); // implicit copy
+    Counters[1].Processed(Queued);
   }
 
-  void FrameDecode::AddPacket(rtc::binary Data)
+  void FrameDecode::ConvertRun()
   {
-    const rtc::RtpHeader* Header = reinterpret_cast<const rtc::RtpHeader*>(Data.data());
-    const uint8_t* body = reinterpret_cast<const uint8_t*>(Header->getBody());
-
-
-    // check if timestamp is already in the buffer
-    if (frameBuffer.find(Header->timestamp()) == frameBuffer.end())
+    std::chrono::steady_clock::time_point queued;
+    while (auto picture = Pictures.Pop(&queued))
     {
-      // checif the buffer is full
-      if (frameBuffer.size() >= MaxFrames)
+      AVFrame* decoded = picture.value();
+      std::shared_ptr<FrameBuffer> buffer;
+      // the planes are copied row by row, without the padding of the decoder
+      if (decoded->format != AV_PIX_FMT_YUV420P && decoded->format != AV_PIX_FMT_YUVJ420P)
+      {
+        ldecoder(ELogVerbosity::Error) << "Unsupported pixel format " << decoded->format << std::endl;
+      }
+      else
+      {
+        std::unique_lock<std::mutex> lock(ConvertLock);
+        buffer = Frames.Acquire(decoded->width, decoded->height);
+        if (!buffer)
+        {
+          ldecoder(ELogVerbosity::Warning) << "Dropping frame " << decoded->pts << ", " << Frames.InUse()
+            << " frames are still held by the consumer" << std::endl;
+        }
+      }
+      if (buffer)
       {
-        // remove the oldest frame
-        uint32_t oldest = currentlyCapturing.front();
-        currentlyCapturing.pop_front();
-        frameBuffer.erase(oldest);
-        // log to verbose
-        ldecoder(ELogVerbosity::Debug) << "Removed frame " << oldest << " from buffer" << std::endl;
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+          const auto& plane = buffer->Plane(i);
+          for (uint32_t row = 0; row < plane.Height; ++row)
+          {
+            std::memcpy(plane.Data + row * plane.Stride, decoded->data[i] + row * static_cast<std::ptrdiff_t>(decoded->linesize[i]), plane.Width);
+          }
+        }
+        FrameContent Content;
+        Content.Width = decoded->width;
+        Content.Height = decoded->height;
+        Content.Timestamp = static_cast<uint32_t>(decoded->pts);
+        Content.Data = buffer->Data();
+        Content.Buffer = std::move(buffer);
+        Contents.Push(std::move(Content));
+        Counters[2].Processed(queued);
       }
       else
       {
-        frameBuffer[Header->timestamp()] = std::vector<rtc::binary>();
-        // insert the frame into the buffer
-        frameBuffer[Header->timestamp()].push_back(Data); // copy!
+        Counters[2].Dropped();
       }
+      av_frame_unref(decoded);
+      SparePictures.Push(std::move(decoded));
     }
-    else
+    Contents.Close();
+  }
+
+  void FrameDecode::DeliverRun()
+  {
+    std::chrono::steady_clock::time_point queued;
+    while (auto content = Contents.Pop(&queued))
     {
-      // insert the packet into the buffer
-      frameBuffer[Header->timestamp()].push_back(Data); // copy!
+      // the callback runs unlocked, it may replace itself or stop the decoder. Only the
+      // pointer is copied, copying the function could allocate for every frame
+      std::shared_ptr<const std::function<void(FrameContent)>> callback;
+      {
+        std::unique_lock<std::mutex> lock(CallbackLock);
+        callback = FrameCallback;
+      }
+      if (callback)
+      {
+        (*callback)(std::move(content.value()));
+      }
+      Counters[3].Processed(queued);
     }
+    // wakes the decoder if it still waits for a picture
+    SparePictures.Close();
+  }
+
+  void FrameDecode::SetFrameCallback(std::function<void(FrameContent)> Callback)
+  {
+    auto callback = std::make_shared<const std::function<void(FrameContent)>>(std::move(Callback));
+    std::unique_lock<std::mutex> lock(CallbackLock);
+    FrameCallback = std::move(callback);
+  }
+
+  void FrameDecode::SetJitterBuffer(std::size_t Capacity, double PlayoutDelay)
+  {
+    JitterBuffer jitter(Capacity, std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(PlayoutDelay)));
+    std::unique_lock<std::mutex> lock(DepacketizeLock);
+    jitter.SetLossCallback(PacketLossCallback);
+    Jitter = std::move(jitter);
+    Depacketizer->ResetPacket();
+  }
+
+  void FrameDecode::SetPacketLossCallback(JitterBuffer::LossCallback Callback)
+  {
+    std::unique_lock<std::mutex> lock(DepacketizeLock);
+    PacketLossCallback = Callback;
+    Jitter.SetLossCallback(std::move(Callback));
+  }
+
+  void FrameDecode::SetFramePool(std::size_t MaxFrames, std::size_t RowAlignment)
+  {
+    FramePool pool(MaxFrames, RowAlignment);
+    std::unique_lock<std::mutex> lock(ConvertLock);
+    // frames handed out before stay valid, they are no longer recycled
+    Frames = std::move(pool);
+  }
+
+  void FrameDecode::SetDecoderThreading(int Threads, bool FrameThreads, bool SliceThreads)
+  {
+    std::unique_lock<std::mutex> lock(DecodeLock);
+    DecoderThreads = Threads;
+    DecoderThreadType = (FrameThreads ? FF_THREAD_FRAME : 0) | (SliceThreads ? FF_THREAD_SLICE : 0);
+    // the new decoder needs a key frame to start from
+    OpenDecoder();
+  }
+
+  std::vector<StageStatistics> FrameDecode::GetStageStatistics()
+  {
+    return {
+      Counters[0].Statistics("depacketize", Packets.Size()),
+      Counters[1].Statistics("decode", Units.Size()),
+      Counters[2].Statistics("convert", Pictures.Size()),
+      Counters[3].Statistics("deliver", Contents.Size())
+    };
   }
 }
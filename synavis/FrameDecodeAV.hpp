@@ -4,6 +4,9 @@
 #pragma once
 
 #include <json.hpp>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <span>
 #include <variant>
 #include <vector>
@@ -11,6 +14,10 @@
 #include "Synavis/export.hpp"
 
 #include "Synavis.hpp"
+#include "Depacketizer.hpp"
+#include "JitterBuffer.hpp"
+#include "FramePool.hpp"
+#include "Pipeline.hpp"
 
 
 
@@ -32,72 +39,21 @@ namespace Synavis
 
   struct SYNAVIS_EXPORT FrameContent
   {
-    std::vector<uint8_t> Data;
+    // the frame buffer returns to the pool of the decoder once no copy of the content is left
+    std::shared_ptr<const FrameBuffer> Buffer;
+    // the I420 planes of the buffer
+    std::span<const uint8_t> Data;
     uint32_t Width;
     uint32_t Height;
+    // the RTP timestamp of the frame
     uint32_t Timestamp;
   };
 
-#pragma pack(push, 1)
-  struct SYNAVIS_EXPORT VP9Payload
-  {
-    uint8_t payload;
-    bool picture_id_present() { return payload & 0b10000000; }
-    bool inter_pic_predicted() { return payload & 0b01000000; }
-    bool layer_idx() { return payload & 0b00100000; }
-    bool flexible() { return payload & 0b00010000; }
-    bool start() { return payload & 0b00001000; }
-    bool end() { return payload & 0b00000100; }
-    bool scalability() { return payload & 0b00000010; }
-    bool reserved() { return payload & 0b00000001; }
-    uint8_t ext_payload;
-    bool extended_pid() { return ext_payload & 0b10000000; }
-  };
-#pragma pack(pop)
-
-  class SYNAVIS_EXPORT PacketDepacketizer
-  {
-  public:
-    PacketDepacketizer() = default;
-    virtual ~PacketDepacketizer() = default;
-
-    // this function should be called in sequence order
-    // package reception handling is NOT handled here
-    // this is purely for depacketizing the data
-    virtual void AddPacket(rtc::binary Data) = 0;
-    virtual bool IsFrameComplete() = 0;
-    virtual AVPacket* GetAVFrame() = 0;
-    virtual void ResetPacket();
-
-  protected:
-    uint32_t timestamp { static_cast<uint32_t>(-1) };
-    std::vector<std::byte> frame;
-  };
-
-  class SYNAVIS_EXPORT VP9Depacketizer : public PacketDepacketizer
-  {
-  public:
-    VP9Depacketizer() = default;
-    virtual ~VP9Depacketizer() override;
-
-    virtual void AddPacket(rtc::binary Packet) override;
-    virtual bool IsFrameComplete() override;
-    virtual AVPacket* GetAVFrame() override;
-  };
-
-  class SYNAVIS_EXPORT H264Depacketizer : public PacketDepacketizer
-  {
-  public:
-    H264Depacketizer() = default;
-    virtual ~H264Depacketizer() override;
-
-    std::vector<std::byte> frame;
-    virtual void AddPacket(rtc::binary Packet) override;
-    virtual bool IsFrameComplete() override;
-    virtual AVPacket* GetAVFrame() override;
-
-  };
-
+  // Decodes a video track in four stages, each on its own thread and connected by
+  // bounded queues: the packets are reordered and depacketized, the access units
+  // decoded by FFmpeg, the pictures copied into the frame pool and the frames delivered
+  // to the frame callback. Packets are dropped when the first queue is full, so the
+  // network thread never waits; the later stages wait for each other instead.
   class SYNAVIS_EXPORT FrameDecode : public std::enable_shared_from_this<FrameDecode>
   {
   public:
@@ -106,31 +62,76 @@ namespace Synavis
 
     std::function<void(rtc::binary)> CreateAcceptor(std::function<void(rtc::binary)>&& Callback);
 
+    // called on the delivery thread
     void SetFrameCallback(std::function<void(FrameContent)> Callback);
 
-    void SetMaxFrameBuffer(uint32_t MaxFrames);
+    // Capacity is the number of packets that can wait for reordering, PlayoutDelay
+    // in seconds is how long a missing packet is waited for before it counts as lost
+    void SetJitterBuffer(std::size_t Capacity, double PlayoutDelay);
+    // called on the depacketizing thread with every run of lost packets
+    void SetPacketLossCallback(JitterBuffer::LossCallback Callback);
+    // MaxFrames is the number of decoded frames that consumers can hold at the same
+    // time, newer frames are dropped while all are held. RowAlignment pads the rows of
+    // the planes, 1 packs them tightly.
+    void SetFramePool(std::size_t MaxFrames, std::size_t RowAlignment = 1);
+    // Reopens the decoder with the FFmpeg threading options. Threads of 0 lets FFmpeg
+    // use one thread per core. Frame threads decode several frames at once and add one
+    // frame of delay per thread, slice threads split a frame if the encoder used slices.
+    // By default only slice threads are used, so that real-time streams keep their latency.
+    void SetDecoderThreading(int Threads, bool FrameThreads = false, bool SliceThreads = true);
+
+    // depacketize, decode, convert and deliver
+    std::vector<StageStatistics> GetStageStatistics();
 
   private:
-
-    std::optional<std::function<void(FrameContent)>> FrameCallback;
-
-    inline AVPacket* InitializePacketFromData(uint32_t index);
-
-    std::shared_ptr<WorkerThread> DecoderThread;
-    uint32_t MaxFrames;
-
-    std::map<uint32_t, std::vector<rtc::binary>> frameBuffer;
-    std::deque<uint32_t> currentlyCapturing;
-
-    void AddPacket(rtc::binary Data);
-
-    // ffmpeg decoding context
-    AVCodecContext* CodecContext;
-    const AVCodec* Codec;
-    AVFrame* Frame;
-    AVPacket* Packet;
+    struct AccessUnit
+    {
+      std::vector<std::byte> Data;
+      uint32_t Timestamp{ 0 };
+      bool KeyFrame{ false };
+    };
+
+    void OpenDecoder();
+    void DepacketizeRun();
+    void DecodeRun();
+    void ConvertRun();
+    void DeliverRun();
+    // sends the access unit and passes every picture the decoder has ready to the conversion
+    void Decode(const AccessUnit& Unit, std::chrono::steady_clock::time_point Queued);
+
+    std::mutex CallbackLock;
+    std::shared_ptr<const std::function<void(FrameContent)>> FrameCallback;
+
+    // depacketizing stage
+    std::mutex DepacketizeLock;
+    JitterBuffer Jitter;
+    JitterBuffer::LossCallback PacketLossCallback;
     std::unique_ptr<PacketDepacketizer> Depacketizer;
 
+    // decoding stage, ffmpeg decoding context
+    std::mutex DecodeLock;
+    AVCodecContext* CodecContext{ nullptr };
+    const AVCodec* Codec{ nullptr };
+    AVFrame* Frame{ nullptr };
+    AVPacket* Packet{ nullptr };
+    int DecoderThreads{ 0 };
+    int DecoderThreadType{ 0 };
+
+    // conversion stage
+    std::mutex ConvertLock;
+    FramePool Frames;
+
+    StageQueue<rtc::binary> Packets;
+    StageQueue<AccessUnit> Units;
+    StageQueue<AVFrame*> Pictures;
+    StageQueue<FrameContent> Contents;
+    // the buffers of access units and pictures go back to their producers
+    StageQueue<std::vector<std::byte>> SpareUnits;
+    StageQueue<AVFrame*> SparePictures;
+    std::vector<AVFrame*> AllPictures;
+    StageCounter Counters[4];
+    std::future<void> Stages[4];
+
     uint64_t MaxMessageSize;
   };
 }
@@ -0,0 +1,84 @@
+#include "FramePool.hpp"
+#include "Synavis.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+static const Synavis::Logger::LoggerInstance lpool = Synavis::Logger::Get()->LogStarter("FramePool");
+
+namespace Synavis
+{
+  std::size_t FrameBuffer::Required(uint32_t Width, uint32_t Height, std::size_t RowAlignment)
+  {
+    auto stride = [RowAlignment](std::size_t Bytes) { return (Bytes + RowAlignment - 1) / RowAlignment * RowAlignment; };
+    // the chroma planes of odd sizes round up
+    return stride(Width) * Height + 2 * stride((Width + 1) / 2) * ((Height + 1) / 2) + RowAlignment - 1;
+  }
+
+  bool FrameBuffer::Layout(uint32_t Width, uint32_t Height, std::size_t RowAlignment)
+  {
+    this->Width = Width;
+    this->Height = Height;
+    const bool fits = Storage.size() >= Required(Width, Height, RowAlignment);
+    if (!fits)
+      Storage.resize(Required(Width, Height, RowAlignment));
+    // the allocation itself is aligned as well, so that aligned rows stay aligned
+    const auto misalignment = reinterpret_cast<std::uintptr_t>(Storage.data()) % RowAlignment;
+    Offset = misalignment == 0 ? 0 : RowAlignment - misalignment;
+    Size = 0;
+    for (std::size_t i = 0; i < Planes.size(); ++i)
+    {
+      Planes[i].Width = i == 0 ? Width : (Width + 1) / 2;
+      Planes[i].Height = i == 0 ? Height : (Height + 1) / 2;
+      Planes[i].Stride = (Planes[i].Width + RowAlignment - 1) / RowAlignment * RowAlignment;
+      Planes[i].Data = Storage.data() + Offset + Size;
+      Size += Planes[i].Stride * Planes[i].Height;
+    }
+    return fits;
+  }
+
+  FramePool::FramePool(std::size_t MaxFrames, std::size_t RowAlignment)
+    : MaxFrames(std::max<std::size_t>(MaxFrames, 1)), RowAlignment(RowAlignment)
+  {
+    if (RowAlignment == 0 || (RowAlignment & (RowAlignment - 1)) != 0)
+      throw std::runtime_error("Frame row alignment must be a power of two");
+    Frames.reserve(this->MaxFrames);
+  }
+
+  std::shared_ptr<FrameBuffer> FramePool::Acquire(uint32_t Width, uint32_t Height)
+  {
+    std::shared_ptr<FrameBuffer>* free = nullptr;
+    for (auto& frame : Frames)
+    {
+      // only the pool holds the buffer, nobody can take a new reference to it
+      if (frame.use_count() != 1)
+        continue;
+      free = &frame;
+      // prefer a buffer that is large enough already
+      if (frame->Storage.size() >= FrameBuffer::Required(Width, Height, RowAlignment))
+        break;
+    }
+    if (free == nullptr)
+    {
+      if (Frames.size() >= MaxFrames)
+      {
+        Exhausted++;
+        lpool(ELogVerbosity::Warning) << "All " << MaxFrames << " frame buffers are in use" << std::endl;
+        return nullptr;
+      }
+      free = &Frames.emplace_back(std::make_shared<FrameBuffer>());
+    }
+    // the last reader released its reference on another thread
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!(*free)->Layout(Width, Height, RowAlignment))
+      Allocations++;
+    return *free;
+  }
+
+  std::size_t FramePool::InUse() const
+  {
+    return static_cast<std::size_t>(std::count_if(Frames.begin(), Frames.end(),
+      [](const auto& Frame) { return Frame.use_count() > 1; }));
+  }
+}
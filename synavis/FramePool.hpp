@@ -0,0 +1,78 @@
+#ifndef SYNAVIS_FRAMEPOOL_HPP
+#define SYNAVIS_FRAMEPOOL_HPP
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+  struct SYNAVIS_EXPORT FramePlane
+  {
+    uint8_t* Data{ nullptr };
+    // bytes from the start of one row to the next, at least Width
+    std::size_t Stride{ 0 };
+    uint32_t Width{ 0 };
+    uint32_t Height{ 0 };
+  };
+
+  // The pixels of a decoded 4:2:0 frame as Y, U and V planes back to back (I420).
+  // Rows are padded to the row alignment of the pool, without alignment the planes
+  // are tightly packed.
+  class SYNAVIS_EXPORT FrameBuffer
+  {
+  public:
+    std::span<const uint8_t> Data() const { return { Storage.data() + Offset, Size }; }
+    const FramePlane& Plane(std::size_t Index) const { return Planes[Index]; }
+    uint32_t Width{ 0 };
+    uint32_t Height{ 0 };
+
+  private:
+    friend class FramePool;
+    // the storage for the planes, including the room to align the first one
+    static std::size_t Required(uint32_t Width, uint32_t Height, std::size_t RowAlignment);
+    // returns false if the storage had to grow
+    bool Layout(uint32_t Width, uint32_t Height, std::size_t RowAlignment);
+    std::array<FramePlane, 3> Planes;
+    std::vector<uint8_t> Storage;
+    std::size_t Offset{ 0 };
+    std::size_t Size{ 0 };
+  };
+
+  // A fixed number of frame buffers that are handed out as shared pointers. A buffer
+  // returns to the pool when the consumer drops its last reference, so once every
+  // buffer has grown to the frame size no memory is allocated per frame.
+  // The pool belongs to the decoding thread, the buffers can be released on any thread.
+  class SYNAVIS_EXPORT FramePool
+  {
+  public:
+    // RowAlignment of 1 packs the planes tightly, e.g. 64 aligns every row for SIMD
+    FramePool(std::size_t MaxFrames = 8, std::size_t RowAlignment = 1);
+
+    // a free buffer laid out for the frame size, nullptr if all buffers are held by consumers
+    std::shared_ptr<FrameBuffer> Acquire(uint32_t Width, uint32_t Height);
+
+    std::size_t GetMaxFrames() const { return MaxFrames; }
+    std::size_t GetRowAlignment() const { return RowAlignment; }
+    // pool pressure: buffers held by consumers right now
+    std::size_t InUse() const;
+    // acquisitions that failed because all buffers were in use
+    uint64_t GetExhausted() const { return Exhausted; }
+    // acquisitions that had to allocate memory
+    uint64_t GetAllocations() const { return Allocations; }
+
+  private:
+    std::vector<std::shared_ptr<FrameBuffer>> Frames;
+    std::size_t MaxFrames;
+    std::size_t RowAlignment;
+    uint64_t Exhausted{ 0 };
+    uint64_t Allocations{ 0 };
+  };
+}
+
+#endif
@@ -0,0 +1,249 @@
+#include "GeometryFile.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#undef min
+#undef max
+
+namespace
+{
+  // bytes per element of the vertices, indices, normals and texture coordinates
+  constexpr std::size_t ElementSize[4] = { 3 * sizeof(double), sizeof(std::int32_t), 3 * sizeof(double), 2 * sizeof(double) };
+
+  template < typename T > void Store(std::byte* Destination, T Value)
+  {
+    std::memcpy(Destination, &Value, sizeof(T));
+  }
+
+  template < typename T > T Read(const std::byte* Source)
+  {
+    T value;
+    std::memcpy(&value, Source, sizeof(T));
+    return value;
+  }
+
+  void CheckGeometry(const Synavis::MeshView& Geometry)
+  {
+    if (Geometry.Vertices.size() % 3 != 0 || Geometry.Normals.size() % 3 != 0 || Geometry.UVs.size() % 2 != 0)
+      throw std::runtime_error("Geometry file attributes must have complete vectors");
+  }
+
+  // the arrays of the body in file order
+  void ArraysOf(const Synavis::MeshView& Geometry, std::span<const std::byte> Arrays[4], std::size_t Counts[4])
+  {
+    Arrays[0] = std::as_bytes(Geometry.Vertices);
+    Arrays[1] = std::as_bytes(Geometry.Indices);
+    Arrays[2] = std::as_bytes(Geometry.Normals);
+    Arrays[3] = std::as_bytes(Geometry.UVs);
+    for (int i = 0; i < 4; ++i)
+      Counts[i] = Arrays[i].size() / ElementSize[i];
+  }
+}
+
+std::size_t Synavis::GeometryFileSize(const MeshView& Geometry)
+{
+  return 4 * sizeof(std::uint64_t) + Geometry.Vertices.size() * sizeof(double) + Geometry.Indices.size() * sizeof(std::int32_t)
+    + Geometry.Normals.size() * sizeof(double) + Geometry.UVs.size() * sizeof(double) + GeometryFileIndexSize;
+}
+
+void Synavis::WriteGeometryFile(const std::string& Filename, const MeshView& Geometry)
+{
+  CheckGeometry(Geometry);
+  const auto size = GeometryFileSize(Geometry);
+  void* view = nullptr;
+#ifdef _WIN32
+  HANDLE file = CreateFileA(Filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("Could not open " + Filename);
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+    static_cast<DWORD>(static_cast<std::uint64_t>(size) >> 32), static_cast<DWORD>(size & 0xFFFFFFFFu), nullptr);
+  if (mapping != nullptr)
+    view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+  if (view == nullptr)
+  {
+    if (mapping != nullptr)
+      CloseHandle(mapping);
+    CloseHandle(file);
+    throw std::runtime_error("Could not map " + Filename);
+  }
+#else
+  const int file = open(Filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (file < 0)
+    throw std::runtime_error("Could not open " + Filename);
+  int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+  // fault all pages in at once instead of one by one while filling them
+  flags |= MAP_POPULATE;
+#endif
+  if (ftruncate(file, static_cast<off_t>(size)) == 0)
+    view = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, file, 0);
+  close(file);
+  if (view == nullptr || view == MAP_FAILED)
+    throw std::runtime_error("Could not map " + Filename);
+#endif
+  std::span<const std::byte> arrays[4];
+  std::size_t counts[4];
+  ArraysOf(Geometry, arrays, counts);
+  auto* data = static_cast<std::byte*>(view);
+  std::size_t offset = 0;
+  std::uint64_t offsets[4];
+  for (int i = 0; i < 4; ++i)
+  {
+    Store<std::uint64_t>(data + offset, counts[i]);
+    offset += sizeof(std::uint64_t);
+    offsets[i] = offset;
+    // uint32 indices have the bit pattern of the int32 indices that Unreal reads
+    if (!arrays[i].empty())
+      std::memcpy(data + offset, arrays[i].data(), arrays[i].size());
+    offset += arrays[i].size();
+  }
+  auto* index = data + offset;
+  std::memcpy(index, GeometryFileMagic, sizeof(GeometryFileMagic));
+  Store<std::uint32_t>(index + 4, GeometryFileVersion);
+  for (int i = 0; i < 4; ++i)
+    Store<std::uint64_t>(index + 8 + i * sizeof(std::uint64_t), offsets[i]);
+  Store<std::uint64_t>(index + 40, offset);
+#ifdef _WIN32
+  UnmapViewOfFile(view);
+  CloseHandle(mapping);
+  CloseHandle(file);
+#else
+  munmap(view, size);
+#endif
+}
+
+Synavis::GeometryFile::GeometryFile(const std::string& Filename)
+{
+  void* view = nullptr;
+#ifdef _WIN32
+  HANDLE file = CreateFileA(Filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("Could not open " + Filename);
+  LARGE_INTEGER length;
+  if (GetFileSizeEx(file, &length) && length.QuadPart > 0)
+  {
+    Size = static_cast<std::size_t>(length.QuadPart);
+    Handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (Handle != nullptr)
+      view = MapViewOfFile(Handle, FILE_MAP_READ, 0, 0, 0);
+  }
+  // the mapping keeps the file open
+  CloseHandle(file);
+  if (view == nullptr)
+  {
+    if (Handle != nullptr)
+      CloseHandle(Handle);
+    throw std::runtime_error("Could not map " + Filename);
+  }
+#else
+  const int file = open(Filename.c_str(), O_RDONLY);
+  if (file < 0)
+    throw std::runtime_error("Could not open " + Filename);
+  struct stat info;
+  if (fstat(file, &info) == 0 && info.st_size > 0)
+  {
+    Size = static_cast<std::size_t>(info.st_size);
+    view = mmap(nullptr, Size, PROT_READ, MAP_SHARED, file, 0);
+  }
+  close(file);
+  if (view == nullptr || view == MAP_FAILED)
+    throw std::runtime_error("Could not map " + Filename);
+#endif
+  Data = static_cast<const std::byte*>(view);
+  std::size_t body = Size;
+  if (Size >= GeometryFileIndexSize)
+  {
+    const auto* index = Data + Size - GeometryFileIndexSize;
+    Indexed = std::memcmp(index, GeometryFileMagic, sizeof(GeometryFileMagic)) == 0
+      && Read<std::uint32_t>(index + 4) == GeometryFileVersion
+      && Read<std::uint64_t>(index + 40) == Size - GeometryFileIndexSize;
+    if (Indexed)
+    {
+      body = Size - GeometryFileIndexSize;
+      for (int i = 0; i < 4; ++i)
+        Offsets[i] = static_cast<std::size_t>(Read<std::uint64_t>(index + 8 + i * sizeof(std::uint64_t)));
+    }
+  }
+  // the counts are in front of the arrays, without an index they are read one after another
+  std::size_t offset = sizeof(std::uint64_t);
+  for (int i = 0; i < 4; ++i)
+  {
+    if (Indexed)
+      offset = Offsets[i];
+    if (offset < sizeof(std::uint64_t) || offset > body)
+      break;
+    const auto count = Read<std::uint64_t>(Data + offset - sizeof(std::uint64_t));
+    if (count > (body - offset) / ElementSize[i])
+      break;
+    Counts[i] = static_cast<std::size_t>(count);
+    Offsets[i] = offset;
+    offset += Counts[i] * ElementSize[i] + sizeof(std::uint64_t);
+    if (i == 3)
+      return;
+  }
+  Unmap();
+  throw std::runtime_error(Filename + " is not a geometry file");
+}
+
+Synavis::GeometryFile::~GeometryFile()
+{
+  Unmap();
+}
+
+void Synavis::GeometryFile::Unmap()
+{
+  if (Data == nullptr)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(Data);
+  CloseHandle(Handle);
+#else
+  munmap(const_cast<std::byte*>(Data), Size);
+#endif
+  Data = nullptr;
+}
+
+std::optional<Synavis::MeshView> Synavis::GeometryFile::View() const
+{
+  for (int i : { 0, 2, 3 })
+  {
+    if (reinterpret_cast<std::uintptr_t>(Data + Offsets[i]) % alignof(double) != 0)
+      return std::nullopt;
+  }
+  if (reinterpret_cast<std::uintptr_t>(Data + Offsets[1]) % alignof(std::uint32_t) != 0)
+    return std::nullopt;
+  MeshView view;
+  view.Vertices = { reinterpret_cast<const double*>(Data + Offsets[0]), Counts[0] * 3 };
+  view.Indices = { reinterpret_cast<const std::uint32_t*>(Data + Offsets[1]), Counts[1] };
+  view.Normals = { reinterpret_cast<const double*>(Data + Offsets[2]), Counts[2] * 3 };
+  view.UVs = { reinterpret_cast<const double*>(Data + Offsets[3]), Counts[3] * 2 };
+  return view;
+}
+
+Synavis::Mesh Synavis::GeometryFile::Load() const
+{
+  Mesh geometry;
+  auto copy = [this](auto& Target, int Array, std::size_t Components)
+  {
+    Target.resize(Counts[Array] * Components);
+    if (!Target.empty())
+      std::memcpy(Target.data(), Data + Offsets[Array], Counts[Array] * ElementSize[Array]);
+  };
+  copy(geometry.Vertices, 0, 3);
+  copy(geometry.Indices, 1, 1);
+  if (Counts[2] > 0)
+    copy(geometry.Normals.emplace(), 2, 3);
+  if (Counts[3] > 0)
+    copy(geometry.UVs.emplace(), 3, 2);
+  return geometry;
+}
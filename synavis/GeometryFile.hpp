@@ -0,0 +1,80 @@
+#ifndef SYNAVIS_GEOMETRYFILE_HPP
+#define SYNAVIS_GEOMETRYFILE_HPP
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include "MeshCodec.hpp"
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+  // Geometry files are read by the "filegeometry" command of the Unreal plugin, which
+  // parses them front to back:
+  //
+  //  uint64 number of vertices, followed by 3 doubles per vertex
+  //  uint64 number of indices, followed by one int32 per index
+  //  uint64 number of normals, followed by 3 doubles per normal
+  //  uint64 number of texture coordinates, followed by 2 doubles per coordinate
+  //
+  // WriteGeometryFile appends an index behind this body, which sequential readers do
+  // not look at, so that other readers can map the arrays without parsing:
+  //
+  //  offset  size  content
+  //  0       4     magic "SYNG"
+  //  4       4     format version
+  //  8       8     offset of the vertices
+  //  16      8     offset of the indices
+  //  24      8     offset of the normals
+  //  32      8     offset of the texture coordinates
+  //  40      8     size of the body, this is the offset of the index
+  //
+  // The offsets point behind the counts of the arrays.
+  constexpr std::uint8_t GeometryFileMagic[4] = { 'S', 'Y', 'N', 'G' };
+  constexpr std::uint32_t GeometryFileVersion = 1;
+  constexpr std::size_t GeometryFileIndexSize = 48;
+
+  SYNAVIS_EXPORT std::size_t GeometryFileSize(const MeshView& Geometry);
+  // Writes the whole file through one memory mapping, the file is replaced if it exists.
+  // Throws std::runtime_error if the file cannot be written or the mesh has no
+  // complete vertices, normals or texture coordinates.
+  SYNAVIS_EXPORT void WriteGeometryFile(const std::string& Filename, const MeshView& Geometry);
+
+  // Maps a geometry file for reading. Files without an index, i.e. from older writers,
+  // are located by parsing the counts.
+  class SYNAVIS_EXPORT GeometryFile
+  {
+  public:
+    // throws std::runtime_error if the file cannot be mapped or is malformed
+    explicit GeometryFile(const std::string& Filename);
+    ~GeometryFile();
+    GeometryFile(const GeometryFile&) = delete;
+    GeometryFile& operator=(const GeometryFile&) = delete;
+
+    bool HasIndex() const { return Indexed; }
+    std::size_t VertexCount() const { return Counts[0]; }
+    std::size_t IndexCount() const { return Counts[1]; }
+    std::size_t NormalCount() const { return Counts[2]; }
+    std::size_t UVCount() const { return Counts[3]; }
+    // A view into the mapping, valid while the file is open. The normals and texture
+    // coordinates follow the 4-byte indices, so they are only aligned for doubles if
+    // the number of indices is even; there is no view otherwise.
+    std::optional<MeshView> View() const;
+    // copies the arrays, this works for every layout
+    Mesh Load() const;
+
+  private:
+    void Unmap();
+    const std::byte* Data{ nullptr };
+    std::size_t Size{ 0 };
+    std::size_t Offsets[4]{};
+    std::size_t Counts[4]{};
+    bool Indexed{ false };
+    void* Handle{ nullptr };
+  };
+}
+
+#endif
@@ -0,0 +1,128 @@
+#include "JitterBuffer.hpp"
+#include "Synavis.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include <rtc/rtc.hpp>
+
+static const Synavis::Logger::LoggerInstance ljitter = Synavis::Logger::Get()->LogStarter("JitterBuffer");
+
+namespace Synavis
+{
+  JitterBuffer::JitterBuffer(std::size_t Capacity, std::chrono::steady_clock::duration PlayoutDelay)
+    : Slots(std::bit_ceil(std::max<std::size_t>(Capacity, 2))), Mask(Slots.size() - 1), PlayoutDelay(PlayoutDelay)
+  {
+  }
+
+  bool JitterBuffer::Insert(rtc::binary&& Packet, std::chrono::steady_clock::time_point Now)
+  {
+    // the fixed part of the RTP header, the struct also reserves room for the CSRC list
+    if (Packet.size() < sizeof(std::uint32_t) * 3)
+      return false;
+    const auto seq = reinterpret_cast<const rtc::RtpHeader*>(Packet.data())->seqNumber();
+    std::uint64_t sequence;
+    if (!Highest.has_value())
+    {
+      // one rollover of headroom, so that packets before the first one still get a number
+      sequence = (std::uint64_t{ 1 } << 16) + seq;
+      Playout = sequence;
+      Highest = sequence;
+    }
+    else
+    {
+      // the distance to the highest sequence number in 16-bit arithmetic is rollover-safe
+      const auto distance = static_cast<std::int16_t>(static_cast<std::uint16_t>(seq - static_cast<std::uint16_t>(Highest.value())));
+      sequence = static_cast<std::uint64_t>(static_cast<std::int64_t>(Highest.value()) + distance);
+      if (sequence < Playout)
+      {
+        Late++;
+        return false;
+      }
+      Highest = std::max(Highest.value(), sequence);
+    }
+    if (sequence >= Playout + Slots.size())
+    {
+      ljitter(ELogVerbosity::Debug) << "Jitter buffer overflow at sequence number " << seq << std::endl;
+      Skip(sequence - Slots.size() + 1);
+    }
+    auto& slot = At(sequence);
+    // the window is at most one ring long, a filled slot can only hold the same packet
+    if (slot.Filled)
+      return false;
+    slot.Data = std::move(Packet);
+    slot.Sequence = sequence;
+    slot.Arrival = Now;
+    slot.Filled = true;
+    Count++;
+    return true;
+  }
+
+  std::optional<std::span<const std::byte>> JitterBuffer::Next(std::chrono::steady_clock::time_point Now)
+  {
+    if (Count == 0)
+      return std::nullopt;
+    if (!At(Playout).Filled)
+    {
+      // wait for the missing packets until the packet behind them is too old
+      auto behind = Playout + 1;
+      while (!At(behind).Filled)
+        behind++;
+      if (Now - At(behind).Arrival < PlayoutDelay)
+        return std::nullopt;
+      Skip(behind);
+    }
+    auto& slot = At(Playout);
+    slot.Filled = false;
+    Count--;
+    Playout++;
+    return std::span<const std::byte>(slot.Data);
+  }
+
+  void JitterBuffer::Skip(std::uint64_t Sequence)
+  {
+    std::optional<std::uint64_t> missing;
+    auto report = [this, &missing](std::uint64_t End)
+    {
+      if (!missing.has_value())
+        return;
+      const auto count = static_cast<std::size_t>(End - missing.value());
+      Lost += count;
+      ljitter(ELogVerbosity::Debug) << "Lost " << count << " packets from sequence number "
+        << static_cast<std::uint16_t>(missing.value()) << std::endl;
+      if (OnLoss)
+        OnLoss(static_cast<std::uint16_t>(missing.value()), count);
+      missing.reset();
+    };
+    // only one ring behind the playout can hold packets, the rest of a jump is empty
+    const auto window = std::min<std::uint64_t>(Sequence, Playout + Slots.size());
+    for (; Playout < window; ++Playout)
+    {
+      auto& slot = At(Playout);
+      if (slot.Filled)
+      {
+        report(Playout);
+        slot.Filled = false;
+        Count--;
+        Lost++;
+      }
+      else if (!missing.has_value())
+      {
+        missing = Playout;
+      }
+    }
+    if (Playout < Sequence && !missing.has_value())
+      missing = Playout;
+    Playout = std::max(Playout, Sequence);
+    report(Playout);
+  }
+
+  void JitterBuffer::Clear()
+  {
+    for (auto& slot : Slots)
+      slot.Filled = false;
+    Highest.reset();
+    Playout = 0;
+    Count = 0;
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef SYNAVIS_JITTERBUFFER_HPP
+#define SYNAVIS_JITTERBUFFER_HPP
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+#include <rtc/common.hpp>
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+  // Puts RTP packets back into sequence order. The packets are kept in a ring of
+  // Capacity slots indexed by their extended sequence number, i.e. the 16-bit sequence
+  // number plus the number of its rollovers, so that insertion and playout are O(1)
+  // and a rollover does not reorder anything.
+  // Packets are played out as soon as all their predecessors were, a missing packet
+  // is waited for until the packet behind it is older than the playout delay. Then
+  // the missing ones count as lost and are skipped, the depacketizer sees the gap in
+  // the sequence numbers and drops the frame. Packets that arrive after their slot was
+  // played out or skipped count as late and are discarded.
+  // The buffer is not synchronized, it belongs to the thread that decodes the stream.
+  class SYNAVIS_EXPORT JitterBuffer
+  {
+  public:
+    using LossCallback = std::function<void(std::uint16_t FirstSequence, std::size_t Count)>;
+
+    // the capacity is rounded up to a power of two
+    JitterBuffer(std::size_t Capacity = 512,
+      std::chrono::steady_clock::duration PlayoutDelay = std::chrono::milliseconds(50));
+
+    // Takes the packet without copying it. Returns false if the packet is malformed,
+    // a duplicate or late. A packet that is more than the capacity ahead of the
+    // playout skips the oldest slots, those are counted as lost.
+    bool Insert(rtc::binary&& Packet, std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now());
+    // The next packet in sequence order if it is ready, valid until the next call of
+    // Insert or Next
+    std::optional<std::span<const std::byte>> Next(std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now());
+
+    void SetPlayoutDelay(std::chrono::steady_clock::duration Delay) { PlayoutDelay = Delay; }
+    // called with every run of packets that was skipped, e.g. to request a key frame
+    void SetLossCallback(LossCallback Callback) { OnLoss = std::move(Callback); }
+    std::size_t GetCapacity() const { return Slots.size(); }
+    // number of packets that were inserted and not played out yet
+    std::size_t Pending() const { return Count; }
+    std::uint64_t GetLostPackets() const { return Lost; }
+    std::uint64_t GetLatePackets() const { return Late; }
+    // forgets all packets, the next packet starts a new sequence
+    void Clear();
+
+  private:
+    struct Slot
+    {
+      rtc::binary Data;
+      std::uint64_t Sequence{ 0 };
+      std::chrono::steady_clock::time_point Arrival;
+      bool Filled{ false };
+    };
+    Slot& At(std::uint64_t Sequence) { return Slots[Sequence & Mask]; }
+    // moves the playout to Sequence, counting the empty slots on the way as lost
+    void Skip(std::uint64_t Sequence);
+
+    std::vector<Slot> Slots;
+    std::uint64_t Mask;
+    std::chrono::steady_clock::duration PlayoutDelay;
+    LossCallback OnLoss;
+    // the extended sequence number of the next packet to play out
+    std::uint64_t Playout{ 0 };
+    // the highest extended sequence number that was inserted
+    std::optional<std::uint64_t> Highest;
+    std::size_t Count{ 0 };
+    std::uint64_t Lost{ 0 };
+    std::uint64_t Late{ 0 };
+  };
+}
+
+#endif
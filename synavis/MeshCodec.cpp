@@ -0,0 +1,819 @@
+#include "MeshCodec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+  using namespace Synavis;
+
+  template < typename T > void Store(std::byte* Destination, T Value)
+  {
+    auto bytes = std::bit_cast<std::array<std::byte, sizeof(T)>>(Value);
+    if constexpr (std::endian::native == std::endian::big)
+      std::reverse(bytes.begin(), bytes.end());
+    std::memcpy(Destination, bytes.data(), sizeof(T));
+  }
+
+  template < typename T > T Load(const std::byte* Source)
+  {
+    std::array<std::byte, sizeof(T)> bytes;
+    std::memcpy(bytes.data(), Source, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big)
+      std::reverse(bytes.begin(), bytes.end());
+    return std::bit_cast<T>(bytes);
+  }
+
+  constexpr std::size_t Align(std::size_t Offset)
+  {
+    return (Offset + 7) & ~static_cast<std::size_t>(7);
+  }
+
+  std::size_t ScalarSize(EMeshScalar Scalar)
+  {
+    switch (Scalar)
+    {
+    case EMeshScalar::Float64: return sizeof(double);
+    case EMeshScalar::Float32: return sizeof(float);
+    case EMeshScalar::UInt32: return sizeof(uint32_t);
+    case EMeshScalar::UInt16: return sizeof(uint16_t);
+    default: return 0;
+    }
+  }
+
+  bool HasFlag(std::uint16_t Flags, EMeshFlags Flag)
+  {
+    return (Flags & static_cast<std::uint16_t>(Flag)) != 0;
+  }
+
+  // quantized messages store their bounding boxes in front of the positions
+  constexpr std::size_t BoundsSize = 10 * sizeof(double);
+  constexpr double QuantizationSteps = 65535.0;
+  constexpr double OctahedralSteps = 32767.0;
+
+  std::size_t AttributeSize(EMeshScalar Precision, std::size_t Components, bool Direction)
+  {
+    if (Precision == EMeshScalar::Quantized16)
+      return (Direction ? 2 : Components) * sizeof(uint16_t);
+    return Components * ScalarSize(Precision);
+  }
+
+  std::uint64_t ZigZag(std::int64_t Value)
+  {
+    return (static_cast<std::uint64_t>(Value) << 1) ^ static_cast<std::uint64_t>(Value >> 63);
+  }
+
+  std::int64_t UnZigZag(std::uint64_t Value)
+  {
+    return static_cast<std::int64_t>(Value >> 1) ^ -static_cast<std::int64_t>(Value & 1);
+  }
+
+  std::size_t VarIntIndexSize(std::span<const uint32_t> Indices)
+  {
+    std::size_t size = 0;
+    std::int64_t previous = 0;
+    for (auto index : Indices)
+    {
+      auto value = ZigZag(static_cast<std::int64_t>(index) - previous);
+      previous = index;
+      do { ++size; value >>= 7; } while (value != 0);
+    }
+    return size;
+  }
+
+  // byte offsets of the blocks in a mesh message
+  struct MeshLayout
+  {
+    std::size_t Bounds, Vertices, Normals, UVs, Tangents, Indices, Total;
+  };
+
+  // IndexBytes is only used for varint coded indices, their size depends on the values
+  MeshLayout ComputeLayout(std::size_t NameLength, std::uint16_t Flags, EMeshScalar Precision, EMeshScalar IndexType,
+    std::uint64_t VertexCount, std::uint64_t IndexCount, std::uint64_t UVCount, std::size_t IndexBytes = 0)
+  {
+    MeshLayout layout{};
+    layout.Bounds = Align(MeshHeaderSize + NameLength);
+    layout.Vertices = (Precision == EMeshScalar::Quantized16) ? Align(layout.Bounds + BoundsSize) : layout.Bounds;
+    layout.Normals = Align(layout.Vertices + VertexCount * AttributeSize(Precision, 3, false));
+    layout.UVs = HasFlag(Flags, EMeshFlags::Normals) ? Align(layout.Normals + VertexCount * AttributeSize(Precision, 3, true)) : layout.Normals;
+    layout.Tangents = HasFlag(Flags, EMeshFlags::UVs) ? Align(layout.UVs + UVCount * AttributeSize(Precision, 2, false)) : layout.UVs;
+    layout.Indices = HasFlag(Flags, EMeshFlags::Tangents) ? Align(layout.Tangents + VertexCount * AttributeSize(Precision, 3, true)) : layout.Tangents;
+    layout.Total = layout.Indices + ((IndexType == EMeshScalar::VarInt) ? IndexBytes : IndexCount * ScalarSize(IndexType));
+    return layout;
+  }
+
+  EMeshScalar IndexTypeFor(std::size_t VertexCount, EMeshScalar Precision)
+  {
+    if (Precision == EMeshScalar::Quantized16)
+      return EMeshScalar::VarInt;
+    return (VertexCount <= 0xFFFF + 1) ? EMeshScalar::UInt16 : EMeshScalar::UInt32;
+  }
+
+  // smallest and largest value of each component
+  void ComputeBounds(std::span<const double> Values, std::size_t Components, double* Min, double* Max)
+  {
+    for (std::size_t c = 0; c < Components; ++c)
+    {
+      Min[c] = Values.empty() ? 0.0 : Values[c];
+      Max[c] = Min[c];
+    }
+    for (std::size_t i = 0; i < Values.size(); ++i)
+    {
+      Min[i % Components] = std::min(Min[i % Components], Values[i]);
+      Max[i % Components] = std::max(Max[i % Components], Values[i]);
+    }
+  }
+
+  void WriteQuantized(std::byte* Destination, std::span<const double> Values, std::size_t Components, const double* Min, const double* Max)
+  {
+    for (std::size_t i = 0; i < Values.size(); ++i)
+    {
+      const auto c = i % Components;
+      const double extent = Max[c] - Min[c];
+      const double fraction = (extent > 0.0) ? (Values[i] - Min[c]) / extent : 0.0;
+      Store(Destination + i * sizeof(uint16_t), static_cast<uint16_t>(std::lround(std::clamp(fraction, 0.0, 1.0) * QuantizationSteps)));
+    }
+  }
+
+  std::vector<double> ReadQuantized(const std::byte* Source, std::size_t Count, std::size_t Components, const double* Min, const double* Max)
+  {
+    std::vector<double> values(Count);
+    for (std::size_t i = 0; i < Count; ++i)
+    {
+      const auto c = i % Components;
+      values[i] = Min[c] + (Max[c] - Min[c]) * (Load<uint16_t>(Source + i * sizeof(uint16_t)) / QuantizationSteps);
+    }
+    return values;
+  }
+
+  double SignNotZero(double Value)
+  {
+    return (Value >= 0.0) ? 1.0 : -1.0;
+  }
+
+  // octahedral mapping of unit vectors onto two signed 16-bit values
+  void WriteOctahedral(std::byte* Destination, std::span<const double> Directions)
+  {
+    for (std::size_t i = 0; i + 2 < Directions.size(); i += 3)
+    {
+      double x = Directions[i], y = Directions[i + 1], z = Directions[i + 2];
+      const double length = std::abs(x) + std::abs(y) + std::abs(z);
+      if (length > 0.0)
+      {
+        x /= length; y /= length; z /= length;
+      }
+      else
+      {
+        x = 0.0; y = 0.0; z = 1.0;
+      }
+      if (z < 0.0)
+      {
+        const double folded_x = (1.0 - std::abs(y)) * SignNotZero(x);
+        y = (1.0 - std::abs(x)) * SignNotZero(y);
+        x = folded_x;
+      }
+      auto* target = Destination + (i / 3) * 2 * sizeof(int16_t);
+      Store(target, static_cast<int16_t>(std::lround(std::clamp(x, -1.0, 1.0) * OctahedralSteps)));
+      Store(target + sizeof(int16_t), static_cast<int16_t>(std::lround(std::clamp(y, -1.0, 1.0) * OctahedralSteps)));
+    }
+  }
+
+  std::vector<double> ReadOctahedral(const std::byte* Source, std::size_t Count)
+  {
+    std::vector<double> directions(Count * 3);
+    for (std::size_t i = 0; i < Count; ++i)
+    {
+      double x = Load<int16_t>(Source + i * 2 * sizeof(int16_t)) / OctahedralSteps;
+      double y = Load<int16_t>(Source + (i * 2 + 1) * sizeof(int16_t)) / OctahedralSteps;
+      const double z = 1.0 - std::abs(x) - std::abs(y);
+      if (z < 0.0)
+      {
+        const double unfolded_x = (1.0 - std::abs(y)) * SignNotZero(x);
+        y = (1.0 - std::abs(x)) * SignNotZero(y);
+        x = unfolded_x;
+      }
+      const double length = std::sqrt(x * x + y * y + z * z);
+      directions[i * 3] = x / length;
+      directions[i * 3 + 1] = y / length;
+      directions[i * 3 + 2] = z / length;
+    }
+    return directions;
+  }
+
+  std::uint16_t FlagsOf(const MeshView& Geometry)
+  {
+    std::uint16_t flags = 0;
+    if (!Geometry.Normals.empty()) flags |= static_cast<std::uint16_t>(EMeshFlags::Normals);
+    if (!Geometry.UVs.empty()) flags |= static_cast<std::uint16_t>(EMeshFlags::UVs);
+    if (!Geometry.Tangents.empty()) flags |= static_cast<std::uint16_t>(EMeshFlags::Tangents);
+    return flags;
+  }
+
+  void WriteAttribute(std::byte* Destination, std::span<const double> Values, EMeshScalar Precision)
+  {
+    if (Precision == EMeshScalar::Float64)
+    {
+      if constexpr (std::endian::native == std::endian::little)
+      {
+        std::memcpy(Destination, Values.data(), Values.size_bytes());
+        return;
+      }
+      for (std::size_t i = 0; i < Values.size(); ++i)
+        Store(Destination + i * sizeof(double), Values[i]);
+    }
+    else
+    {
+      for (std::size_t i = 0; i < Values.size(); ++i)
+        Store(Destination + i * sizeof(float), static_cast<float>(Values[i]));
+    }
+  }
+
+  std::vector<double> ReadAttribute(const std::byte* Source, std::size_t Count, EMeshScalar Precision)
+  {
+    std::vector<double> values(Count);
+    if (Precision == EMeshScalar::Float64)
+    {
+      for (std::size_t i = 0; i < Count; ++i)
+        values[i] = Load<double>(Source + i * sizeof(double));
+    }
+    else
+    {
+      for (std::size_t i = 0; i < Count; ++i)
+        values[i] = Load<float>(Source + i * sizeof(float));
+    }
+    return values;
+  }
+}
+
+std::size_t Synavis::EncodedMeshSize(const MeshView& Geometry, EMeshScalar Precision)
+{
+  const auto vertices = Geometry.Vertices.size() / 3;
+  const auto index_type = IndexTypeFor(vertices, Precision);
+  return ComputeLayout(Geometry.Name.size(), FlagsOf(Geometry), Precision, index_type, vertices, Geometry.Indices.size(),
+    Geometry.UVs.size() / 2, (index_type == EMeshScalar::VarInt) ? VarIntIndexSize(Geometry.Indices) : 0).Total;
+}
+
+Synavis::MeshErrorBounds Synavis::QuantizationErrorBounds(const MeshView& Geometry)
+{
+  double min[3], max[3];
+  MeshErrorBounds bounds{};
+  ComputeBounds(Geometry.Vertices, 3, min, max);
+  for (int c = 0; c < 3; ++c)
+    bounds.Position = std::max(bounds.Position, (max[c] - min[c]) / (2.0 * QuantizationSteps));
+  ComputeBounds(Geometry.UVs, 2, min, max);
+  for (int c = 0; c < 2; ++c)
+    bounds.UV = std::max(bounds.UV, (max[c] - min[c]) / (2.0 * QuantizationSteps));
+  // rounding moves the octahedral coordinates by at most half a step each, the
+  // mapping back onto the sphere stretches this by less than a factor of three
+  bounds.Direction = 3.0 * std::sqrt(2.0) * 0.5 / OctahedralSteps;
+  return bounds;
+}
+
+std::size_t Synavis::EncodeMeshInto(const MeshView& Geometry, std::span<std::byte> Target, EMeshScalar Precision)
+{
+  if (Precision != EMeshScalar::Float64 && Precision != EMeshScalar::Float32 && Precision != EMeshScalar::Quantized16)
+    throw std::runtime_error("Mesh attributes can only be encoded as Float64, Float32 or Quantized16");
+  if (Geometry.Vertices.size() % 3 != 0)
+    throw std::runtime_error("Mesh vertices must have three components");
+  if (Geometry.Name.size() > 0xFFFF)
+    throw std::runtime_error("Mesh name is too long");
+  const auto vertices = Geometry.Vertices.size() / 3;
+  if (vertices > 0xFFFFFFFFu || Geometry.Indices.size() > 0xFFFFFFFFu)
+    throw std::runtime_error("Mesh is too large for the binary format");
+  if (!Geometry.Normals.empty() && Geometry.Normals.size() != Geometry.Vertices.size())
+    throw std::runtime_error("Mesh normals must match the vertices");
+  if (!Geometry.Tangents.empty() && Geometry.Tangents.size() != Geometry.Vertices.size())
+    throw std::runtime_error("Mesh tangents must match the vertices");
+  if (Geometry.UVs.size() % 2 != 0)
+    throw std::runtime_error("Mesh texture coordinates must have two components");
+
+  const auto flags = FlagsOf(Geometry);
+  const auto index_type = IndexTypeFor(vertices, Precision);
+  const auto uvs = Geometry.UVs.size() / 2;
+  const auto index_bytes = (index_type == EMeshScalar::VarInt) ? VarIntIndexSize(Geometry.Indices) : 0;
+  const auto layout = ComputeLayout(Geometry.Name.size(), flags, Precision, index_type, vertices, Geometry.Indices.size(), uvs, index_bytes);
+
+  if (Target.size() < layout.Total)
+    throw std::runtime_error("Mesh does not fit into the target");
+  // cleared, so the alignment padding is deterministic
+  auto* data = Target.data();
+  std::memset(data, 0, layout.Total);
+  std::memcpy(data, MeshMagic, sizeof(MeshMagic));
+  Store<std::uint16_t>(data + 4, MeshFormatVersion);
+  Store<std::uint16_t>(data + 6, flags);
+  Store<std::uint8_t>(data + 8, static_cast<std::uint8_t>(Precision));
+  Store<std::uint8_t>(data + 9, static_cast<std::uint8_t>(index_type));
+  Store<std::uint16_t>(data + 10, static_cast<std::uint16_t>(Geometry.Name.size()));
+  Store<std::uint32_t>(data + 12, static_cast<std::uint32_t>(vertices));
+  Store<std::uint32_t>(data + 16, static_cast<std::uint32_t>(Geometry.Indices.size()));
+  Store<std::uint32_t>(data + 20, static_cast<std::uint32_t>(uvs));
+  Store<std::uint64_t>(data + 24, static_cast<std::uint64_t>(layout.Total));
+  std::memcpy(data + MeshHeaderSize, Geometry.Name.data(), Geometry.Name.size());
+
+  if (Precision == EMeshScalar::Quantized16)
+  {
+    // position min, position max, uv min, uv max
+    double bounds[10];
+    ComputeBounds(Geometry.Vertices, 3, bounds, bounds + 3);
+    ComputeBounds(Geometry.UVs, 2, bounds + 6, bounds + 8);
+    for (int i = 0; i < 10; ++i)
+      Store(data + layout.Bounds + i * sizeof(double), bounds[i]);
+    WriteQuantized(data + layout.Vertices, Geometry.Vertices, 3, bounds, bounds + 3);
+    if (!Geometry.Normals.empty())
+      WriteOctahedral(data + layout.Normals, Geometry.Normals);
+    if (!Geometry.UVs.empty())
+      WriteQuantized(data + layout.UVs, Geometry.UVs, 2, bounds + 6, bounds + 8);
+    if (!Geometry.Tangents.empty())
+      WriteOctahedral(data + layout.Tangents, Geometry.Tangents);
+  }
+  else
+  {
+    WriteAttribute(data + layout.Vertices, Geometry.Vertices, Precision);
+    if (!Geometry.Normals.empty())
+      WriteAttribute(data + layout.Normals, Geometry.Normals, Precision);
+    if (!Geometry.UVs.empty())
+      WriteAttribute(data + layout.UVs, Geometry.UVs, Precision);
+    if (!Geometry.Tangents.empty())
+      WriteAttribute(data + layout.Tangents, Geometry.Tangents, Precision);
+  }
+
+  if (index_type == EMeshScalar::VarInt)
+  {
+    auto* target = data + layout.Indices;
+    std::int64_t previous = 0;
+    for (auto index : Geometry.Indices)
+    {
+      auto value = ZigZag(static_cast<std::int64_t>(index) - previous);
+      previous = index;
+      do
+      {
+        *target++ = static_cast<std::byte>((value & 0x7F) | ((value > 0x7F) ? 0x80 : 0));
+        value >>= 7;
+      } while (value != 0);
+    }
+  }
+  else
+  {
+    for (std::size_t i = 0; i < Geometry.Indices.size(); ++i)
+    {
+      if (index_type == EMeshScalar::UInt16)
+        Store(data + layout.Indices + i * sizeof(uint16_t), static_cast<uint16_t>(Geometry.Indices[i]));
+      else
+        Store(data + layout.Indices + i * sizeof(uint32_t), Geometry.Indices[i]);
+    }
+  }
+  return layout.Total;
+}
+
+// encodes the mesh behind the current end of Target
+static void AppendMesh(const MeshView& Geometry, EMeshScalar Precision, rtc::binary& Target)
+{
+  const auto start = Target.size();
+  Target.resize(start + EncodedMeshSize(Geometry, Precision));
+  try
+  {
+    EncodeMeshInto(Geometry, std::span(Target).subspan(start), Precision);
+  }
+  catch (...)
+  {
+    // a rejected mesh leaves the target as it was
+    Target.resize(start);
+    throw;
+  }
+}
+
+rtc::binary Synavis::EncodeMesh(const MeshView& Geometry, EMeshScalar Precision)
+{
+  rtc::binary message;
+  AppendMesh(Geometry, Precision, message);
+  return message;
+}
+
+Synavis::Mesh Synavis::OptimizeVertexOrder(const MeshView& Geometry)
+{
+  constexpr auto unassigned = std::numeric_limits<uint32_t>::max();
+  const auto vertices = Geometry.Vertices.size() / 3;
+  // new position of every vertex, in order of first reference
+  std::vector<uint32_t> remap(vertices, unassigned);
+  uint32_t next = 0;
+  Mesh result;
+  result.Name = Geometry.Name;
+  result.Indices.resize(Geometry.Indices.size());
+  for (std::size_t i = 0; i < Geometry.Indices.size(); ++i)
+  {
+    const auto index = Geometry.Indices[i];
+    if (index >= vertices)
+      throw std::runtime_error("Mesh index out of range");
+    if (remap[index] == unassigned)
+      remap[index] = next++;
+    result.Indices[i] = remap[index];
+  }
+  for (auto& target : remap)
+  {
+    if (target == unassigned)
+      target = next++;
+  }
+  auto permute = [&](std::span<const double> Source, std::size_t Components)
+  {
+    std::vector<double> target(Source.size());
+    for (std::size_t v = 0; v < vertices && (v + 1) * Components <= Source.size(); ++v)
+      std::copy_n(Source.begin() + v * Components, Components, target.begin() + remap[v] * Components);
+    return target;
+  };
+  result.Vertices = permute(Geometry.Vertices, 3);
+  if (!Geometry.Normals.empty())
+    result.Normals = permute(Geometry.Normals, 3);
+  if (!Geometry.Tangents.empty())
+    result.Tangents = permute(Geometry.Tangents, 3);
+  // texture coordinates are only per vertex if there is one for each of them
+  if (!Geometry.UVs.empty())
+    result.UVs = (Geometry.UVs.size() == vertices * 2) ? permute(Geometry.UVs, 2) : std::vector<double>(Geometry.UVs.begin(), Geometry.UVs.end());
+  return result;
+}
+
+Synavis::MeshView Synavis::View(const Mesh& Geometry)
+{
+  MeshView view;
+  view.Name = Geometry.Name;
+  view.Vertices = Geometry.Vertices;
+  view.Indices = Geometry.Indices;
+  if (Geometry.Normals.has_value()) view.Normals = Geometry.Normals.value();
+  if (Geometry.UVs.has_value()) view.UVs = Geometry.UVs.value();
+  if (Geometry.Tangents.has_value()) view.Tangents = Geometry.Tangents.value();
+  return view;
+}
+
+bool Synavis::IsMeshMessage(std::span<const std::byte> Message)
+{
+  return Message.size() >= MeshHeaderSize && std::memcmp(Message.data(), MeshMagic, sizeof(MeshMagic)) == 0;
+}
+
+Synavis::Mesh Synavis::DecodeMesh(std::span<const std::byte> Message)
+{
+  if (!IsMeshMessage(Message))
+    throw std::runtime_error("Message is not a binary mesh");
+  const auto* data = Message.data();
+  if (Load<std::uint16_t>(data + 4) != MeshFormatVersion)
+    throw std::runtime_error("Unsupported binary mesh version");
+  const auto flags = Load<std::uint16_t>(data + 6);
+  const auto precision = static_cast<EMeshScalar>(Load<std::uint8_t>(data + 8));
+  const auto index_type = static_cast<EMeshScalar>(Load<std::uint8_t>(data + 9));
+  if (precision != EMeshScalar::Float64 && precision != EMeshScalar::Float32 && precision != EMeshScalar::Quantized16)
+    throw std::runtime_error("Invalid attribute type in binary mesh");
+  if (index_type != EMeshScalar::UInt32 && index_type != EMeshScalar::UInt16 && index_type != EMeshScalar::VarInt)
+    throw std::runtime_error("Invalid index type in binary mesh");
+  const std::size_t name_length = Load<std::uint16_t>(data + 10);
+  const std::uint64_t vertices = Load<std::uint32_t>(data + 12);
+  const std::uint64_t indices = Load<std::uint32_t>(data + 16);
+  const std::uint64_t uvs = Load<std::uint32_t>(data + 20);
+  const auto total = Load<std::uint64_t>(data + 24);
+  auto layout = ComputeLayout(name_length, flags, precision, index_type, vertices, indices, uvs);
+  // varint indices take up the rest of the message
+  if (index_type == EMeshScalar::VarInt && layout.Indices <= Message.size())
+    layout.Total = Message.size();
+  if (total != Message.size() || layout.Total != Message.size())
+    throw std::runtime_error("Binary mesh size does not match its header");
+  // every varint takes at least one byte, checked before the indices are allocated
+  if (index_type == EMeshScalar::VarInt && indices > Message.size() - layout.Indices)
+    throw std::runtime_error("Binary mesh index data is truncated");
+
+  Mesh result;
+  result.Name.assign(reinterpret_cast<const char*>(data + MeshHeaderSize), name_length);
+  if (precision == EMeshScalar::Quantized16)
+  {
+    double bounds[10];
+    for (int i = 0; i < 10; ++i)
+      bounds[i] = Load<double>(data + layout.Bounds + i * sizeof(double));
+    result.Vertices = ReadQuantized(data + layout.Vertices, vertices * 3, 3, bounds, bounds + 3);
+    if (HasFlag(flags, EMeshFlags::Normals))
+      result.Normals = ReadOctahedral(data + layout.Normals, vertices);
+    if (HasFlag(flags, EMeshFlags::UVs))
+      result.UVs = ReadQuantized(data + layout.UVs, uvs * 2, 2, bounds + 6, bounds + 8);
+    if (HasFlag(flags, EMeshFlags::Tangents))
+      result.Tangents = ReadOctahedral(data + layout.Tangents, vertices);
+  }
+  else
+  {
+    result.Vertices = ReadAttribute(data + layout.Vertices, vertices * 3, precision);
+    if (HasFlag(flags, EMeshFlags::Normals))
+      result.Normals = ReadAttribute(data + layout.Normals, vertices * 3, precision);
+    if (HasFlag(flags, EMeshFlags::UVs))
+      result.UVs = ReadAttribute(data + layout.UVs, uvs * 2, precision);
+    if (HasFlag(flags, EMeshFlags::Tangents))
+      result.Tangents = ReadAttribute(data + layout.Tangents, vertices * 3, precision);
+  }
+  result.Indices.resize(indices);
+  const auto* source = data + layout.Indices;
+  const auto* end = data + Message.size();
+  std::int64_t previous = 0;
+  for (std::size_t i = 0; i < indices; ++i)
+  {
+    std::int64_t index = 0;
+    if (index_type == EMeshScalar::VarInt)
+    {
+      std::uint64_t value = 0;
+      int shift = 0;
+      std::uint8_t byte = 0x80;
+      while (byte & 0x80)
+      {
+        if (source == end || shift > 63)
+          throw std::runtime_error("Binary mesh index data is truncated");
+        byte = static_cast<std::uint8_t>(*source++);
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        shift += 7;
+      }
+      index = previous + UnZigZag(value);
+      previous = index;
+    }
+    else if (index_type == EMeshScalar::UInt16)
+    {
+      index = Load<uint16_t>(source + i * sizeof(uint16_t));
+    }
+    else
+    {
+      index = Load<uint32_t>(source + i * sizeof(uint32_t));
+    }
+    if (index < 0 || static_cast<std::uint64_t>(index) >= vertices)
+      throw std::runtime_error("Binary mesh index out of range");
+    result.Indices[i] = static_cast<uint32_t>(index);
+  }
+  if (index_type == EMeshScalar::VarInt && source != end)
+    throw std::runtime_error("Binary mesh has trailing index data");
+  return result;
+}
+
+std::optional<rtc::binary> Synavis::EncodeMeshPatch(const MeshView& Previous, const MeshView& Current, EMeshScalar Precision, double Threshold)
+{
+  if (Precision != EMeshScalar::Float64 && Precision != EMeshScalar::Float32)
+    throw std::runtime_error("Mesh patches can only be encoded as Float64 or Float32");
+  const auto flags = FlagsOf(Current);
+  const auto base_vertices = Previous.Vertices.size() / 3;
+  const auto vertices = Current.Vertices.size() / 3;
+  if (Current.Name.size() > 0xFFFF || vertices > 0xFFFFFFFFu || Current.Indices.size() > 0xFFFFFFFFu)
+    return std::nullopt;
+  if (flags != FlagsOf(Previous) || vertices < base_vertices || Current.Indices.size() < Previous.Indices.size())
+    return std::nullopt;
+  auto per_vertex = [](const MeshView& Geometry)
+  {
+    return Geometry.Vertices.size() % 3 == 0
+      && (Geometry.Normals.empty() || Geometry.Normals.size() == Geometry.Vertices.size())
+      && (Geometry.Tangents.empty() || Geometry.Tangents.size() == Geometry.Vertices.size());
+  };
+  if (!per_vertex(Previous) || !per_vertex(Current))
+    return std::nullopt;
+  const bool patch_uvs = !Current.UVs.empty();
+  if (patch_uvs && (Current.UVs.size() != vertices * 2 || Previous.UVs.size() != base_vertices * 2))
+    return std::nullopt;
+  // only appended triangles are supported, the existing ones must be unchanged
+  if (!std::equal(Previous.Indices.begin(), Previous.Indices.end(), Current.Indices.begin()))
+    return std::nullopt;
+
+  auto changed = [&](std::size_t v)
+  {
+    if (v >= base_vertices)
+      return true;
+    auto differs = [v](std::span<const double> A, std::span<const double> B, std::size_t Components)
+    {
+      return !A.empty() && !std::equal(A.begin() + v * Components, A.begin() + (v + 1) * Components, B.begin() + v * Components);
+    };
+    return differs(Current.Vertices, Previous.Vertices, 3) || differs(Current.Normals, Previous.Normals, 3)
+      || differs(Current.UVs, Previous.UVs, 2) || differs(Current.Tangents, Previous.Tangents, 3);
+  };
+  const auto scalar = ScalarSize(Precision);
+  const std::size_t vertex_size = scalar * (3 + (Current.Normals.empty() ? 0 : 3) + (patch_uvs ? 2 : 0) + (Current.Tangents.empty() ? 0 : 3));
+  // runs of changed vertices, short gaps are sent along if that is cheaper than a new range
+  std::vector<std::pair<uint32_t, uint32_t>> ranges;
+  std::size_t patched_vertices = 0;
+  for (std::size_t v = 0; v < vertices; ++v)
+  {
+    if (!changed(v))
+      continue;
+    if (!ranges.empty())
+    {
+      auto& last = ranges.back();
+      const auto gap = v - (last.first + last.second);
+      if (gap * vertex_size <= 2 * sizeof(uint32_t))
+      {
+        patched_vertices += gap + 1;
+        last.second = static_cast<uint32_t>(v + 1 - last.first);
+        continue;
+      }
+    }
+    ranges.emplace_back(static_cast<uint32_t>(v), 1u);
+    patched_vertices++;
+  }
+
+  const auto appended = Current.Indices.size() - Previous.Indices.size();
+  const auto ranges_offset = Align(MeshPatchHeaderSize + Current.Name.size());
+  const auto data_offset = Align(ranges_offset + ranges.size() * 2 * sizeof(uint32_t));
+  std::size_t offset = data_offset;
+  const auto positions = offset; offset = Align(offset + patched_vertices * 3 * scalar);
+  const auto normals = offset; if (!Current.Normals.empty()) offset = Align(offset + patched_vertices * 3 * scalar);
+  const auto uvs = offset; if (patch_uvs) offset = Align(offset + patched_vertices * 2 * scalar);
+  const auto tangents = offset; if (!Current.Tangents.empty()) offset = Align(offset + patched_vertices * 3 * scalar);
+  const auto indices = offset;
+  const auto total = indices + appended * sizeof(uint32_t);
+  if (static_cast<double>(total) > Threshold * static_cast<double>(EncodedMeshSize(Current, Precision)))
+    return std::nullopt;
+
+  rtc::binary message(total);
+  auto* data = message.data();
+  std::memcpy(data, MeshPatchMagic, sizeof(MeshPatchMagic));
+  Store<std::uint16_t>(data + 4, MeshFormatVersion);
+  Store<std::uint16_t>(data + 6, flags);
+  Store<std::uint8_t>(data + 8, static_cast<std::uint8_t>(Precision));
+  Store<std::uint16_t>(data + 10, static_cast<std::uint16_t>(Current.Name.size()));
+  Store<std::uint32_t>(data + 12, static_cast<std::uint32_t>(base_vertices));
+  Store<std::uint32_t>(data + 16, static_cast<std::uint32_t>(vertices));
+  Store<std::uint32_t>(data + 20, static_cast<std::uint32_t>(ranges.size()));
+  Store<std::uint32_t>(data + 24, static_cast<std::uint32_t>(Previous.Indices.size()));
+  Store<std::uint32_t>(data + 28, static_cast<std::uint32_t>(appended));
+  Store<std::uint64_t>(data + 32, static_cast<std::uint64_t>(total));
+  std::memcpy(data + MeshPatchHeaderSize, Current.Name.data(), Current.Name.size());
+  std::size_t written = 0;
+  for (std::size_t r = 0; r < ranges.size(); ++r)
+  {
+    const auto [first, count] = ranges[r];
+    Store(data + ranges_offset + r * 2 * sizeof(uint32_t), first);
+    Store(data + ranges_offset + (r * 2 + 1) * sizeof(uint32_t), count);
+    WriteAttribute(data + positions + written * 3 * scalar, Current.Vertices.subspan(first * 3, count * 3), Precision);
+    if (!Current.Normals.empty())
+      WriteAttribute(data + normals + written * 3 * scalar, Current.Normals.subspan(first * 3, count * 3), Precision);
+    if (patch_uvs)
+      WriteAttribute(data + uvs + written * 2 * scalar, Current.UVs.subspan(first * 2, count * 2), Precision);
+    if (!Current.Tangents.empty())
+      WriteAttribute(data + tangents + written * 3 * scalar, Current.Tangents.subspan(first * 3, count * 3), Precision);
+    written += count;
+  }
+  for (std::size_t i = 0; i < appended; ++i)
+    Store(data + indices + i * sizeof(uint32_t), Current.Indices[Previous.Indices.size() + i]);
+  return message;
+}
+
+bool Synavis::IsMeshPatchMessage(std::span<const std::byte> Message)
+{
+  return Message.size() >= MeshPatchHeaderSize && std::memcmp(Message.data(), MeshPatchMagic, sizeof(MeshPatchMagic)) == 0;
+}
+
+void Synavis::ApplyMeshPatch(Mesh& Geometry, std::span<const std::byte> Message)
+{
+  if (!IsMeshPatchMessage(Message))
+    throw std::runtime_error("Message is not a mesh patch");
+  const auto* data = Message.data();
+  if (Load<std::uint16_t>(data + 4) != MeshFormatVersion)
+    throw std::runtime_error("Unsupported mesh patch version");
+  const auto flags = Load<std::uint16_t>(data + 6);
+  const auto precision = static_cast<EMeshScalar>(Load<std::uint8_t>(data + 8));
+  if (precision != EMeshScalar::Float64 && precision != EMeshScalar::Float32)
+    throw std::runtime_error("Invalid attribute type in mesh patch");
+  const std::size_t name_length = Load<std::uint16_t>(data + 10);
+  const std::uint64_t base_vertices = Load<std::uint32_t>(data + 12);
+  const std::uint64_t vertices = Load<std::uint32_t>(data + 16);
+  const std::uint64_t range_count = Load<std::uint32_t>(data + 20);
+  const std::uint64_t base_indices = Load<std::uint32_t>(data + 24);
+  const std::uint64_t appended = Load<std::uint32_t>(data + 28);
+  const auto total = Load<std::uint64_t>(data + 32);
+  if (std::string_view(reinterpret_cast<const char*>(data + MeshPatchHeaderSize), std::min<std::size_t>(name_length, Message.size() - MeshPatchHeaderSize)) != Geometry.Name)
+    throw std::runtime_error("Mesh patch is meant for another mesh");
+  if (Geometry.Vertices.size() != base_vertices * 3 || Geometry.Indices.size() != base_indices || vertices < base_vertices)
+    throw std::runtime_error("Mesh patch does not fit the mesh");
+  if (flags != FlagsOf(View(Geometry)))
+    throw std::runtime_error("Mesh patch attributes do not match the mesh");
+  const bool patch_uvs = HasFlag(flags, EMeshFlags::UVs);
+  if (patch_uvs && Geometry.UVs->size() != base_vertices * 2)
+    throw std::runtime_error("Mesh patch requires one texture coordinate per vertex");
+
+  const auto ranges_offset = Align(MeshPatchHeaderSize + name_length);
+  const auto data_offset = Align(ranges_offset + range_count * 2 * sizeof(uint32_t));
+  if (total != Message.size() || data_offset > Message.size())
+    throw std::runtime_error("Mesh patch size does not match its header");
+  // the ranges must be ordered, disjoint and cover all new vertices
+  std::uint64_t patched_vertices = 0, end = 0;
+  for (std::size_t r = 0; r < range_count; ++r)
+  {
+    const std::uint64_t first = Load<uint32_t>(data + ranges_offset + r * 2 * sizeof(uint32_t));
+    const std::uint64_t count = Load<uint32_t>(data + ranges_offset + (r * 2 + 1) * sizeof(uint32_t));
+    if (first < end || first + count > vertices)
+      throw std::runtime_error("Invalid vertex range in mesh patch");
+    // a gap must not reach into the new vertices
+    if (first > end && first > base_vertices)
+      throw std::runtime_error("Mesh patch does not cover all new vertices");
+    end = first + count;
+    patched_vertices += count;
+  }
+  if (end < vertices && vertices > base_vertices)
+    throw std::runtime_error("Mesh patch does not cover all new vertices");
+  const auto scalar = ScalarSize(precision);
+  std::size_t offset = data_offset;
+  const auto positions = offset; offset = Align(offset + patched_vertices * 3 * scalar);
+  const auto normals = offset; if (HasFlag(flags, EMeshFlags::Normals)) offset = Align(offset + patched_vertices * 3 * scalar);
+  const auto uvs = offset; if (patch_uvs) offset = Align(offset + patched_vertices * 2 * scalar);
+  const auto tangents = offset; if (HasFlag(flags, EMeshFlags::Tangents)) offset = Align(offset + patched_vertices * 3 * scalar);
+  const auto indices = offset;
+  if (indices + appended * sizeof(uint32_t) != Message.size())
+    throw std::runtime_error("Mesh patch size does not match its header");
+  for (std::size_t i = 0; i < appended; ++i)
+  {
+    if (Load<uint32_t>(data + indices + i * sizeof(uint32_t)) >= vertices)
+      throw std::runtime_error("Mesh patch index out of range");
+  }
+
+  // the patch is valid, apply it
+  auto apply = [&](std::vector<double>& Target, std::size_t Block, std::size_t Components)
+  {
+    Target.resize(vertices * Components);
+    std::size_t read = 0;
+    for (std::size_t r = 0; r < range_count; ++r)
+    {
+      const auto first = Load<uint32_t>(data + ranges_offset + r * 2 * sizeof(uint32_t));
+      const auto count = Load<uint32_t>(data + ranges_offset + (r * 2 + 1) * sizeof(uint32_t));
+      auto values = ReadAttribute(data + Block + read * Components * scalar, count * Components, precision);
+      std::copy(values.begin(), values.end(), Target.begin() + first * Components);
+      read += count;
+    }
+  };
+  apply(Geometry.Vertices, positions, 3);
+  if (HasFlag(flags, EMeshFlags::Normals))
+    apply(Geometry.Normals.value(), normals, 3);
+  if (patch_uvs)
+    apply(Geometry.UVs.value(), uvs, 2);
+  if (HasFlag(flags, EMeshFlags::Tangents))
+    apply(Geometry.Tangents.value(), tangents, 3);
+  for (std::size_t i = 0; i < appended; ++i)
+    Geometry.Indices.push_back(Load<uint32_t>(data + indices + i * sizeof(uint32_t)));
+}
+
+Synavis::GeometryBatch::GeometryBatch(EMeshScalar Precision) : Precision(Precision)
+{
+}
+
+void Synavis::GeometryBatch::Add(const MeshView& Geometry)
+{
+  // encode in place behind the previous mesh
+  const auto offset = Align(Payload.size());
+  Payload.resize(offset);
+  AppendMesh(Geometry, Precision, Payload);
+  Table.emplace_back(offset, Payload.size() - offset);
+}
+
+void Synavis::GeometryBatch::Clear()
+{
+  Payload.clear();
+  Table.clear();
+}
+
+std::size_t Synavis::GeometryBatch::Size() const
+{
+  return Align(GeometryBatchHeaderSize + Table.size() * 2 * sizeof(std::uint64_t)) + Payload.size();
+}
+
+rtc::binary Synavis::GeometryBatch::Finish() const
+{
+  const auto payload_offset = Align(GeometryBatchHeaderSize + Table.size() * 2 * sizeof(std::uint64_t));
+  rtc::binary message(payload_offset + Payload.size());
+  auto* data = message.data();
+  std::memcpy(data, GeometryBatchMagic, sizeof(GeometryBatchMagic));
+  Store<std::uint16_t>(data + 4, MeshFormatVersion);
+  Store<std::uint32_t>(data + 8, static_cast<std::uint32_t>(Table.size()));
+  Store<std::uint64_t>(data + 16, static_cast<std::uint64_t>(message.size()));
+  for (std::size_t i = 0; i < Table.size(); ++i)
+  {
+    Store<std::uint64_t>(data + GeometryBatchHeaderSize + i * 2 * sizeof(std::uint64_t), payload_offset + Table[i].first);
+    Store<std::uint64_t>(data + GeometryBatchHeaderSize + (i * 2 + 1) * sizeof(std::uint64_t), Table[i].second);
+  }
+  std::copy(Payload.begin(), Payload.end(), message.begin() + payload_offset);
+  return message;
+}
+
+bool Synavis::IsGeometryBatchMessage(std::span<const std::byte> Message)
+{
+  return Message.size() >= GeometryBatchHeaderSize && std::memcmp(Message.data(), GeometryBatchMagic, sizeof(GeometryBatchMagic)) == 0;
+}
+
+std::vector<Synavis::Mesh> Synavis::DecodeGeometryBatch(std::span<const std::byte> Message)
+{
+  if (!IsGeometryBatchMessage(Message))
+    throw std::runtime_error("Message is not a geometry batch");
+  const auto* data = Message.data();
+  if (Load<std::uint16_t>(data + 4) != MeshFormatVersion)
+    throw std::runtime_error("Unsupported geometry batch version");
+  const std::uint64_t count = Load<std::uint32_t>(data + 8);
+  if (Load<std::uint64_t>(data + 16) != Message.size() || GeometryBatchHeaderSize + count * 2 * sizeof(std::uint64_t) > Message.size())
+    throw std::runtime_error("Geometry batch size does not match its header");
+  std::vector<Mesh> meshes;
+  meshes.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const auto offset = Load<std::uint64_t>(data + GeometryBatchHeaderSize + i * 2 * sizeof(std::uint64_t));
+    const auto size = Load<std::uint64_t>(data + GeometryBatchHeaderSize + (i * 2 + 1) * sizeof(std::uint64_t));
+    if (offset > Message.size() || size > Message.size() - offset)
+      throw std::runtime_error("Geometry batch entry out of range");
+    meshes.push_back(DecodeMesh(Message.subspan(offset, size)));
+  }
+  return meshes;
+}
@@ -0,0 +1,184 @@
+#ifndef SYNAVIS_MESHCODEC_HPP
+#define SYNAVIS_MESHCODEC_HPP
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <rtc/common.hpp>
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+  // Binary mesh messages replace the JSON/base64 geometry transmission.
+  // All values are little endian, the header has a fixed size:
+  //
+  //  offset  size  content
+  //  0       4     magic "SYNM"
+  //  4       2     format version
+  //  6       2     EMeshFlags
+  //  8       1     scalar type of the vertex attributes (EMeshScalar)
+  //  9       1     scalar type of the indices (EMeshScalar)
+  //  10      2     length of the mesh name in bytes
+  //  12      4     number of vertices (3 components each)
+  //  16      4     number of indices
+  //  20      4     number of texture coordinates (2 components each)
+  //  24      8     total size of the message in bytes
+  //
+  // The header is followed by the name and the positions, normals, texture
+  // coordinates, tangents and indices. Every block starts at a multiple of 8 bytes.
+  // Normals and tangents have one entry per vertex if present.
+  //
+  // Quantized messages store the bounding boxes of the positions and texture
+  // coordinates as 10 doubles (position min, position max, uv min, uv max) in front
+  // of the positions. Positions and texture coordinates are 16-bit fractions of
+  // their box, normals and tangents are 16-bit octahedral pairs and the indices
+  // are zigzag coded deltas to the previous index as LEB128 varints.
+  constexpr std::uint8_t MeshMagic[4] = { 'S', 'Y', 'N', 'M' };
+  constexpr std::uint16_t MeshFormatVersion = 1;
+  constexpr std::size_t MeshHeaderSize = 32;
+
+  // Mesh patches update a mesh that the receiver got before, they share the
+  // conventions of mesh messages:
+  //
+  //  offset  size  content
+  //  0       4     magic "SYNP"
+  //  4       2     format version
+  //  6       2     EMeshFlags of the patched mesh
+  //  8       1     scalar type of the vertex attributes (Float64 or Float32)
+  //  9       1     reserved
+  //  10      2     length of the mesh name in bytes
+  //  12      4     number of vertices before the patch
+  //  16      4     number of vertices after the patch
+  //  20      4     number of vertex ranges
+  //  24      4     number of indices before the patch
+  //  28      4     number of appended indices
+  //  32      8     total size of the message in bytes
+  //
+  // The header is followed by the name, the ranges as (first vertex, count) pairs
+  // of uint32 and the positions, normals, texture coordinates and tangents of all
+  // vertices in the ranges. The appended indices come last as uint32. Vertices
+  // behind the previous vertex count must be covered by a range.
+  constexpr std::uint8_t MeshPatchMagic[4] = { 'S', 'Y', 'N', 'P' };
+  constexpr std::size_t MeshPatchHeaderSize = 40;
+
+  // Geometry batches pack many mesh messages into one transfer:
+  //
+  //  offset  size  content
+  //  0       4     magic "SYNB"
+  //  4       2     format version
+  //  6       2     reserved
+  //  8       4     number of meshes
+  //  12      4     reserved
+  //  16      8     total size of the message in bytes
+  //  24      16*n  offset and size of every mesh message as uint64
+  //
+  // The mesh messages follow the table, each starting at a multiple of 8 bytes.
+  constexpr std::uint8_t GeometryBatchMagic[4] = { 'S', 'Y', 'N', 'B' };
+  constexpr std::size_t GeometryBatchHeaderSize = 24;
+
+  enum class EMeshFlags : std::uint16_t
+  {
+    None = 0,
+    Normals = 1 << 0,
+    UVs = 1 << 1,
+    Tangents = 1 << 2
+  };
+
+  // values are part of the wire format and must not change
+  enum class EMeshScalar : std::uint8_t
+  {
+    Float64 = 1,
+    Float32 = 2,
+    UInt32 = 3,
+    UInt16 = 4,
+    Quantized16 = 5,
+    VarInt = 6
+  };
+
+  // non-owning description of the mesh that is to be encoded, empty attributes are omitted
+  struct MeshView
+  {
+    std::string_view Name;
+    std::span<const double> Vertices;
+    std::span<const uint32_t> Indices;
+    std::span<const double> Normals;
+    std::span<const double> UVs;
+    std::span<const double> Tangents;
+  };
+
+  struct SYNAVIS_EXPORT Mesh
+  {
+    std::string Name;
+    std::vector<double> Vertices;
+    std::vector<uint32_t> Indices;
+    std::optional<std::vector<double>> Normals;
+    std::optional<std::vector<double>> UVs;
+    std::optional<std::vector<double>> Tangents;
+  };
+
+  // largest absolute deviation that quantization introduces per component, for
+  // directions this is the distance between the original and the decoded unit vector
+  struct MeshErrorBounds
+  {
+    double Position;
+    double UV;
+    double Direction;
+  };
+
+  // Precision is applied to all vertex attributes, the index type is chosen from the vertex count.
+  // Quantized16 expects unit normals and tangents, other directions are normalized.
+  SYNAVIS_EXPORT rtc::binary EncodeMesh(const MeshView& Geometry, EMeshScalar Precision = EMeshScalar::Float32);
+  SYNAVIS_EXPORT std::size_t EncodedMeshSize(const MeshView& Geometry, EMeshScalar Precision = EMeshScalar::Float32);
+  // Encodes into memory that the caller owns, e.g. a shared memory slot, and returns the
+  // size of the message. Throws std::runtime_error if Target is smaller than EncodedMeshSize.
+  SYNAVIS_EXPORT std::size_t EncodeMeshInto(const MeshView& Geometry, std::span<std::byte> Target, EMeshScalar Precision = EMeshScalar::Float32);
+  SYNAVIS_EXPORT MeshErrorBounds QuantizationErrorBounds(const MeshView& Geometry);
+
+  // Renumbers the vertices in the order in which the triangles reference them. This
+  // improves the vertex cache locality of the receiver and keeps the index deltas
+  // small for the varint coding. Unreferenced vertices are moved to the end.
+  SYNAVIS_EXPORT Mesh OptimizeVertexOrder(const MeshView& Geometry);
+  SYNAVIS_EXPORT MeshView View(const Mesh& Geometry);
+  SYNAVIS_EXPORT bool IsMeshMessage(std::span<const std::byte> Message);
+  // Reference decoder, throws std::runtime_error if the message is malformed
+  SYNAVIS_EXPORT Mesh DecodeMesh(std::span<const std::byte> Message);
+
+  // Encodes the difference between two versions of a mesh as a patch. Returns nothing
+  // if the patch is larger than Threshold times the full Float64/Float32 mesh message or
+  // if the meshes cannot be patched, i.e. vertices were removed, existing triangles
+  // changed or attributes were added or removed. Texture coordinates are only patched
+  // if there is one per vertex.
+  SYNAVIS_EXPORT std::optional<rtc::binary> EncodeMeshPatch(const MeshView& Previous, const MeshView& Current,
+    EMeshScalar Precision = EMeshScalar::Float32, double Threshold = 0.5);
+  SYNAVIS_EXPORT bool IsMeshPatchMessage(std::span<const std::byte> Message);
+  // Reference decoder for patches, throws std::runtime_error if the patch does not fit the mesh
+  SYNAVIS_EXPORT void ApplyMeshPatch(Mesh& Geometry, std::span<const std::byte> Message);
+
+  // Accumulates meshes for a single transfer. Meshes are encoded when they are added,
+  // so the views only need to stay valid during Add.
+  class SYNAVIS_EXPORT GeometryBatch
+  {
+  public:
+    GeometryBatch(EMeshScalar Precision = EMeshScalar::Float32);
+    void Add(const MeshView& Geometry);
+    void Clear();
+    std::size_t Count() const { return Table.size(); }
+    // size of the batch message in bytes
+    std::size_t Size() const;
+    rtc::binary Finish() const;
+  private:
+    EMeshScalar Precision;
+    rtc::binary Payload;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> Table;
+  };
+
+  SYNAVIS_EXPORT bool IsGeometryBatchMessage(std::span<const std::byte> Message);
+  // Reference decoder for batches, throws std::runtime_error if the message is malformed
+  SYNAVIS_EXPORT std::vector<Mesh> DecodeGeometryBatch(std::span<const std::byte> Message);
+}
+
+#endif
@@ -0,0 +1,179 @@
+#include "MessageDispatcher.hpp"
+#include "MessageScan.hpp"
+#include "Synavis.hpp"
+
+#include <charconv>
+#include <climits>
+#include <stdexcept>
+
+static const Synavis::Logger::LoggerInstance lrequest = Synavis::Logger::Get()->LogStarter("RequestTracker");
+
+std::string_view Synavis::LazyMessage::Type() const
+{
+  if (!CachedType.has_value())
+    CachedType = FindJsonString(Content, "type");
+  return CachedType.value();
+}
+
+std::string_view Synavis::LazyMessage::Field(std::string_view Key) const
+{
+  return FindJsonField(Content, Key);
+}
+
+const nlohmann::json& Synavis::LazyMessage::Document()
+{
+  if (!Parsed.has_value())
+    Parsed = nlohmann::json::parse(Content);
+  return Parsed.value();
+}
+
+void Synavis::MessageDispatcher::On(std::string Type, Handler Callback)
+{
+  auto handler = std::make_shared<const Handler>(std::move(Callback));
+  std::unique_lock<std::shared_mutex> lock(HandlerLock);
+  Handlers.insert_or_assign(std::move(Type), std::move(handler));
+}
+
+void Synavis::MessageDispatcher::Remove(std::string_view Type)
+{
+  std::unique_lock<std::shared_mutex> lock(HandlerLock);
+  auto entry = Handlers.find(Type);
+  if (entry != Handlers.end())
+    Handlers.erase(entry);
+}
+
+bool Synavis::MessageDispatcher::Handles(std::string_view Type) const
+{
+  return Find(Type) != nullptr;
+}
+
+std::shared_ptr<const Synavis::MessageDispatcher::Handler> Synavis::MessageDispatcher::Find(std::string_view Type) const
+{
+  std::shared_lock<std::shared_mutex> lock(HandlerLock);
+  auto entry = Handlers.find(Type);
+  return (entry != Handlers.end()) ? entry->second : nullptr;
+}
+
+bool Synavis::MessageDispatcher::Dispatch(std::string_view Message)
+{
+  LazyMessage message(Message);
+  return Dispatch(message);
+}
+
+bool Synavis::MessageDispatcher::Dispatch(LazyMessage& Message)
+{
+  const auto type = Message.Type();
+  if (type.empty())
+    return false;
+  // the handler is called without the lock, so it may change the registrations
+  auto handler = Find(type);
+  if (!handler)
+    return false;
+  (*handler)(Message);
+  return true;
+}
+
+Synavis::RequestTracker::~RequestTracker()
+{
+  Stop();
+}
+
+std::pair<int, std::future<nlohmann::json>> Synavis::RequestTracker::Open(double Timeout)
+{
+  std::promise<nlohmann::json> reply;
+  auto future = reply.get_future();
+  std::unique_lock<std::mutex> lock(RequestLock);
+  // the receiver only answers with a player_id for non-negative ids
+  const int id = NextId;
+  NextId = (NextId == INT_MAX) ? 0 : NextId + 1;
+  if (Pending.contains(id))
+    throw std::runtime_error("Too many outstanding requests");
+  const auto deadline = std::chrono::steady_clock::now()
+    + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(Timeout));
+  Pending.emplace(id, PendingRequest{ std::move(reply), Deadlines.emplace(deadline, id) });
+  Count++;
+  if (!Running)
+  {
+    Running = true;
+    TimeoutThread = std::async(std::launch::async, &RequestTracker::TimeoutRun, this);
+  }
+  RequestCondition.notify_all();
+  return { id, std::move(future) };
+}
+
+bool Synavis::RequestTracker::Resolve(const LazyMessage& Message)
+{
+  const auto field = Message.Field("player_id");
+  int id;
+  if (field.empty() || std::from_chars(field.data(), field.data() + field.size(), id).ec != std::errc())
+    return false;
+  std::promise<nlohmann::json> reply;
+  {
+    std::unique_lock<std::mutex> lock(RequestLock);
+    auto entry = Pending.find(id);
+    if (entry == Pending.end())
+      return false;
+    reply = std::move(entry->second.Reply);
+    Deadlines.erase(entry->second.Deadline);
+    Pending.erase(entry);
+    Count--;
+  }
+  auto content = nlohmann::json::parse(Message.Text(), nullptr, false);
+  if (content.is_discarded())
+    reply.set_exception(std::make_exception_ptr(std::runtime_error("Reply to request " + std::to_string(id) + " is not valid JSON")));
+  else
+    reply.set_value(std::move(content));
+  return true;
+}
+
+void Synavis::RequestTracker::Fail(int Id, const char* What)
+{
+  std::unique_lock<std::mutex> lock(RequestLock);
+  FailLocked(Id, What);
+}
+
+void Synavis::RequestTracker::FailLocked(int Id, const char* What)
+{
+  auto entry = Pending.find(Id);
+  if (entry == Pending.end())
+    return;
+  entry->second.Reply.set_exception(std::make_exception_ptr(std::runtime_error(What)));
+  Deadlines.erase(entry->second.Deadline);
+  Pending.erase(entry);
+  Count--;
+}
+
+void Synavis::RequestTracker::Stop()
+{
+  {
+    std::unique_lock<std::mutex> lock(RequestLock);
+    Running = false;
+    RequestCondition.notify_all();
+  }
+  if (TimeoutThread.valid())
+    TimeoutThread.wait();
+}
+
+void Synavis::RequestTracker::TimeoutRun()
+{
+  std::unique_lock<std::mutex> lock(RequestLock);
+  while (Running)
+  {
+    if (Deadlines.empty())
+    {
+      RequestCondition.wait(lock, [this]() { return !Deadlines.empty() || !Running; });
+    }
+    else if (const auto deadline = Deadlines.begin()->first; std::chrono::steady_clock::now() < deadline)
+    {
+      // an earlier deadline or the shutdown wake this up before
+      RequestCondition.wait_until(lock, deadline);
+    }
+    else
+    {
+      lrequest(ELogVerbosity::Debug) << "Request " << Deadlines.begin()->second << " timed out" << std::endl;
+      FailLocked(Deadlines.begin()->second, "Request timed out");
+    }
+  }
+  while (!Deadlines.empty())
+    FailLocked(Deadlines.begin()->second, "The requests were shut down");
+}
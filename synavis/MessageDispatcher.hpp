@@ -0,0 +1,103 @@
+#ifndef SYNAVIS_MESSAGEDISPATCHER_HPP
+#define SYNAVIS_MESSAGEDISPATCHER_HPP
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <json.hpp>
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+  // A received JSON message that is only parsed as far as its reader needs it.
+  // The type and single top-level fields are read from the text, the full document
+  // is built on the first call of Document(). The text must outlive the message.
+  class SYNAVIS_EXPORT LazyMessage
+  {
+  public:
+    explicit LazyMessage(std::string_view Text) : Content(Text) {}
+    std::string_view Text() const { return Content; }
+    std::string_view Type() const;
+    // the raw JSON value of a top-level field, empty if it is missing
+    std::string_view Field(std::string_view Key) const;
+    // throws nlohmann::json::parse_error if the message is not valid JSON
+    const nlohmann::json& Document();
+  private:
+    std::string_view Content;
+    mutable std::optional<std::string_view> CachedType;
+    std::optional<nlohmann::json> Parsed;
+  };
+
+  // Calls the handler registered for the "type" of a message. Handlers can be
+  // registered and removed from any thread, also from within a handler.
+  class SYNAVIS_EXPORT MessageDispatcher
+  {
+  public:
+    using Handler = std::function<void(LazyMessage&)>;
+    // replaces the handler of this type if there is one
+    void On(std::string Type, Handler Callback);
+    void Remove(std::string_view Type);
+    bool Handles(std::string_view Type) const;
+    // returns false if there is no handler for the type of the message
+    bool Dispatch(std::string_view Message);
+    bool Dispatch(LazyMessage& Message);
+  private:
+    // allows lookups with a string_view without building a std::string
+    struct TypeHash
+    {
+      using is_transparent = void;
+      std::size_t operator()(std::string_view Type) const { return std::hash<std::string_view>{}(Type); }
+    };
+    std::shared_ptr<const Handler> Find(std::string_view Type) const;
+    mutable std::shared_mutex HandlerLock;
+    std::unordered_map<std::string, std::shared_ptr<const Handler>, TypeHash, std::equal_to<>> Handlers;
+  };
+
+  // Correlates requests with their replies. Every request gets an id that the receiver
+  // returns as "player_id", the reply resolves the future of the request and a request
+  // that is not answered in time fails. The deadlines are watched by a thread that is
+  // started with the first request.
+  class SYNAVIS_EXPORT RequestTracker
+  {
+  public:
+    ~RequestTracker();
+    // registers a request, throws std::runtime_error if all ids are in use
+    std::pair<int, std::future<nlohmann::json>> Open(double Timeout);
+    // resolves the request that a reply with a "player_id" belongs to, false if there is none
+    bool Resolve(const LazyMessage& Message);
+    void Fail(int Id, const char* What);
+    // fails all outstanding requests and stops watching the deadlines
+    void Stop();
+    // read on every received message, so the lock is only taken if requests are outstanding
+    std::size_t Outstanding() const { return Count; }
+  private:
+    struct PendingRequest
+    {
+      std::promise<nlohmann::json> Reply;
+      std::multimap<std::chrono::steady_clock::time_point, int>::iterator Deadline;
+    };
+    void FailLocked(int Id, const char* What);
+    void TimeoutRun();
+    std::mutex RequestLock;
+    std::condition_variable RequestCondition;
+    std::unordered_map<int, PendingRequest> Pending;
+    std::multimap<std::chrono::steady_clock::time_point, int> Deadlines;
+    std::atomic<std::size_t> Count{ 0 };
+    int NextId{ 0 };
+    bool Running{ false };
+    std::future<void> TimeoutThread;
+  };
+}
+
+#endif
@@ -0,0 +1,241 @@
+#include "MessageScan.hpp"
+#include "MeshCodec.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+// SSE2 is part of every x86-64 target, other platforms use the scalar loops
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SYNAVIS_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  std::size_t SkipSpace(std::string_view Text, std::size_t i)
+  {
+    while (i < Text.size() && (Text[i] == ' ' || Text[i] == '\t' || Text[i] == '\n' || Text[i] == '\r'))
+      ++i;
+    return i;
+  }
+
+  // Text[i] is the opening quote, returns the position behind the closing one
+  std::size_t SkipString(std::string_view Text, std::size_t i)
+  {
+    for (++i; i < Text.size(); ++i)
+    {
+      if (Text[i] == '\\')
+        ++i;
+      else if (Text[i] == '"')
+        return i + 1;
+    }
+    return std::string_view::npos;
+  }
+
+  std::size_t SkipValue(std::string_view Text, std::size_t i)
+  {
+    if (i >= Text.size())
+      return std::string_view::npos;
+    if (Text[i] == '"')
+      return SkipString(Text, i);
+    if (Text[i] == '{' || Text[i] == '[')
+    {
+      int depth = 0;
+      while (i < Text.size())
+      {
+        const char c = Text[i];
+        if (c == '"')
+        {
+          i = SkipString(Text, i);
+          if (i == std::string_view::npos)
+            return i;
+          continue;
+        }
+        if (c == '{' || c == '[')
+          depth++;
+        else if ((c == '}' || c == ']') && --depth == 0)
+          return i + 1;
+        ++i;
+      }
+      return std::string_view::npos;
+    }
+    // numbers and literals end at the next delimiter
+    while (i < Text.size() && Text[i] != ',' && Text[i] != '}' && Text[i] != ']' && Text[i] != ' '
+      && Text[i] != '\t' && Text[i] != '\n' && Text[i] != '\r')
+      ++i;
+    return i;
+  }
+}
+
+std::string_view Synavis::FindJsonField(std::string_view Object, std::string_view Key)
+{
+  auto i = SkipSpace(Object, 0);
+  if (i >= Object.size() || Object[i] != '{')
+    return {};
+  i = SkipSpace(Object, i + 1);
+  while (i < Object.size() && Object[i] == '"')
+  {
+    const auto key_end = SkipString(Object, i);
+    if (key_end == std::string_view::npos)
+      return {};
+    const auto key = Object.substr(i + 1, key_end - i - 2);
+    i = SkipSpace(Object, key_end);
+    if (i >= Object.size() || Object[i] != ':')
+      return {};
+    i = SkipSpace(Object, i + 1);
+    const auto value_end = SkipValue(Object, i);
+    if (value_end == std::string_view::npos || value_end == i)
+      return {};
+    if (key == Key)
+      return Object.substr(i, value_end - i);
+    i = SkipSpace(Object, value_end);
+    if (i >= Object.size() || Object[i] != ',')
+      return {};
+    i = SkipSpace(Object, i + 1);
+  }
+  return {};
+}
+
+std::string_view Synavis::FindJsonString(std::string_view Object, std::string_view Key)
+{
+  const auto value = FindJsonField(Object, Key);
+  if (value.size() < 2 || value.front() != '"' || value.find('\\') != std::string_view::npos)
+    return {};
+  return value.substr(1, value.size() - 2);
+}
+
+std::string_view Synavis::FindJsonObject(std::string_view Text)
+{
+  // find uses memchr, which the C library already vectorizes
+  const auto first = Text.find('{');
+  if (first == std::string_view::npos)
+    return {};
+  const char* data = Text.data();
+  std::size_t i = first;
+  int depth = 0;
+#ifdef SYNAVIS_SCAN_SSE2
+  const __m128i open = _mm_set1_epi8('{');
+  const __m128i close = _mm_set1_epi8('}');
+  for (; i + 16 <= Text.size(); i += 16)
+  {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const unsigned opens = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, open)));
+    const unsigned closes = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, close)));
+    // most blocks of a large message contain no brace at all
+    for (unsigned braces = opens | closes; braces != 0; braces &= braces - 1)
+    {
+      const unsigned bit = static_cast<unsigned>(std::countr_zero(braces));
+      depth += ((opens >> bit) & 1u) ? 1 : -1;
+      if (depth == 0)
+        return Text.substr(first, i + bit - first + 1);
+    }
+  }
+#endif
+  for (; i < Text.size(); ++i)
+  {
+    if (data[i] == '{')
+      depth++;
+    else if (data[i] == '}' && --depth == 0)
+      return Text.substr(first, i - first + 1);
+  }
+  return {};
+}
+
+Synavis::EInboundRoute Synavis::RouteInbound(std::span<const std::byte> Data, std::byte Marker)
+{
+  if (Data.empty())
+    return EInboundRoute::Ignore;
+  // binary geometry starts with its magic instead of a message byte
+  if (IsMeshMessage(Data) || IsMeshPatchMessage(Data) || IsGeometryBatchMessage(Data))
+    return EInboundRoute::Data;
+  // JSON sent by another connector, fragments carry the same marker but a zero length
+  if (Data[0] == Marker && Data.size() > 3 && (std::to_integer<std::uint16_t>(Data[1]) | std::to_integer<std::uint16_t>(Data[2]) << 8) != 0)
+    return EInboundRoute::Message;
+  const auto message_byte = std::to_integer<std::uint8_t>(Data[0]);
+  // Unreal uses the message bytes 0 to 13 and 255 for the protocol
+  if (message_byte > 13 && message_byte != 255)
+    return EInboundRoute::Data;
+  if (message_byte == 1 || message_byte == 7 || message_byte == 255)
+    return EInboundRoute::Message;
+  return EInboundRoute::Ignore;
+}
+
+bool Synavis::IsUtf16Text(std::span<const std::byte> Data)
+{
+  return Data.size() >= 4 && Data[0] != std::byte{ 0 } && Data[1] == std::byte{ 0 } && Data[3] == std::byte{ 0 };
+}
+
+std::string_view Synavis::NarrowUtf16(std::span<const std::byte> Data, std::string& Buffer)
+{
+  const auto* source = reinterpret_cast<const std::uint8_t*>(Data.data());
+  const std::size_t units = Data.size() / 2;
+  // three bytes per unit is the worst case, surrogate pairs need four bytes for two units
+  Buffer.resize(units * 3);
+  auto* destination = reinterpret_cast<std::uint8_t*>(Buffer.data());
+  std::size_t written = 0;
+  std::size_t i = 0;
+  auto unit = [source](std::size_t Index) -> std::uint32_t
+  {
+    return static_cast<std::uint32_t>(source[2 * Index]) | (static_cast<std::uint32_t>(source[2 * Index + 1]) << 8);
+  };
+  while (i < units)
+  {
+#ifdef SYNAVIS_SCAN_SSE2
+    // eight ASCII units at a time, these are the bulk of every JSON message
+    const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+    while (i + 8 <= units)
+    {
+      const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * i));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(block, high), _mm_setzero_si128())) != 0xFFFF)
+        break;
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(destination + written), _mm_packus_epi16(block, block));
+      written += 8;
+      i += 8;
+    }
+    if (i >= units)
+      break;
+#endif
+    std::uint32_t c = unit(i++);
+    if (c >= 0xD800 && c < 0xDC00 && i < units && unit(i) >= 0xDC00 && unit(i) < 0xE000)
+      c = 0x10000 + ((c - 0xD800) << 10) + (unit(i++) - 0xDC00);
+    else if (c >= 0xD800 && c < 0xE000)
+      c = 0xFFFD; // unpaired surrogate
+    if (c < 0x80)
+    {
+      destination[written++] = static_cast<std::uint8_t>(c);
+    }
+    else if (c < 0x800)
+    {
+      destination[written++] = static_cast<std::uint8_t>(0xC0 | (c >> 6));
+      destination[written++] = static_cast<std::uint8_t>(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000)
+    {
+      destination[written++] = static_cast<std::uint8_t>(0xE0 | (c >> 12));
+      destination[written++] = static_cast<std::uint8_t>(0x80 | ((c >> 6) & 0x3F));
+      destination[written++] = static_cast<std::uint8_t>(0x80 | (c & 0x3F));
+    }
+    else
+    {
+      destination[written++] = static_cast<std::uint8_t>(0xF0 | (c >> 18));
+      destination[written++] = static_cast<std::uint8_t>(0x80 | ((c >> 12) & 0x3F));
+      destination[written++] = static_cast<std::uint8_t>(0x80 | ((c >> 6) & 0x3F));
+      destination[written++] = static_cast<std::uint8_t>(0x80 | (c & 0x3F));
+    }
+  }
+  Buffer.resize(written);
+  return Buffer;
+}
+
+std::string_view Synavis::UnrealMessageText(std::span<const std::byte> Data, std::string& Buffer)
+{
+  if (Data.size() < 3)
+    return {};
+  const std::size_t length = std::to_integer<std::size_t>(Data[1]) | (std::to_integer<std::size_t>(Data[2]) << 8);
+  auto text = Data.subspan(3);
+  if (IsUtf16Text(text))
+    return NarrowUtf16(text.first(std::min(text.size(), 2 * length)), Buffer);
+  text = text.first(std::min(text.size(), length));
+  return std::string_view(reinterpret_cast<const char*>(text.data()), text.size());
+}
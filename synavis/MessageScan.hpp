@@ -0,0 +1,53 @@
+#ifndef SYNAVIS_MESSAGESCAN_HPP
+#define SYNAVIS_MESSAGESCAN_HPP
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+  // Returns the first balanced {...} object of Text as a view into Text, or an empty
+  // view if there is none. Braces inside JSON strings are counted like all others.
+  SYNAVIS_EXPORT std::string_view FindJsonObject(std::string_view Text);
+
+  // Returns the raw JSON value of a top-level key of Object without building a document,
+  // e.g. "\"meter\"" or "{\"a\":1}". Keys are compared as written, without unescaping.
+  // Returns an empty view if the key is missing or the object is malformed before it.
+  SYNAVIS_EXPORT std::string_view FindJsonField(std::string_view Object, std::string_view Key);
+  // Like FindJsonField, but returns the content of a string value without its quotes.
+  // Strings that contain escape sequences are not returned.
+  SYNAVIS_EXPORT std::string_view FindJsonString(std::string_view Object, std::string_view Key);
+
+  // What the data channel does with a binary message that is not a fragment
+  enum class EInboundRoute : std::uint8_t
+  {
+    // binary data for the data callbacks, e.g. meshes or anything that is not an Unreal message
+    Data,
+    // an Unreal response, initial settings or protocol message that carries JSON text,
+    // or a message framed with the marker byte of a connector
+    Message,
+    // the other Unreal messages, these are not passed on
+    Ignore
+  };
+  SYNAVIS_EXPORT EInboundRoute RouteInbound(std::span<const std::byte> Data, std::byte Marker);
+
+  // Unreal sends its TCHAR strings as UTF-16LE, these start with an ASCII character
+  // followed by a zero byte.
+  SYNAVIS_EXPORT bool IsUtf16Text(std::span<const std::byte> Data);
+
+  // Converts UTF-16LE to UTF-8 into Buffer and returns a view of it. The buffer keeps
+  // its capacity, so repeated conversions of similar sizes do not allocate.
+  SYNAVIS_EXPORT std::string_view NarrowUtf16(std::span<const std::byte> Data, std::string& Buffer);
+
+  // The text of an Unreal message, which follows the message byte and a 16-bit length.
+  // The length counts UTF-16 units or bytes of UTF-8 text, anything behind the text is
+  // ignored. UTF-8 text is returned in place, UTF-16 text is narrowed into Buffer.
+  SYNAVIS_EXPORT std::string_view UnrealMessageText(std::span<const std::byte> Data, std::string& Buffer);
+}
+
+#endif
@@ -0,0 +1,27 @@
+#include "Pipeline.hpp"
+
+namespace Synavis
+{
+  void StageCounter::Processed(std::chrono::steady_clock::time_point Queued)
+  {
+    const auto latency = static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Queued).count());
+    TotalLatency += latency;
+    auto max = MaxLatency.load(std::memory_order_relaxed);
+    while (latency > max && !MaxLatency.compare_exchange_weak(max, latency, std::memory_order_relaxed));
+    ProcessedItems++;
+  }
+
+  StageStatistics StageCounter::Statistics(std::string Name, std::size_t Queued) const
+  {
+    const auto processed = ProcessedItems.load();
+    StageStatistics statistics;
+    statistics.Name = std::move(Name);
+    statistics.Processed = processed;
+    statistics.Dropped = DroppedItems.load();
+    statistics.Queued = Queued;
+    statistics.MeanLatency = processed > 0 ? static_cast<double>(TotalLatency.load()) / processed * 1e-9 : 0.0;
+    statistics.MaxLatency = static_cast<double>(MaxLatency.load()) * 1e-9;
+    return statistics;
+  }
+}
@@ -0,0 +1,135 @@
+#ifndef SYNAVIS_PIPELINE_HPP
+#define SYNAVIS_PIPELINE_HPP
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Synavis.hpp"
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+  // A bounded FIFO between two pipeline stages. The slots are allocated once, a full
+  // queue either makes the producer wait (Block) or rejects the item (WouldBlock).
+  // Close wakes all waiting threads, the consumer still receives what is left.
+  template < typename T > class StageQueue
+  {
+  public:
+    explicit StageQueue(std::size_t Capacity) : Slots(std::max<std::size_t>(Capacity, 1)) {}
+
+    // false if the queue is closed, or full and the policy is WouldBlock
+    bool Push(T&& Item, EBackPressurePolicy Policy = EBackPressurePolicy::Block)
+    {
+      std::unique_lock<std::mutex> lock(QueueLock);
+      if (Policy == EBackPressurePolicy::Block)
+        NotFull.wait(lock, [this] { return Count < Slots.size() || Closed; });
+      if (Closed || Count == Slots.size())
+        return false;
+      auto& slot = Slots[(Head + Count) % Slots.size()];
+      slot.Item = std::move(Item);
+      slot.Queued = std::chrono::steady_clock::now();
+      Count++;
+      lock.unlock();
+      NotEmpty.notify_one();
+      return true;
+    }
+
+    // waits for the next item, there is none once the queue is closed and empty
+    std::optional<T> Pop(std::chrono::steady_clock::time_point* Queued = nullptr)
+    {
+      std::unique_lock<std::mutex> lock(QueueLock);
+      NotEmpty.wait(lock, [this] { return Count > 0 || Closed; });
+      return Take(lock, Queued);
+    }
+
+    std::optional<T> TryPop(std::chrono::steady_clock::time_point* Queued = nullptr)
+    {
+      std::unique_lock<std::mutex> lock(QueueLock);
+      return Take(lock, Queued);
+    }
+
+    void Close()
+    {
+      {
+        std::unique_lock<std::mutex> lock(QueueLock);
+        Closed = true;
+      }
+      NotEmpty.notify_all();
+      NotFull.notify_all();
+    }
+
+    std::size_t Size()
+    {
+      std::unique_lock<std::mutex> lock(QueueLock);
+      return Count;
+    }
+
+    std::size_t GetCapacity() const { return Slots.size(); }
+
+  private:
+    std::optional<T> Take(std::unique_lock<std::mutex>& Lock, std::chrono::steady_clock::time_point* Queued)
+    {
+      if (Count == 0)
+        return std::nullopt;
+      auto& slot = Slots[Head];
+      std::optional<T> item(std::move(slot.Item));
+      if (Queued)
+        *Queued = slot.Queued;
+      Head = (Head + 1) % Slots.size();
+      Count--;
+      Lock.unlock();
+      NotFull.notify_one();
+      return item;
+    }
+
+    struct Slot
+    {
+      T Item{};
+      std::chrono::steady_clock::time_point Queued;
+    };
+    std::vector<Slot> Slots;
+    std::size_t Head{ 0 };
+    std::size_t Count{ 0 };
+    bool Closed{ false };
+    std::mutex QueueLock;
+    std::condition_variable NotEmpty;
+    std::condition_variable NotFull;
+  };
+
+  struct SYNAVIS_EXPORT StageStatistics
+  {
+    std::string Name;
+    std::size_t Processed;
+    std::size_t Dropped;
+    // items waiting in front of the stage
+    std::size_t Queued;
+    // seconds from entering the queue of the stage until the stage is done with the item
+    double MeanLatency;
+    double MaxLatency;
+  };
+
+  // The counters of one stage, written by the stage thread and read from anywhere
+  class SYNAVIS_EXPORT StageCounter
+  {
+  public:
+    void Processed(std::chrono::steady_clock::time_point Queued);
+    void Dropped() { DroppedItems++; }
+    StageStatistics Statistics(std::string Name, std::size_t Queued) const;
+
+  private:
+    std::atomic<std::size_t> ProcessedItems{ 0 };
+    std::atomic<std::size_t> DroppedItems{ 0 };
+    std::atomic<std::uint64_t> TotalLatency{ 0 };
+    std::atomic<std::uint64_t> MaxLatency{ 0 };
+  };
+}
+
+#endif
@@ -24,6 +24,7 @@ namespace py = pybind11;
 
 #include "UnrealReceiver.hpp"
 #include "Synavis.hpp"
+#include "GeometryFile.hpp"
 #include "Seeker.hpp"
 #include "Adapter.hpp"
 #include "Provider.hpp"
@@ -154,6 +155,7 @@ namespace Synavis
     py::enum_<EConnectionState>(m, "EConnectionState")
       .value("STARTUP", EConnectionState::STARTUP)
       .value("SIGNUP", EConnectionState::SIGNUP)
+      .value("OFFERED", EConnectionState::OFFERED)
       .value("CONNECTED", EConnectionState::CONNECTED)
       .value("VIDEO", EConnectionState::VIDEO)
       .value("CLOSED", EConnectionState::CLOSED)
@@ -185,6 +187,65 @@ namespace Synavis
       .export_values()
     ;
 
+    py::enum_<EBackPressurePolicy>(m, "BackPressurePolicy")
+      .value("Block", EBackPressurePolicy::Block)
+      .value("WouldBlock", EBackPressurePolicy::WouldBlock)
+      .export_values()
+    ;
+
+    py::class_<GeometryBatch, std::shared_ptr<GeometryBatch>>(m, "GeometryBatch")
+      .def(py::init<>())
+      .def("Add", [](GeometryBatch& self, std::string Name, std::vector<double> Vertices, std::vector<uint32_t> Indices,
+        std::optional<std::vector<double>> Normals, std::optional<std::vector<double>> UVs, std::optional<std::vector<double>> Tangents)
+        {
+          MeshView Geometry;
+          Geometry.Name = Name;
+          Geometry.Vertices = Vertices;
+          Geometry.Indices = Indices;
+          if (Normals.has_value()) Geometry.Normals = Normals.value();
+          if (UVs.has_value()) Geometry.UVs = UVs.value();
+          if (Tangents.has_value()) Geometry.Tangents = Tangents.value();
+          self.Add(Geometry);
+        }, py::arg("Name"), py::arg("Vertices"), py::arg("Indices"), py::arg("Normals") = std::nullopt,
+        py::arg("UVs") = std::nullopt, py::arg("Tangents") = std::nullopt)
+      .def("Clear", &GeometryBatch::Clear)
+      .def("Count", &GeometryBatch::Count)
+      .def("Size", &GeometryBatch::Size)
+    ;
+
+    py::class_<SharedMemoryRing, std::shared_ptr<SharedMemoryRing>>(m, "SharedMemoryRing")
+      .def(py::init<std::string, std::size_t, std::size_t>(), py::arg("Name"), py::arg("SlotCount"), py::arg("SlotSize"))
+      .def(py::init<std::string>(), py::arg("Name"))
+      .def("GetName", &SharedMemoryRing::GetName)
+      .def("GetSlotCount", &SharedMemoryRing::GetSlotCount)
+      .def("GetSlotSize", &SharedMemoryRing::GetSlotSize)
+      .def("Pending", &SharedMemoryRing::Pending)
+      // the view points into the shared segment and must not be used after Release
+      .def("Peek", [](const SharedMemoryRing& self) -> py::object
+        {
+          auto slot = self.Peek();
+          if (!slot.has_value())
+            return py::none();
+          return py::make_tuple(slot->Sequence, py::memoryview::from_memory(slot->Data.data(), static_cast<py::ssize_t>(slot->Data.size()), true));
+        })
+      .def("Release", &SharedMemoryRing::Release)
+    ;
+
+    py::enum_<EGeometryEncoding>(m, "GeometryEncoding")
+      .value("Base64", EGeometryEncoding::Base64)
+      .value("Binary", EGeometryEncoding::Binary)
+      .value("BinaryFloat64", EGeometryEncoding::BinaryFloat64)
+      .value("Quantized", EGeometryEncoding::Quantized)
+      .export_values()
+    ;
+
+    // None is a keyword in Python, the values are not exported into the module
+    py::enum_<ECompression>(m, "Compression")
+      .value("NoCompression", ECompression::None)
+      .value("Fast", ECompression::Fast)
+      .value("Strong", ECompression::Strong)
+    ;
+
     
     py::class_<UnrealReceiver, PyReceiver, std::shared_ptr<UnrealReceiver>>(m, "UnrealReceiver")
       .def(py::init<>())
@@ -206,6 +267,17 @@ namespace Synavis
     m.def("VerboseMode", &VerboseMode);
     m.def("SilentMode", &SilentMode);
     m.def("ExitWithMessage", &ExitWithMessage, py::arg("Message"), py::arg("Code"));
+    m.def("WriteGeometryFile", [](std::string Filename, std::vector<double> Vertices, std::vector<uint32_t> Indices,
+      std::optional<std::vector<double>> Normals, std::optional<std::vector<double>> UVs)
+      {
+        MeshView Geometry;
+        Geometry.Name = Filename;
+        Geometry.Vertices = Vertices;
+        Geometry.Indices = Indices;
+        if (Normals.has_value()) Geometry.Normals = Normals.value();
+        if (UVs.has_value()) Geometry.UVs = UVs.value();
+        WriteGeometryFile(Filename, Geometry);
+      }, py::arg("Filename"), py::arg("Vertices"), py::arg("Indices"), py::arg("Normals") = std::nullopt, py::arg("UVs") = std::nullopt);
 
     py::class_<rtc::Configuration>(m, "PeerConnectionConfig")
         .def(py::init<>())
@@ -244,6 +316,72 @@ namespace Synavis
       .def("GetTaskCount", &WorkerThread::GetTaskCount)
     ;
 
+    // futures of asynchronous transfers, these can be awaited from asyncio
+    py::class_<std::shared_future<bool>, std::shared_ptr<std::shared_future<bool>>>(m, "TransferFuture")
+      .def("Get", [](std::shared_ptr<std::shared_future<bool>> self)
+        {
+          py::gil_scoped_release release;
+          return self->get();
+        })
+      .def("Wait", [](std::shared_ptr<std::shared_future<bool>> self, double Seconds)
+        {
+          py::gil_scoped_release release;
+          return self->wait_for(std::chrono::duration<double>(Seconds)) == std::future_status::ready;
+        }, py::arg("Seconds"))
+      .def("IsReady", [](std::shared_ptr<std::shared_future<bool>> self)
+        {
+          return self->wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        })
+      .def("__await__", [](std::shared_ptr<std::shared_future<bool>> self)
+        {
+          // the transfer is waited for in the default executor of the running loop
+          auto loop = py::module_::import("asyncio").attr("get_event_loop")();
+          auto get = py::cpp_function([self]()
+            {
+              py::gil_scoped_release release;
+              return self->get();
+            });
+          return loop.attr("run_in_executor")(py::none(), get).attr("__await__")();
+        })
+    ;
+
+    // replies to correlated requests, the reply is returned as a dict
+    py::class_<std::shared_future<nlohmann::json>, std::shared_ptr<std::shared_future<nlohmann::json>>>(m, "RequestFuture")
+      .def("Get", [](std::shared_ptr<std::shared_future<nlohmann::json>> self)
+        {
+          py::gil_scoped_release release;
+          return self->get();
+        })
+      .def("Wait", [](std::shared_ptr<std::shared_future<nlohmann::json>> self, double Seconds)
+        {
+          py::gil_scoped_release release;
+          return self->wait_for(std::chrono::duration<double>(Seconds)) == std::future_status::ready;
+        }, py::arg("Seconds"))
+      .def("IsReady", [](std::shared_ptr<std::shared_future<nlohmann::json>> self)
+        {
+          return self->wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        })
+      .def("__await__", [](std::shared_ptr<std::shared_future<nlohmann::json>> self)
+        {
+          auto loop = py::module_::import("asyncio").attr("get_event_loop")();
+          auto get = py::cpp_function([self]()
+            {
+              py::gil_scoped_release release;
+              return self->get();
+            });
+          return loop.attr("run_in_executor")(py::none(), get).attr("__await__")();
+        })
+    ;
+
+    py::class_<DataConnector::ChannelStatistics>(m, "ChannelStatistics")
+      .def_readonly("Label", &DataConnector::ChannelStatistics::Label)
+      .def_readonly("BytesSent", &DataConnector::ChannelStatistics::BytesSent)
+      .def_readonly("BytesReceived", &DataConnector::ChannelStatistics::BytesReceived)
+      .def_readonly("MessagesSent", &DataConnector::ChannelStatistics::MessagesSent)
+      .def_readonly("BufferedAmount", &DataConnector::ChannelStatistics::BufferedAmount)
+      .def_readonly("SendRate", &DataConnector::ChannelStatistics::SendRate)
+    ;
+
     py::class_<DataConnector, PyDataConnector<>, std::shared_ptr<DataConnector>>(m, "DataConnector")
       .def(py::init<>())
       .def("Initialize", &DataConnector::Initialize)
@@ -268,15 +406,83 @@ namespace Synavis
       .def("SendInt32Buffer", &DataConnector::SendInt32Buffer, py::arg("Buffer"), py::arg("Name"), py::arg("Format") = "raw")
       .def("SendFloat32Buffer", &DataConnector::SendFloat32Buffer, py::arg("Buffer"), py::arg("Name"), py::arg("Format") = "raw")
       .def("SendGeometry", &DataConnector::SendGeometry, py::arg("Vertices"), py::arg("Indices"), py::arg("Name"), py::arg("Normals"),  py::arg("UVs"), py::arg("Tangents"), py::arg("AutoMessage"))
+      .def("SendBufferAsync", [](DataConnector& self, py::bytes Buffer, std::string Name, std::string Format)
+        {
+          std::string_view view(Buffer);
+          std::vector<uint8_t> data(view.begin(), view.end());
+          return std::make_shared<std::shared_future<bool>>(self.SendBufferAsync(std::move(data), Name, Format));
+        }, py::arg("Buffer"), py::arg("Name"), py::arg("Format") = "raw")
+      .def("SendGeometryAsync", [](DataConnector& self, std::vector<double> Vertices, std::vector<uint32_t> Indices, std::string Name,
+        std::optional<std::vector<double>> Normals, std::optional<std::vector<double>> UVs, std::optional<std::vector<double>> Tangents, bool AutoMessage)
+        {
+          return std::make_shared<std::shared_future<bool>>(self.SendGeometryAsync(std::move(Vertices), std::move(Indices), Name,
+            std::move(Normals), std::move(UVs), std::move(Tangents), AutoMessage));
+        }, py::arg("Vertices"), py::arg("Indices"), py::arg("Name"), py::arg("Normals") = std::nullopt, py::arg("UVs") = std::nullopt,
+        py::arg("Tangents") = std::nullopt, py::arg("AutoMessage") = true)
+      .def("GetPendingTransfers", &DataConnector::GetPendingTransfers)
+      .def("SendGeometryBatch", &DataConnector::SendGeometryBatch, py::arg("Batch"))
+      .def("SendGeometryShared", [](DataConnector& self, std::shared_ptr<SharedMemoryRing> Ring, std::string Name, std::vector<double> Vertices, std::vector<uint32_t> Indices,
+        std::optional<std::vector<double>> Normals, std::optional<std::vector<double>> UVs, std::optional<std::vector<double>> Tangents)
+        {
+          MeshView Geometry;
+          Geometry.Name = Name;
+          Geometry.Vertices = Vertices;
+          Geometry.Indices = Indices;
+          if (Normals.has_value()) Geometry.Normals = Normals.value();
+          if (UVs.has_value()) Geometry.UVs = UVs.value();
+          if (Tangents.has_value()) Geometry.Tangents = Tangents.value();
+          py::gil_scoped_release release;
+          return self.SendGeometryShared(Ring, Geometry);
+        }, py::arg("Ring"), py::arg("Name"), py::arg("Vertices"), py::arg("Indices"), py::arg("Normals") = std::nullopt,
+        py::arg("UVs") = std::nullopt, py::arg("Tangents") = std::nullopt)
+      .def("ReleaseSharedSlot", &DataConnector::ReleaseSharedSlot, py::arg("Ring"))
       .def("SetLogVerbosity", &DataConnector::SetLogVerbosity, py::arg("Verbosity"))
       .def("SetRetryOnErrorResponse", &DataConnector::SetRetryOnErrorResponse, py::arg("Retry"))
       .def("WriteSDPsToFile", &DataConnector::WriteSDPsToFile, py::arg("Filename"))
       .def("SetTimeOut", &DataConnector::SetTimeOut, py::arg("TimeOut"))
       .def("SetFailIfNotComplete", &DataConnector::SetFailIfNotComplete, py::arg("FailIfNotComplete"))
       .def("SetDontWaitForAnswer", &DataConnector::SetDontWaitForAnswer, py::arg("DontWaitForAnswer"))
+      .def("SetTransferWindow", &DataConnector::SetTransferWindow, py::arg("Window"))
+      .def("GetTransferWindow", &DataConnector::GetTransferWindow)
+      .def("SetBufferCompression", &DataConnector::SetBufferCompression, py::arg("Level"), py::arg("Ratio") = 0.9)
+      .def("GetBufferCompression", &DataConnector::GetBufferCompression)
+      .def("SetGeometryEncoding", &DataConnector::SetGeometryEncoding, py::arg("Encoding"))
+      .def("GetGeometryEncoding", &DataConnector::GetGeometryEncoding)
+      .def("SetOptimizeVertexOrder", &DataConnector::SetOptimizeVertexOrder, py::arg("Optimize"))
+      .def("SetMessageCoalescing", &DataConnector::SetMessageCoalescing, py::arg("Coalesce"), py::arg("Delay") = 0.001, py::arg("MaxBytes") = 16 * 1024)
+      .def("FlushMessages", &DataConnector::FlushMessages)
+      .def("OnMessageType", [](DataConnector& self, std::string Type, std::function<void(std::string)> Callback)
+        {
+          self.OnMessageType(std::move(Type), [Callback](LazyMessage& Message) { Callback(std::string(Message.Text())); });
+        }, py::arg("Type"), py::arg("Callback"))
+      .def("RemoveMessageType", &DataConnector::RemoveMessageType, py::arg("Type"))
+      .def("Request", [](DataConnector& self, nlohmann::json Command, double Timeout)
+        {
+          return std::make_shared<std::shared_future<nlohmann::json>>(self.Request(std::move(Command), Timeout));
+        }, py::arg("Command"), py::arg("Timeout") = 5.0)
+      .def("GetOutstandingRequests", &DataConnector::GetOutstandingRequests)
+      .def("SetStripeChannels", &DataConnector::SetStripeChannels, py::arg("Count"))
+      .def("GetOpenStripeChannels", &DataConnector::GetOpenStripeChannels)
+      .def("GetChannelStatistics", &DataConnector::GetChannelStatistics)
+      .def("SetTelemetryChannel", &DataConnector::SetTelemetryChannel, py::arg("Open"))
+      .def("SendTelemetry", &DataConnector::SendTelemetry, py::arg("Data"))
+      .def("SetTelemetryCache", &DataConnector::SetTelemetryCache, py::arg("Cache"))
+      .def("GetTelemetry", &DataConnector::GetTelemetry, py::arg("Key"))
+      .def("GetTelemetrySnapshot", &DataConnector::GetTelemetrySnapshot)
+      .def("SetIncrementalGeometry", &DataConnector::SetIncrementalGeometry, py::arg("Incremental"), py::arg("Threshold") = 0.5)
+      .def("ForgetGeometry", &DataConnector::ForgetGeometry, py::arg("Name"))
+      .def("SetSendQueueLimits", &DataConnector::SetSendQueueLimits, py::arg("MaxMessages"), py::arg("HighWater"), py::arg("LowWater"))
+      .def("SetBackPressurePolicy", &DataConnector::SetBackPressurePolicy, py::arg("Policy"))
+      .def("GetBackPressurePolicy", &DataConnector::GetBackPressurePolicy)
+      .def("GetSendQueueDepth", &DataConnector::GetSendQueueDepth)
+      .def("GetBufferedAmount", &DataConnector::GetBufferedAmount)
       .def_readwrite("IP", &DataConnector::IP)
       .def_readwrite("PortRange", &DataConnector::IP)
       .def("LockUntilConnected", &DataConnector::LockUntilConnected, py::arg("additional_wait") = 0)
+      .def("WaitForState", &DataConnector::WaitForState, py::arg("State"), py::arg("Timeout") = -1.0, py::call_guard<py::gil_scoped_release>())
+      .def("WaitWhileState", &DataConnector::WaitWhileState, py::arg("State"), py::arg("Timeout") = -1.0, py::call_guard<py::gil_scoped_release>())
+      .def("AddStateCallback", &DataConnector::AddStateCallback, py::arg("Callback"))
+      .def("RemoveStateCallback", &DataConnector::RemoveStateCallback, py::arg("Id"))
     ;
 
     py::class_<MediaReceiver, PyMediaReceiver<>, std::shared_ptr<MediaReceiver>>(m, "MediaReceiver")
@@ -305,6 +511,36 @@ namespace Synavis
       .def("SendInt32Buffer", &MediaReceiver::SendInt32Buffer, py::arg("Buffer"), py::arg("Name"), py::arg("Format") = "raw")
       .def("SendFloat32Buffer", &MediaReceiver::SendFloat32Buffer, py::arg("Buffer"), py::arg("Name"), py::arg("Format") = "raw")
       .def("SendGeometry", &MediaReceiver::SendGeometry, py::arg("Vertices"), py::arg("Indices"), py::arg("Name"), py::arg("Normals"),  py::arg("UVs"), py::arg("Tangents"), py::arg("AutoMessage"))
+      .def("SendBufferAsync", [](MediaReceiver& self, py::bytes Buffer, std::string Name, std::string Format)
+        {
+          std::string_view view(Buffer);
+          std::vector<uint8_t> data(view.begin(), view.end());
+          return std::make_shared<std::shared_future<bool>>(self.SendBufferAsync(std::move(data), Name, Format));
+        }, py::arg("Buffer"), py::arg("Name"), py::arg("Format") = "raw")
+      .def("SendGeometryAsync", [](MediaReceiver& self, std::vector<double> Vertices, std::vector<uint32_t> Indices, std::string Name,
+        std::optional<std::vector<double>> Normals, std::optional<std::vector<double>> UVs, std::optional<std::vector<double>> Tangents, bool AutoMessage)
+        {
+          return std::make_shared<std::shared_future<bool>>(self.SendGeometryAsync(std::move(Vertices), std::move(Indices), Name,
+            std::move(Normals), std::move(UVs), std::move(Tangents), AutoMessage));
+        }, py::arg("Vertices"), py::arg("Indices"), py::arg("Name"), py::arg("Normals") = std::nullopt, py::arg("UVs") = std::nullopt,
+        py::arg("Tangents") = std::nullopt, py::arg("AutoMessage") = true)
+      .def("GetPendingTransfers", &MediaReceiver::GetPendingTransfers)
+      .def("SendGeometryBatch", &MediaReceiver::SendGeometryBatch, py::arg("Batch"))
+      .def("SendGeometryShared", [](MediaReceiver& self, std::shared_ptr<SharedMemoryRing> Ring, std::string Name, std::vector<double> Vertices, std::vector<uint32_t> Indices,
+        std::optional<std::vector<double>> Normals, std::optional<std::vector<double>> UVs, std::optional<std::vector<double>> Tangents)
+        {
+          MeshView Geometry;
+          Geometry.Name = Name;
+          Geometry.Vertices = Vertices;
+          Geometry.Indices = Indices;
+          if (Normals.has_value()) Geometry.Normals = Normals.value();
+          if (UVs.has_value()) Geometry.UVs = UVs.value();
+          if (Tangents.has_value()) Geometry.Tangents = Tangents.value();
+          py::gil_scoped_release release;
+          return self.SendGeometryShared(Ring, Geometry);
+        }, py::arg("Ring"), py::arg("Name"), py::arg("Vertices"), py::arg("Indices"), py::arg("Normals") = std::nullopt,
+        py::arg("UVs") = std::nullopt, py::arg("Tangents") = std::nullopt)
+      .def("ReleaseSharedSlot", &MediaReceiver::ReleaseSharedSlot, py::arg("Ring"))
       .def("SetLogVerbosity", &MediaReceiver::SetLogVerbosity, py::arg("Verbosity"))
       .def("SetRetryOnErrorResponse", &MediaReceiver::SetRetryOnErrorResponse, py::arg("Retry"))
       .def("RequestKeyFrame", &MediaReceiver::RequestKeyFrame)
@@ -313,9 +549,47 @@ namespace Synavis
       .def("SetTimeOut", &MediaReceiver::SetTimeOut, py::arg("TimeOut"))
       .def("SetFailIfNotComplete", &MediaReceiver::SetFailIfNotComplete, py::arg("FailIfNotComplete"))
       .def("SetDontWaitForAnswer", &MediaReceiver::SetDontWaitForAnswer, py::arg("DontWaitForAnswer"))
+      .def("SetTransferWindow", &MediaReceiver::SetTransferWindow, py::arg("Window"))
+      .def("GetTransferWindow", &MediaReceiver::GetTransferWindow)
+      .def("SetBufferCompression", &MediaReceiver::SetBufferCompression, py::arg("Level"), py::arg("Ratio") = 0.9)
+      .def("GetBufferCompression", &MediaReceiver::GetBufferCompression)
+      .def("SetGeometryEncoding", &MediaReceiver::SetGeometryEncoding, py::arg("Encoding"))
+      .def("GetGeometryEncoding", &MediaReceiver::GetGeometryEncoding)
+      .def("SetOptimizeVertexOrder", &MediaReceiver::SetOptimizeVertexOrder, py::arg("Optimize"))
+      .def("SetMessageCoalescing", &MediaReceiver::SetMessageCoalescing, py::arg("Coalesce"), py::arg("Delay") = 0.001, py::arg("MaxBytes") = 16 * 1024)
+      .def("FlushMessages", &MediaReceiver::FlushMessages)
+      .def("OnMessageType", [](MediaReceiver& self, std::string Type, std::function<void(std::string)> Callback)
+        {
+          self.OnMessageType(std::move(Type), [Callback](LazyMessage& Message) { Callback(std::string(Message.Text())); });
+        }, py::arg("Type"), py::arg("Callback"))
+      .def("RemoveMessageType", &MediaReceiver::RemoveMessageType, py::arg("Type"))
+      .def("Request", [](MediaReceiver& self, nlohmann::json Command, double Timeout)
+        {
+          return std::make_shared<std::shared_future<nlohmann::json>>(self.Request(std::move(Command), Timeout));
+        }, py::arg("Command"), py::arg("Timeout") = 5.0)
+      .def("GetOutstandingRequests", &MediaReceiver::GetOutstandingRequests)
+      .def("SetStripeChannels", &MediaReceiver::SetStripeChannels, py::arg("Count"))
+      .def("GetOpenStripeChannels", &MediaReceiver::GetOpenStripeChannels)
+      .def("GetChannelStatistics", &MediaReceiver::GetChannelStatistics)
+      .def("SetTelemetryChannel", &MediaReceiver::SetTelemetryChannel, py::arg("Open"))
+      .def("SendTelemetry", &MediaReceiver::SendTelemetry, py::arg("Data"))
+      .def("SetTelemetryCache", &MediaReceiver::SetTelemetryCache, py::arg("Cache"))
+      .def("GetTelemetry", &MediaReceiver::GetTelemetry, py::arg("Key"))
+      .def("GetTelemetrySnapshot", &MediaReceiver::GetTelemetrySnapshot)
+      .def("SetIncrementalGeometry", &MediaReceiver::SetIncrementalGeometry, py::arg("Incremental"), py::arg("Threshold") = 0.5)
+      .def("ForgetGeometry", &MediaReceiver::ForgetGeometry, py::arg("Name"))
+      .def("SetSendQueueLimits", &MediaReceiver::SetSendQueueLimits, py::arg("MaxMessages"), py::arg("HighWater"), py::arg("LowWater"))
+      .def("SetBackPressurePolicy", &MediaReceiver::SetBackPressurePolicy, py::arg("Policy"))
+      .def("GetBackPressurePolicy", &MediaReceiver::GetBackPressurePolicy)
+      .def("GetSendQueueDepth", &MediaReceiver::GetSendQueueDepth)
+      .def("GetBufferedAmount", &MediaReceiver::GetBufferedAmount)
       .def_readwrite("IP", &MediaReceiver::IP)
       .def_readwrite("PortRange", &MediaReceiver::IP)
       .def("LockUntilConnected", &MediaReceiver::LockUntilConnected, py::arg("additional_wait") = 0)
+      .def("WaitForState", &MediaReceiver::WaitForState, py::arg("State"), py::arg("Timeout") = -1.0, py::call_guard<py::gil_scoped_release>())
+      .def("WaitWhileState", &MediaReceiver::WaitWhileState, py::arg("State"), py::arg("Timeout") = -1.0, py::call_guard<py::gil_scoped_release>())
+      .def("AddStateCallback", &MediaReceiver::AddStateCallback, py::arg("Callback"))
+      .def("RemoveStateCallback", &MediaReceiver::RemoveStateCallback, py::arg("Id"))
     ;
 
     py::enum_<rtc::PeerConnection::GatheringState>(m, "GatheringState")
@@ -349,10 +623,24 @@ namespace Synavis
       .def("OnSignallingMessage", (void(Provider::*)(std::string)) & PyProvider<>::OnSignallingMessage, py::arg("Message"))
     ;
 
+    py::class_<StageStatistics>(m, "StageStatistics")
+      .def_readonly("Name", &StageStatistics::Name)
+      .def_readonly("Processed", &StageStatistics::Processed)
+      .def_readonly("Dropped", &StageStatistics::Dropped)
+      .def_readonly("Queued", &StageStatistics::Queued)
+      .def_readonly("MeanLatency", &StageStatistics::MeanLatency)
+      .def_readonly("MaxLatency", &StageStatistics::MaxLatency)
+    ;
+
     py::class_<FrameDecode, std::shared_ptr<FrameDecode>>(m, "FrameDecode")
       .def(py::init<>())
       .def("CreateAcceptor", &FrameDecode::CreateAcceptor)
       .def("SetFrameCallback", &FrameDecode::SetFrameCallback)
+      .def("SetJitterBuffer", &FrameDecode::SetJitterBuffer, py::arg("Capacity"), py::arg("PlayoutDelay"))
+      .def("SetPacketLossCallback", &FrameDecode::SetPacketLossCallback)
+      .def("SetFramePool", &FrameDecode::SetFramePool, py::arg("MaxFrames"), py::arg("RowAlignment") = 1)
+      .def("SetDecoderThreading", &FrameDecode::SetDecoderThreading, py::arg("Threads"), py::arg("FrameThreads") = false, py::arg("SliceThreads") = true)
+      .def("GetStageStatistics", &FrameDecode::GetStageStatistics)
     ;
   }
 
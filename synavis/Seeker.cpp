@@ -15,6 +15,60 @@
 
 Synavis::Seeker::Seeker() : Bridge()
 {
+  SignallingHandlers.On("offer", [this](LazyMessage& Message)
+    {
+      std::cout << this->Prefix() << "I received an offer and this is the most crucial step in bridge setup!" << std::endl;
+
+      // we MUST fail if this is not resolved as the sdp description
+      // has to be SYNCHRONOUSLY valid on both ends of the bridge!
+      // Additionally, we must process the answer before anything else happens
+      // including the CREATION of the connection, as its initialization
+      // depends on what we are hearing back from unreal in terms of
+      // payloads and ssrc info
+      auto NewConnection = CreateConnection();
+      CreateTask(std::bind(&Seeker::BridgeSynchronize, this, NewConnection.get(), Message.Document(), true));
+    });
+  SignallingHandlers.On("iceCandidate", [this](LazyMessage& Message)
+    {
+      const auto& content = Message.Document();
+      int ID;
+      if (!FindID(content, ID))
+      {
+        std::cout << this->Prefix() << "From onMessage SignallingServer Thread: Could not identify player id from input, discarding this message." << std::endl;
+        return;
+      }
+      std::shared_ptr<Connector> Endpoint;
+      try
+      {
+        std::shared_ptr<Adapter> fetch_object = EndpointById[ID];
+        Endpoint = std::dynamic_pointer_cast<Connector>(fetch_object);
+        if (!Endpoint)
+        {
+          throw std::runtime_error("Tried to cast an adapter to a Connector and failed.");
+        }
+      }
+      catch (...)
+      {
+        std::cout << this->Prefix() << "From onMessage SS thread: Could not find Connector for ice candidate." << std::endl;
+        return;
+      }
+      Endpoint->OnRemoteInformation(content);
+    });
+  SignallingHandlers.On("connected", [this](LazyMessage& Message)
+    {
+      // symmetric to the offer entry, but we do not create a connection here
+      const auto& content = Message.Document();
+      int id;
+      if (!FindID(content, id))
+      {
+        json response = { {"type","error"}, {"what","Could not extract ID from connection notice."} };
+        SignallingConnection->send(response.dump());
+      }
+      else
+      {
+        CreateTask(std::bind(&Seeker::BridgeSynchronize, this, nullptr, content, true));
+      }
+    });
 }
 
 Synavis::Seeker::~Seeker()
@@ -201,57 +255,14 @@ void Synavis::Seeker::Listen()
 
 void Synavis::Seeker::OnSignallingMessage(std::string Message)
 {
-  json content = json::parse(Message);
-  int ID;
-  if (!FindID(content, ID))
-  {
-    std::cout << this->Prefix() << "From onMessage SignallingServer Thread: Could not identify player id from input, discarding this message." << std::endl;
-
-  }
-  if (content["type"] == "offer")
+  try
   {
-    std::cout << this->Prefix() << "I received an offer and this is the most crucial step in bridge setup!" << std::endl;
-
-    // we MUST fail if this is not resolved as the sdp description
-    // has to be SYNCHRONOUSLY valid on both ends of the bridge!
-    // Additionally, we must process the answer before anything else happens
-    // including the CREATION of the connection, as its initialization
-    // depends on what we are hearing back from unreal in terms of
-    // payloads and ssrc info
-    auto NewConnection = CreateConnection();
-    CreateTask(std::bind(&Seeker::BridgeSynchronize, this, NewConnection.get(), content, true));
-  }
-  else if (content["type"] == "iceCandidate")
-  {
-    std::shared_ptr<Connector> Endpoint;
-    try
-    {
-      std::shared_ptr<Adapter> fetch_object = EndpointById[ID];
-      Endpoint = std::dynamic_pointer_cast<Connector>(fetch_object);
-      if (!Endpoint)
-      {
-        throw std::runtime_error("Tried to cast an adapter to a Connector and failed.");
-      }
-    }
-    catch (...)
-    {
-      std::cout << this->Prefix() << "From onMessage SS thread: Could not find Connector for ice candidate." << std::endl;
-    }
-    Endpoint->OnRemoteInformation(content);
+    if (!SignallingHandlers.Dispatch(Message))
+      std::cout << this->Prefix() << "Ignoring signalling message without a handler." << std::endl;
   }
-  else if (content["type"] == "connected")
+  catch (const json::exception& e)
   {
-    // symmetric to the offer entry, but we do not create a connection here
-    int id;
-    if (!FindID(Message, id))
-    {
-      json response = { {"type","error"}, {"what","Could not extract ID from connection notice."} };
-      SignallingConnection->send(response.dump());
-    }
-    else
-    {
-      CreateTask(std::bind(&Seeker::BridgeSynchronize, this, nullptr, content, true));
-    }
+    std::cout << this->Prefix() << "Could not parse signalling message: " << e.what() << std::endl;
   }
 }
 
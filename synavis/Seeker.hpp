@@ -10,6 +10,7 @@
 #include <memory>
 
 #include "Synavis.hpp"
+#include "MessageDispatcher.hpp"
 
 #include "Synavis/export.hpp"
 #include <span>
@@ -48,6 +49,8 @@ namespace Synavis
     void RemoteMessage(json Message) override;
     void InitConnection() override;
     virtual std::string Prefix() override;
+  protected:
+    MessageDispatcher SignallingHandlers;
   }; 
   
 }
@@ -0,0 +1,114 @@
+#include "SendQueue.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+static const Synavis::Logger::LoggerInstance lqueue = Synavis::Logger::Get()->LogStarter("SendQueue");
+
+namespace Synavis
+{
+  SendQueue::SendQueue(std::function<bool(rtc::binary)> Send, std::function<std::size_t()> BufferedAmount)
+    : Send(std::move(Send)), BufferedAmount(std::move(BufferedAmount))
+  {
+  }
+
+  void SendQueue::SetLimits(std::size_t MaxMessages, std::size_t HighWater)
+  {
+    {
+      std::unique_lock<std::mutex> lock(QueueLock);
+      this->MaxMessages = std::max<std::size_t>(MaxMessages, 1);
+      this->HighWater = HighWater;
+    }
+    Space.notify_all();
+  }
+
+  void SendQueue::SetPolicy(EBackPressurePolicy Policy)
+  {
+    std::unique_lock<std::mutex> lock(QueueLock);
+    this->Policy = Policy;
+  }
+
+  EBackPressurePolicy SendQueue::GetPolicy()
+  {
+    std::unique_lock<std::mutex> lock(QueueLock);
+    return Policy;
+  }
+
+  bool SendQueue::Submit(rtc::binary Message, bool ForceBlock)
+  {
+    std::unique_lock<std::mutex> lock(QueueLock);
+    if (Closed)
+      return false;
+    // messages only bypass the queue if nothing is waiting in front of them
+    if (Messages.empty() && BufferedAmount() < HighWater)
+      return Hand(std::move(Message));
+    if (Messages.size() >= MaxMessages)
+    {
+      if (!ForceBlock && Policy == EBackPressurePolicy::WouldBlock)
+      {
+        lqueue(ELogVerbosity::Debug) << "Send queue is full, message would block" << std::endl;
+        return false;
+      }
+      Space.wait(lock, [this]() { return Messages.size() < MaxMessages || Closed; });
+      if (Closed)
+        return false;
+    }
+    Messages.push_back(std::move(Message));
+    return true;
+  }
+
+  void SendQueue::Drain()
+  {
+    std::unique_lock<std::mutex> lock(QueueLock);
+    while (!Closed && !Messages.empty() && BufferedAmount() < HighWater)
+    {
+      auto Message = std::move(Messages.front());
+      Messages.pop_front();
+      if (!Hand(std::move(Message)))
+      {
+        lqueue(ELogVerbosity::Warning) << "Dropping " << Messages.size() << " queued messages" << std::endl;
+        Messages.clear();
+      }
+    }
+    lock.unlock();
+    Space.notify_all();
+  }
+
+  bool SendQueue::Hand(rtc::binary Message)
+  {
+    // false from the channel only means that it buffered the message, it is still delivered
+    try
+    {
+      Send(std::move(Message));
+      return true;
+    }
+    catch (const std::exception& e)
+    {
+      lqueue(ELogVerbosity::Warning) << "Channel refused a message: " << e.what() << std::endl;
+      return false;
+    }
+  }
+
+  void SendQueue::Close()
+  {
+    {
+      // set under the lock, so that a producer can not miss the wakeup between its check and its wait
+      std::unique_lock<std::mutex> lock(QueueLock);
+      Closed = true;
+      Messages.clear();
+    }
+    Space.notify_all();
+  }
+
+  void SendQueue::Open()
+  {
+    std::unique_lock<std::mutex> lock(QueueLock);
+    Closed = false;
+  }
+
+  std::size_t SendQueue::Size()
+  {
+    std::unique_lock<std::mutex> lock(QueueLock);
+    return Messages.size();
+  }
+}
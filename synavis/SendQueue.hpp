@@ -0,0 +1,53 @@
+#ifndef SYNAVIS_SENDQUEUE_HPP
+#define SYNAVIS_SENDQUEUE_HPP
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <rtc/common.hpp>
+#include "Synavis.hpp"
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+  // The outgoing messages of a data channel. A message is handed to the channel right
+  // away if nothing waits in front of it and the buffered amount of the channel is below
+  // the high watermark, otherwise it is queued until Drain is called once the channel
+  // reports a low buffered amount. A full queue makes the producer wait (Block) or
+  // rejects the message (WouldBlock), producers that must not lose a message force Block.
+  // Send behaves like rtc::Channel::send, false means buffered and a closed channel throws.
+  class SYNAVIS_EXPORT SendQueue
+  {
+  public:
+    SendQueue(std::function<bool(rtc::binary)> Send, std::function<std::size_t()> BufferedAmount);
+    void SetLimits(std::size_t MaxMessages, std::size_t HighWater);
+    void SetPolicy(EBackPressurePolicy Policy);
+    EBackPressurePolicy GetPolicy();
+    // true once the message is handed to the channel or queued, false if it was rejected,
+    // the channel refused it, or the queue was closed before there was space
+    bool Submit(rtc::binary Message, bool ForceBlock = false);
+    // hands queued messages to the channel until the high watermark is reached
+    void Drain();
+    // rejects messages and releases waiting producers until the queue is opened again
+    void Close();
+    void Open();
+    std::size_t Size();
+
+  private:
+    bool Hand(rtc::binary Message);
+    std::function<bool(rtc::binary)> Send;
+    std::function<std::size_t()> BufferedAmount;
+    std::mutex QueueLock;
+    std::condition_variable Space;
+    std::deque<rtc::binary> Messages;
+    std::size_t MaxMessages{ 1024 };
+    std::size_t HighWater{ 16 * 1024 * 1024 };
+    EBackPressurePolicy Policy{ EBackPressurePolicy::Block };
+    bool Closed{ true };
+  };
+}
+
+#endif
@@ -0,0 +1,243 @@
+#include "SharedMemory.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#undef min
+#undef max
+
+struct Synavis::SharedMemoryRing::Header
+{
+  std::uint8_t Magic[4];
+  std::uint32_t Version;
+  std::uint64_t SlotCount;
+  std::uint64_t SlotSize;
+  // the indices are on their own cache lines, so producer and consumer do not share one
+  alignas(64) std::atomic<std::uint64_t> Head;
+  alignas(64) std::atomic<std::uint64_t> Tail;
+};
+
+namespace
+{
+  constexpr std::size_t SlotAlignment = 64;
+  // processes can only share atomics that do not fall back to a lock
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+  std::size_t SlotStride(std::size_t SlotSize)
+  {
+    return (sizeof(std::uint64_t) + SlotSize + SlotAlignment - 1) / SlotAlignment * SlotAlignment;
+  }
+}
+
+Synavis::SharedMemoryRing::SharedMemoryRing(std::string Name, std::size_t SlotCount, std::size_t SlotSize)
+  : Name(std::move(Name)), SlotCount(SlotCount), SlotSize(SlotSize), Owner(true)
+{
+  static_assert(sizeof(Header) == 3 * SlotAlignment);
+  if (SlotCount == 0 || SlotSize == 0)
+    throw std::runtime_error("Shared memory ring needs at least one slot of at least one byte");
+  Stride = SlotStride(SlotSize);
+  MappedSize = sizeof(Header) + SlotCount * Stride;
+  Map(true);
+  std::memcpy(Shared->Magic, SharedRingMagic, sizeof(SharedRingMagic));
+  Shared->SlotCount = SlotCount;
+  Shared->SlotSize = SlotSize;
+  Shared->Head.store(0, std::memory_order_relaxed);
+  Shared->Tail.store(0, std::memory_order_relaxed);
+  // the version is written last, a consumer that sees it also sees the rest of the header
+  std::atomic_ref<std::uint32_t>(Shared->Version).store(SharedRingVersion, std::memory_order_release);
+}
+
+Synavis::SharedMemoryRing::SharedMemoryRing(std::string Name)
+  : Name(std::move(Name)), SlotCount(0), SlotSize(0), Owner(false)
+{
+  Map(false);
+  if (std::memcmp(Shared->Magic, SharedRingMagic, sizeof(SharedRingMagic)) != 0
+    || std::atomic_ref<std::uint32_t>(Shared->Version).load(std::memory_order_acquire) != SharedRingVersion)
+  {
+    Unmap();
+    throw std::runtime_error("Shared memory segment " + this->Name + " is not a ring of this version");
+  }
+  SlotCount = Shared->SlotCount;
+  SlotSize = Shared->SlotSize;
+  Stride = SlotStride(SlotSize);
+  if (SlotCount == 0 || MappedSize < sizeof(Header) + SlotCount * Stride)
+  {
+    Unmap();
+    throw std::runtime_error("Shared memory segment " + this->Name + " is smaller than its ring");
+  }
+}
+
+void Synavis::SharedMemoryRing::Map(bool Create)
+{
+  void* view = nullptr;
+#ifdef _WIN32
+  const std::string path = "Local\\" + Name;
+  if (Create)
+  {
+    Handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+      static_cast<DWORD>(static_cast<std::uint64_t>(MappedSize) >> 32), static_cast<DWORD>(MappedSize & 0xFFFFFFFFu), path.c_str());
+  }
+  else
+  {
+    Handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, path.c_str());
+  }
+  if (Handle == nullptr)
+    throw std::runtime_error("Could not map shared memory segment " + Name);
+  view = MapViewOfFile(Handle, FILE_MAP_ALL_ACCESS, 0, 0, Create ? MappedSize : 0);
+  if (view == nullptr)
+  {
+    CloseHandle(Handle);
+    throw std::runtime_error("Could not map shared memory segment " + Name);
+  }
+  if (!Create)
+  {
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery(view, &info, sizeof(info));
+    MappedSize = info.RegionSize;
+  }
+#else
+  const std::string path = "/" + Name;
+  if (Create)
+  {
+    // a producer that crashed leaves its segment behind
+    shm_unlink(path.c_str());
+    Descriptor = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (Descriptor >= 0 && ftruncate(Descriptor, static_cast<off_t>(MappedSize)) != 0)
+    {
+      close(Descriptor);
+      shm_unlink(path.c_str());
+      Descriptor = -1;
+    }
+  }
+  else
+  {
+    Descriptor = shm_open(path.c_str(), O_RDWR, 0);
+    struct stat info;
+    if (Descriptor >= 0 && fstat(Descriptor, &info) == 0)
+      MappedSize = static_cast<std::size_t>(info.st_size);
+  }
+  if (Descriptor < 0 || MappedSize < sizeof(Header))
+  {
+    if (Descriptor >= 0)
+      close(Descriptor);
+    throw std::runtime_error("Could not map shared memory segment " + Name);
+  }
+  view = mmap(nullptr, MappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, Descriptor, 0);
+  if (view == MAP_FAILED)
+  {
+    close(Descriptor);
+    if (Create)
+      shm_unlink(path.c_str());
+    throw std::runtime_error("Could not map shared memory segment " + Name);
+  }
+#endif
+  Shared = static_cast<Header*>(view);
+}
+
+Synavis::SharedMemoryRing::~SharedMemoryRing()
+{
+  Unmap();
+}
+
+void Synavis::SharedMemoryRing::Unmap()
+{
+  if (Shared == nullptr)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(Shared);
+  CloseHandle(Handle);
+#else
+  munmap(Shared, MappedSize);
+  close(Descriptor);
+  // mappings of the consumer stay valid until it unmaps them
+  if (Owner)
+    shm_unlink(("/" + Name).c_str());
+#endif
+  Shared = nullptr;
+}
+
+std::byte* Synavis::SharedMemoryRing::SlotAt(std::uint64_t Sequence) const
+{
+  return reinterpret_cast<std::byte*>(Shared) + sizeof(Header) + (Sequence % SlotCount) * Stride;
+}
+
+std::span<std::byte> Synavis::SharedMemoryRing::Acquire(double Timeout)
+{
+  const auto head = Shared->Head.load(std::memory_order_relaxed);
+  auto has_space = [&]() { return head - Shared->Tail.load(std::memory_order_acquire) < SlotCount; };
+  if (!has_space())
+  {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(Timeout));
+    std::unique_lock<std::mutex> lock(WaitLock);
+    while (!has_space())
+    {
+      if (Timeout >= 0.0 && std::chrono::steady_clock::now() >= deadline)
+        return {};
+      // the release notification may never come, e.g. if the consumer has no channel
+      Released.wait_for(lock, std::chrono::milliseconds(1));
+    }
+  }
+  return { SlotAt(head) + sizeof(std::uint64_t), SlotSize };
+}
+
+std::uint64_t Synavis::SharedMemoryRing::Commit(std::size_t Size)
+{
+  if (Size > SlotSize)
+    throw std::runtime_error("Payload is larger than the slots of shared memory ring " + Name);
+  const auto head = Shared->Head.load(std::memory_order_relaxed);
+  if (head - Shared->Tail.load(std::memory_order_acquire) >= SlotCount)
+    throw std::runtime_error("Commit without a free slot in shared memory ring " + Name);
+  const std::uint64_t size = Size;
+  std::memcpy(SlotAt(head), &size, sizeof(size));
+  // publishes the payload together with the index
+  Shared->Head.store(head + 1, std::memory_order_release);
+  return head;
+}
+
+std::uint64_t Synavis::SharedMemoryRing::NextSequence() const
+{
+  return Shared->Head.load(std::memory_order_relaxed);
+}
+
+void Synavis::SharedMemoryRing::NotifyReleased()
+{
+  std::unique_lock<std::mutex> lock(WaitLock);
+  Released.notify_all();
+}
+
+std::optional<Synavis::SharedMemoryRing::Slot> Synavis::SharedMemoryRing::Peek() const
+{
+  const auto tail = Shared->Tail.load(std::memory_order_relaxed);
+  if (tail == Shared->Head.load(std::memory_order_acquire))
+    return std::nullopt;
+  std::uint64_t size;
+  std::memcpy(&size, SlotAt(tail), sizeof(size));
+  if (size > SlotSize)
+    throw std::runtime_error("Corrupted slot in shared memory ring " + Name);
+  return Slot{ tail, { SlotAt(tail) + sizeof(std::uint64_t), static_cast<std::size_t>(size) } };
+}
+
+void Synavis::SharedMemoryRing::Release()
+{
+  const auto tail = Shared->Tail.load(std::memory_order_relaxed);
+  if (tail == Shared->Head.load(std::memory_order_acquire))
+    return;
+  Shared->Tail.store(tail + 1, std::memory_order_release);
+}
+
+std::size_t Synavis::SharedMemoryRing::Pending() const
+{
+  const auto tail = Shared->Tail.load(std::memory_order_acquire);
+  return static_cast<std::size_t>(Shared->Head.load(std::memory_order_acquire) - tail);
+}
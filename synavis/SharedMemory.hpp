@@ -0,0 +1,98 @@
+#ifndef SYNAVIS_SHAREDMEMORY_HPP
+#define SYNAVIS_SHAREDMEMORY_HPP
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+  // A ring of fixed-size slots in a named shared memory segment, for one producer and
+  // one consumer process on the same node. The segment starts with a header
+  //
+  //  offset  size  content
+  //  0       4     magic "SYNR"
+  //  4       4     format version
+  //  8       8     number of slots
+  //  16      8     payload size of a slot in bytes
+  //  64      8     number of committed slots (producer index)
+  //  128     8     number of released slots (consumer index)
+  //
+  // followed by the slots, each at a multiple of 64 bytes. A slot holds the size of its
+  // payload as uint64 and the payload. The message with sequence number n is in slot
+  // n modulo the number of slots. The indices only grow, the ring is full when they
+  // are one slot count apart.
+  constexpr std::uint8_t SharedRingMagic[4] = { 'S', 'Y', 'N', 'R' };
+  constexpr std::uint32_t SharedRingVersion = 1;
+
+  class SYNAVIS_EXPORT SharedMemoryRing
+  {
+  public:
+    struct Slot
+    {
+      std::uint64_t Sequence;
+      std::span<const std::byte> Data;
+    };
+
+    // Creates the segment, a stale segment of the same name is replaced. The segment
+    // is removed when the creating ring is destroyed. Names are plain words, on Linux
+    // the segment appears as /dev/shm/<Name>.
+    SharedMemoryRing(std::string Name, std::size_t SlotCount, std::size_t SlotSize);
+    // Maps a segment that another process created, throws std::runtime_error if there is none
+    explicit SharedMemoryRing(std::string Name);
+    ~SharedMemoryRing();
+    SharedMemoryRing(const SharedMemoryRing&) = delete;
+    SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+    const std::string& GetName() const { return Name; }
+    std::size_t GetSlotCount() const { return SlotCount; }
+    std::size_t GetSlotSize() const { return SlotSize; }
+
+    // Producer side: returns the payload of the next free slot to be written in place.
+    // The span is empty if no slot was released within Timeout seconds, a negative
+    // timeout waits indefinitely.
+    std::span<std::byte> Acquire(double Timeout = -1.0);
+    // publishes the acquired slot with Size bytes of payload and returns its sequence number
+    std::uint64_t Commit(std::size_t Size);
+    // the sequence number that the next Commit publishes, an acquired slot that is not
+    // committed stays free
+    std::uint64_t NextSequence() const;
+    // Wakes a producer that waits in Acquire. The consumer reports released slots over
+    // the data channel, the producer also looks for them on its own every millisecond.
+    void NotifyReleased();
+
+    // Consumer side: the oldest committed slot that was not released yet
+    std::optional<Slot> Peek() const;
+    // frees the oldest slot, the data of Peek must not be used afterwards
+    void Release();
+    // number of committed slots that were not released yet
+    std::size_t Pending() const;
+
+  private:
+    struct Header;
+    void Map(bool Create);
+    void Unmap();
+    std::byte* SlotAt(std::uint64_t Sequence) const;
+
+    std::string Name;
+    std::size_t SlotCount;
+    std::size_t SlotSize;
+    std::size_t Stride{ 0 };
+    std::size_t MappedSize{ 0 };
+    bool Owner;
+    Header* Shared{ nullptr };
+    void* Handle{ nullptr };
+    int Descriptor{ -1 };
+
+    std::mutex WaitLock;
+    std::condition_variable Released;
+  };
+}
+
+#endif
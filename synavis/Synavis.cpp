@@ -557,7 +557,7 @@ Synavis::WorkerThread::WorkerThread()
 
 Synavis::WorkerThread::~WorkerThread()
 {
-  Running = false;
+  Stop();
 }
 
 void Synavis::WorkerThread::Run()
@@ -584,7 +584,10 @@ void Synavis::WorkerThread::Run()
 
 void Synavis::WorkerThread::Stop()
 {
+  std::unique_lock<std::mutex> lock(TaskMutex);
   Running = false;
+  // wake the thread, otherwise it keeps waiting for a task that never comes
+  TaskCondition.notify_all();
 }
 
 uint64_t Synavis::WorkerThread::GetTaskCount()
@@ -600,6 +603,60 @@ void Synavis::WorkerThread::AddTask(std::function<void()>&& Task)
   this->TaskCondition.notify_all();
 }
 
+void Synavis::ConnectionState::Set(EConnectionState State)
+{
+  std::vector<std::shared_ptr<const TransitionCallback>> callbacks;
+  EConnectionState previous;
+  {
+    std::unique_lock<std::mutex> lock(StateLock);
+    previous = Current.exchange(State);
+    if (previous == State)
+      return;
+    callbacks.reserve(Callbacks.size());
+    for (const auto& [id, callback] : Callbacks)
+      callbacks.push_back(callback);
+  }
+  StateChanged.notify_all();
+  // called without the lock, so a callback may wait for or change the state itself
+  for (const auto& callback : callbacks)
+    (*callback)(previous, State);
+}
+
+bool Synavis::ConnectionState::Wait(std::function<bool(EConnectionState)> Predicate, double Timeout)
+{
+  std::unique_lock<std::mutex> lock(StateLock);
+  auto satisfied = [this, &Predicate]() { return Predicate(Current.load()); };
+  if (Timeout < 0.0)
+  {
+    StateChanged.wait(lock, satisfied);
+    return true;
+  }
+  return StateChanged.wait_for(lock, std::chrono::duration<double>(Timeout), satisfied);
+}
+
+bool Synavis::ConnectionState::WaitFor(EConnectionState State, double Timeout)
+{
+  return Wait([State](EConnectionState Now) { return Now >= State; }, Timeout);
+}
+
+bool Synavis::ConnectionState::WaitWhile(EConnectionState State, double Timeout)
+{
+  return Wait([State](EConnectionState Now) { return Now != State; }, Timeout);
+}
+
+std::size_t Synavis::ConnectionState::AddTransitionCallback(TransitionCallback Callback)
+{
+  std::unique_lock<std::mutex> lock(StateLock);
+  Callbacks.emplace(NextCallback, std::make_shared<const TransitionCallback>(std::move(Callback)));
+  return NextCallback++;
+}
+
+void Synavis::ConnectionState::RemoveTransitionCallback(std::size_t Id)
+{
+  std::unique_lock<std::mutex> lock(StateLock);
+  Callbacks.erase(Id);
+}
+
 Synavis::Bridge::Bridge()
 {
   std::cout << Prefix() << "An instance of the Synavis was started, we are starting the threads..." << std::endl;
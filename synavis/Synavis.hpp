@@ -9,6 +9,10 @@
 #include <chrono>
 #include <fstream>
 #include <queue>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include <ostream>
 #include <rtc/rtc.hpp>
 #include "Synavis/export.hpp"
@@ -94,6 +98,25 @@ namespace Synavis
     return Data.size() * sizeof(decltype(*Data.data()));
   }
 
+  // encodes Length bytes from Source as base64 directly into Destination
+  // Destination must hold at least 4 * ((Length + 2) / 3) characters
+  // the number of characters written is returned, padding only occurs if Length is not a multiple of 3
+  // the implementation is chosen at runtime (AVX2, SSSE3 or scalar), see Base64Implementation()
+  std::size_t Encode64Into(const uint8_t* Source, std::size_t Length, char* Destination);
+
+  // the number of bytes that the base64 string Encoded decodes to
+  std::size_t DecodedSize(std::string_view Encoded);
+
+  // decodes a base64 string into Destination, which must hold DecodedSize(Encoded) bytes
+  // returns false if the string contains characters outside of the base64 alphabet
+  bool Decode64Into(std::string_view Encoded, uint8_t* Destination, std::size_t& Written);
+
+  // decodes a base64 string into a new buffer, throws std::runtime_error on invalid input
+  std::vector<uint8_t> Decode64(std::string_view Encoded);
+
+  // name of the base64 implementation that was selected for this CPU
+  std::string_view Base64Implementation();
+
   // a function to encode a rtc::binary object into a base64 string
   // adapted from https://stackoverflow.com/questions/180947/base64-decode-snippet-in-c
   template < typename T >
@@ -102,40 +125,13 @@ namespace Synavis
     // check if the data is convertible to a pointer
     static_assert(is_pointer_convertible<T>::value, "Data must be convertible to a pointer");
     std::size_t byte_size = Data.size() * sizeof(decltype(*Data.data()));
-    // convert data to string of bytes
-    std::string_view strdata(reinterpret_cast<const char*>(Data.data()), byte_size);
-    // base64 encoding table
-    constexpr char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
     // compute the size of the encoded string
     std::size_t encoded_length = 4 * ((byte_size + 2) / 3);
     char* c = new char[encoded_length];
-    std::string_view c_result = { c, encoded_length };
-    std::size_t i;
-    for (i = 0; i < byte_size - 2; i += 3)
-    {
-      *c++ = table[(strdata[i] >> 2) & 0x3F];
-      *c++ = table[((strdata[i] & 0x3) << 4) | ((int)(strdata[i + 1] & 0xF0) >> 4)];
-      *c++ = table[((strdata[i + 1] & 0xF) << 2) | ((int)(strdata[i + 2] & 0xC0) >> 6)];
-      *c++ = table[strdata[i + 2] & 0x3F];
-    }
-    if (i < byte_size)
-    {
-      *c++ = table[(strdata[i] >> 2) & 0x3F];
-      if (i == (byte_size - 1))
-      {
-        *c++ = table[((strdata[i] & 0x3) << 4)];
-        *c++ = '=';
-      }
-      else
-      {
-        *c++ = table[((strdata[i] & 0x3) << 4) | ((int)(strdata[i + 1] & 0xF0) >> 4)];
-        *c++ = table[((strdata[i + 1] & 0xF) << 2)];
-      }
-      *c++ = '=';
-    }
+    Encode64Into(reinterpret_cast<const uint8_t*>(Data.data()), byte_size, c);
     // return the encoded string as a string_view because this way the data
     // is not deleted when the scope ends in which this function is called
-    return  c_result;
+    return { c, encoded_length };
   }
 
   // a function to retrieve the encoded size of a buffer for base64 encoding
@@ -362,6 +358,30 @@ namespace Synavis
     None
   };
 
+  // what a sender does when its outgoing queue is full
+  enum class SYNAVIS_EXPORT EBackPressurePolicy
+  {
+    Block = (std::uint8_t)ECodec::None + 1u,
+    WouldBlock
+  };
+
+  // how SendGeometry puts meshes on the wire
+  enum class SYNAVIS_EXPORT EGeometryEncoding
+  {
+    Base64 = (std::uint8_t)EBackPressurePolicy::WouldBlock + 1u,
+    Binary,
+    BinaryFloat64,
+    Quantized
+  };
+
+  // codec of SendBuffer chunks, see Compression.hpp
+  enum class SYNAVIS_EXPORT ECompression
+  {
+    None = (std::uint8_t)EGeometryEncoding::Quantized + 1u,
+    Fast,
+    Strong
+  };
+
   // a simple logger for the library
   class SYNAVIS_EXPORT Logger
   {
@@ -584,6 +604,32 @@ namespace Synavis
     bool Running = true;
   };
 
+  // The connection state of a connector. Waiting threads sleep on a condition variable
+  // until a transition happens, and callbacks are informed about every transition.
+  class SYNAVIS_EXPORT ConnectionState
+  {
+  public:
+    using TransitionCallback = std::function<void(EConnectionState From, EConnectionState To)>;
+    ConnectionState(EConnectionState Initial = EConnectionState::STARTUP) : Current(Initial) {}
+    EConnectionState Get() const { return Current.load(); }
+    // callbacks run on the thread that sets the state, after waiting threads were woken
+    void Set(EConnectionState State);
+    // waits until State or any later state is reached, a negative timeout waits forever
+    // \return false if the timeout passed first
+    bool WaitFor(EConnectionState State, double Timeout = -1.0);
+    // waits until the state is no longer State, e.g. until a connection ends
+    bool WaitWhile(EConnectionState State, double Timeout = -1.0);
+    std::size_t AddTransitionCallback(TransitionCallback Callback);
+    void RemoveTransitionCallback(std::size_t Id);
+  private:
+    bool Wait(std::function<bool(EConnectionState)> Predicate, double Timeout);
+    mutable std::mutex StateLock;
+    std::condition_variable StateChanged;
+    std::atomic<EConnectionState> Current;
+    std::map<std::size_t, std::shared_ptr<const TransitionCallback>> Callbacks;
+    std::size_t NextCallback{ 0 };
+  };
+
   class SYNAVIS_EXPORT Bridge
   {
   public:
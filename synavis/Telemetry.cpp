@@ -0,0 +1,58 @@
+#include "Telemetry.hpp"
+
+std::size_t Synavis::TelemetryCache::Apply(const nlohmann::json& Message, std::uint64_t Sequence)
+{
+  if (!Message.contains("data") || !Message["data"].is_object())
+    return 0;
+  std::size_t applied = 0;
+  for (const auto& [key, value] : Message["data"].items())
+  {
+    if (Update(key, Sequence, value))
+      applied++;
+  }
+  return applied;
+}
+
+bool Synavis::TelemetryCache::Update(const std::string& Key, std::uint64_t Sequence, nlohmann::json Data)
+{
+  std::unique_lock<std::mutex> lock(CacheLock);
+  auto entry = Values.find(Key);
+  if (entry == Values.end())
+  {
+    Values.emplace(Key, Value{ Sequence, std::move(Data), std::chrono::steady_clock::now() });
+    return true;
+  }
+  // an update that was overtaken by a newer one is dropped
+  if (Sequence <= entry->second.Sequence)
+  {
+    DroppedUpdates++;
+    return false;
+  }
+  entry->second = Value{ Sequence, std::move(Data), std::chrono::steady_clock::now() };
+  return true;
+}
+
+std::optional<Synavis::TelemetryCache::Value> Synavis::TelemetryCache::Get(const std::string& Key) const
+{
+  std::unique_lock<std::mutex> lock(CacheLock);
+  auto entry = Values.find(Key);
+  if (entry == Values.end())
+    return std::nullopt;
+  return entry->second;
+}
+
+nlohmann::json Synavis::TelemetryCache::Snapshot() const
+{
+  std::unique_lock<std::mutex> lock(CacheLock);
+  auto snapshot = nlohmann::json::object();
+  for (const auto& [key, value] : Values)
+    snapshot[key] = value.Data;
+  return snapshot;
+}
+
+void Synavis::TelemetryCache::Clear()
+{
+  std::unique_lock<std::mutex> lock(CacheLock);
+  Values.clear();
+  DroppedUpdates = 0;
+}
@@ -0,0 +1,46 @@
+#ifndef SYNAVIS_TELEMETRY_HPP
+#define SYNAVIS_TELEMETRY_HPP
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <json.hpp>
+#include "Synavis/export.hpp"
+
+namespace Synavis
+{
+  // Keeps the latest value of every tracked "object.property". Telemetry arrives over an
+  // unordered channel, so an update is only applied if its sequence number is newer than
+  // the one of the cached value.
+  class SYNAVIS_EXPORT TelemetryCache
+  {
+  public:
+    struct Value
+    {
+      std::uint64_t Sequence;
+      nlohmann::json Data;
+      std::chrono::steady_clock::time_point Received;
+    };
+    // applies all entries of the "data" object of a track message
+    // \return the number of entries that were newer than the cache
+    std::size_t Apply(const nlohmann::json& Message, std::uint64_t Sequence);
+    bool Update(const std::string& Key, std::uint64_t Sequence, nlohmann::json Data);
+    std::optional<Value> Get(const std::string& Key) const;
+    // all latest values as one object, keyed like the track messages
+    nlohmann::json Snapshot() const;
+    std::size_t Dropped() const { return DroppedUpdates; }
+    void Clear();
+  private:
+    mutable std::mutex CacheLock;
+    std::unordered_map<std::string, Value> Values;
+    // read without the lock
+    std::atomic<std::size_t> DroppedUpdates{ 0 };
+  };
+}
+
+#endif